@@ -0,0 +1,86 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <vector>
+
+// Each iteration stands in for handling one request: make a handful of short-lived
+// Strings and a small Data, then drop them all.
+
+namespace
+{
+
+const int kObjectsPerRequest = 32;
+
+void handleRequest(CFAllocatorRef allocator)
+{
+   std::vector<CoreFoundation::String> fields;
+   fields.reserve(kObjectsPerRequest);
+   for (int i = 0; i < kObjectsPerRequest; ++i)
+      fields.push_back(CoreFoundation::String("header-field-value", kCFStringEncodingUTF8, allocator));
+
+   const UInt8 body[64] = { 0 };
+   CoreFoundation::Data payload(body, sizeof(body), allocator);
+
+   CfxxBench::doNotOptimize(fields);
+   CfxxBench::doNotOptimize(payload);
+}
+
+} // namespace
+
+CFXX_BENCHMARK(AllocatorBenchmarks, RequestDefaultAllocator)
+{
+   while (state.keepRunning())
+      handleRequest(kCFAllocatorDefault);
+}
+
+CFXX_BENCHMARK(AllocatorBenchmarks, RequestMonotonicArena)
+{
+   CoreFoundation::MonotonicArena arena;
+
+   while (state.keepRunning())
+   {
+      handleRequest(arena.allocator());
+      arena.reset();
+   }
+}
+
+CFXX_BENCHMARK(AllocatorBenchmarks, RequestThreadLocalPool)
+{
+   CFAllocatorRef pool = CoreFoundation::ThreadLocalPool::allocator();
+
+   while (state.keepRunning())
+      handleRequest(pool);
+}
+
+CFXX_BENCHMARK(AllocatorBenchmarks, RequestBridgedStdAllocator)
+{
+   CoreFoundation::CFReference<CFAllocatorRef> bridged =
+      CoreFoundation::makeCFAllocator(std::allocator<char>());
+
+   while (state.keepRunning())
+      handleRequest(bridged.get());
+}
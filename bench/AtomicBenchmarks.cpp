@@ -0,0 +1,125 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Loads of a shared reference from 1..N threads at once. Every thread does as many loads
+// as there are iterations, so ns/op is the wall time per load on each thread: a flat
+// line across thread counts is perfect scaling.
+
+namespace
+{
+
+CoreFoundation::CFReference<CFDataRef> makeConfig()
+{
+   return CoreFoundation::makeCFReferenceFromCopyOrCreate(
+      CFDataCreate(kCFAllocatorDefault, reinterpret_cast<const UInt8*>("config"), 6));
+}
+
+// Runs 'load' once per iteration on the benchmark thread and the same number of times on
+// each of state.arg() - 1 other threads, which are waited for inside the timed loop.
+template<typename Load>
+void runOnThreads(CfxxBench::State& state, Load load)
+{
+   std::atomic<bool> go(false);
+   std::vector<std::thread> threads;
+   for (int64_t t = 1; t < state.arg(); ++t)
+   {
+      threads.emplace_back([&]()
+      {
+         while (!go.load())
+            std::this_thread::yield();
+         for (int64_t i = 0; i < state.iterations(); ++i)
+            load();
+      });
+   }
+
+   int64_t i = 0;
+   while (state.keepRunning())
+   {
+      go.store(true);
+      load();
+      if (++i == state.iterations())
+      {
+         for (std::thread& thread : threads)
+            thread.join();
+      }
+   }
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(AtomicBenchmarks, AtomicLoad, 1, 2, 4, 8)
+{
+   CoreFoundation::AtomicCFReference<CFDataRef> shared(makeConfig());
+
+   runOnThreads(state, [&]()
+   {
+      CoreFoundation::CFReference<CFDataRef> ref = shared.load();
+      CfxxBench::doNotOptimize(ref);
+   });
+}
+
+CFXX_BENCHMARK_ARGS(AtomicBenchmarks, MutexLoad, 1, 2, 4, 8)
+{
+   std::mutex mutex;
+   CoreFoundation::CFReference<CFDataRef> shared = makeConfig();
+
+   runOnThreads(state, [&]()
+   {
+      CoreFoundation::CFReference<CFDataRef> ref;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         ref = shared;
+      }
+      CfxxBench::doNotOptimize(ref);
+   });
+}
+
+// The same, with a writer replacing the object as fast as it can in the background.
+CFXX_BENCHMARK_ARGS(AtomicBenchmarks, AtomicLoadWhileStoring, 1, 2, 4, 8)
+{
+   CoreFoundation::AtomicCFReference<CFDataRef> shared(makeConfig());
+   std::atomic<bool> done(false);
+   std::thread writer([&]()
+   {
+      while (!done.load())
+         shared.store(makeConfig());
+   });
+
+   runOnThreads(state, [&]()
+   {
+      CoreFoundation::CFReference<CFDataRef> ref = shared.load();
+      CfxxBench::doNotOptimize(ref);
+   });
+
+   done.store(true);
+   writer.join();
+}
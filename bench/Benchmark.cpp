@@ -0,0 +1,349 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+#ifndef CFXX_BENCH_VERSION
+   #define CFXX_BENCH_VERSION "unknown"
+#endif
+
+namespace
+{
+
+std::atomic<int64_t> g_allocationCount(0);
+
+struct BenchmarkInfo
+{
+   std::string group;
+   std::string name;
+   CfxxBench::BenchmarkFunction function;
+   int64_t arg;
+   bool hasArg;
+
+   std::string fullName() const
+   {
+      std::string s = group + "." + name;
+      if (hasArg)
+         s += "/" + std::to_string(arg);
+      return s;
+   }
+};
+
+struct Result
+{
+   std::string name;
+   int64_t iterations;
+   double nsPerOp;
+   double bytesPerSecond;
+   double allocationsPerOp;
+};
+
+// Function-local so that registrations from other translation units can't run before
+// the registry has been constructed.
+std::vector<BenchmarkInfo>& registry()
+{
+   static std::vector<BenchmarkInfo> benchmarks;
+   return benchmarks;
+}
+
+//=================================
+// Counting CFAllocator
+//=================================
+
+void* countingAllocate(CFIndex size, CFOptionFlags, void*)
+{
+   g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+   return std::malloc(size);
+}
+
+void* countingReallocate(void* ptr, CFIndex newSize, CFOptionFlags, void*)
+{
+   g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+   return std::realloc(ptr, newSize);
+}
+
+void countingDeallocate(void* ptr, void*)
+{
+   std::free(ptr);
+}
+
+CFAllocatorRef countingAllocator()
+{
+   static CFAllocatorRef allocator = []() -> CFAllocatorRef
+   {
+      CFAllocatorContext context;
+      std::memset(&context, 0, sizeof(context));
+      context.allocate = &countingAllocate;
+      context.reallocate = &countingReallocate;
+      context.deallocate = &countingDeallocate;
+      return CFAllocatorCreate(kCFAllocatorSystemDefault, &context);
+   }();
+   return allocator;
+}
+
+//=================================
+// Runner
+//=================================
+
+Result runBenchmark(const BenchmarkInfo& info, double minTime)
+{
+   int64_t iterations = 1;
+
+   for (;;)
+   {
+      CfxxBench::State state(iterations, info.arg);
+
+      info.function(state);
+
+      const double elapsed = state.elapsedSeconds();
+      if (elapsed >= minTime || iterations >= (int64_t(1) << 40))
+      {
+         Result result;
+         result.name = info.fullName();
+         result.iterations = iterations;
+         result.nsPerOp = elapsed * 1e9 / iterations;
+         result.bytesPerSecond = (elapsed > 0) ? state.bytesProcessed() / elapsed : 0;
+         result.allocationsPerOp =
+            static_cast<double>(state.allocations()) / iterations;
+         return result;
+      }
+
+      // Aim a bit past the minimum time, but don't grow too fast from a noisy
+      // short measurement.
+      double multiplier = (elapsed > 0) ? (minTime * 1.4 / elapsed) : 100.0;
+      if (multiplier > 100.0)
+         multiplier = 100.0;
+      if (multiplier < 2.0)
+         multiplier = 2.0;
+      iterations = static_cast<int64_t>(iterations * multiplier);
+   }
+}
+
+std::string jsonEscape(const std::string& s)
+{
+   std::string escaped;
+   for (char c : s)
+   {
+      if (c == '"' || c == '\\')
+         escaped += '\\';
+      escaped += c;
+   }
+   return escaped;
+}
+
+bool writeJson(const std::string& path, const std::vector<Result>& results)
+{
+   std::ofstream out(path.c_str());
+   if (!out)
+      return false;
+
+   char timestamp[32];
+   const std::time_t now = std::time(nullptr);
+   std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+   out << "{\n";
+   out << "   \"version\": \"" << jsonEscape(CFXX_BENCH_VERSION) << "\",\n";
+   out << "   \"timestamp\": \"" << timestamp << "\",\n";
+   out << "   \"benchmarks\": [\n";
+   for (size_t i = 0; i < results.size(); ++i)
+   {
+      const Result& r = results[i];
+      out << "      { "
+          << "\"name\": \"" << jsonEscape(r.name) << "\", "
+          << "\"iterations\": " << r.iterations << ", "
+          << "\"ns_per_op\": " << r.nsPerOp << ", "
+          << "\"bytes_per_second\": " << r.bytesPerSecond << ", "
+          << "\"allocations_per_op\": " << r.allocationsPerOp
+          << " }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+   }
+   out << "   ]\n";
+   out << "}\n";
+   return static_cast<bool>(out);
+}
+
+void printUsage(const char* argv0)
+{
+   std::cerr
+      << "usage: " << argv0 << " [--filter=SUBSTRING] [--min-time=SECONDS] [--json=PATH] [--list]\n";
+}
+
+} // namespace
+
+//=================================
+// Allocation counting for operator new
+//=================================
+
+void* operator new(std::size_t size)
+{
+   g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+   if (void* p = std::malloc(size ? size : 1))
+      return p;
+   throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+   return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+   g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+   return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+   return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+   std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+   std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+   std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+   std::free(p);
+}
+
+namespace CfxxBench
+{
+
+Registration::Registration(const char* group, const char* name, BenchmarkFunction function)
+{
+   BenchmarkInfo info = { group, name, function, 0, false };
+   registry().push_back(info);
+}
+
+Registration::Registration(const char* group, const char* name, BenchmarkFunction function,
+   std::initializer_list<int64_t> args)
+{
+   for (int64_t arg : args)
+   {
+      BenchmarkInfo info = { group, name, function, arg, true };
+      registry().push_back(info);
+   }
+}
+
+int64_t allocationCount() noexcept
+{
+   return g_allocationCount.load(std::memory_order_relaxed);
+}
+
+void installCountingAllocator() noexcept
+{
+   CFAllocatorSetDefault(countingAllocator());
+}
+
+} // namespace CfxxBench
+
+int main(int argc, char** argv)
+{
+   std::string filter;
+   std::string jsonPath;
+   double minTime = 0.2;
+   bool listOnly = false;
+
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      if (arg.compare(0, 9, "--filter=") == 0)
+         filter = arg.substr(9);
+      else if (arg.compare(0, 11, "--min-time=") == 0)
+         minTime = std::atof(arg.c_str() + 11);
+      else if (arg.compare(0, 7, "--json=") == 0)
+         jsonPath = arg.substr(7);
+      else if (arg == "--list")
+         listOnly = true;
+      else
+      {
+         printUsage(argv[0]);
+         return 1;
+      }
+   }
+
+   CfxxBench::installCountingAllocator();
+
+   std::vector<Result> results;
+
+   if (!listOnly)
+   {
+      std::printf("%-56s %14s %14s %14s %12s\n",
+         "benchmark", "iterations", "ns/op", "MB/s", "allocs/op");
+   }
+
+   for (const BenchmarkInfo& info : registry())
+   {
+      const std::string name = info.fullName();
+      if (!filter.empty() && name.find(filter) == std::string::npos)
+         continue;
+
+      if (listOnly)
+      {
+         std::printf("%s\n", name.c_str());
+         continue;
+      }
+
+      const Result result = runBenchmark(info, minTime);
+      results.push_back(result);
+
+      std::printf("%-56s %14lld %14.2f %14.2f %12.2f\n",
+         result.name.c_str(),
+         static_cast<long long>(result.iterations),
+         result.nsPerOp,
+         result.bytesPerSecond / (1024.0 * 1024.0),
+         result.allocationsPerOp);
+      std::fflush(stdout);
+   }
+
+   if (!jsonPath.empty() && !writeJson(jsonPath, results))
+   {
+      std::fprintf(stderr, "failed to write %s\n", jsonPath.c_str());
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_bench_h__
+#define __cfxx_bench_h__
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// A deliberately tiny microbenchmark harness, in the spirit of gtest's TEST() macro.
+//
+//    CFXX_BENCHMARK(StringBenchmarks, Copy)
+//    {
+//       CoreFoundation::String s = "foobar";
+//       while (state.keepRunning())
+//       {
+//          CoreFoundation::String copy(s);
+//          CfxxBench::doNotOptimize(copy);
+//       }
+//    }
+//
+// Each benchmark is run repeatedly with a growing iteration count until it runs for at
+// least the minimum measurement time; the final run is what gets reported (ns/op, bytes/s
+// and allocations/op).
+namespace CfxxBench
+{
+
+// Number of heap allocations made so far by this process. This counts C++ operator new
+// and every allocation made through the default CFAllocator (the benchmark runner
+// installs a counting allocator as the default at startup).
+int64_t allocationCount() noexcept;
+
+class State
+{
+public:
+   inline State(int64_t iterations, int64_t arg) noexcept :
+      m_iterations(iterations),
+      m_remaining(iterations),
+      m_arg(arg),
+      m_bytesProcessed(0),
+      m_started(false),
+      m_allocationsBegin(0),
+      m_allocationsEnd(0)
+   { }
+
+   // Drives the timed loop. Timing (and allocation counting) starts on the first call
+   // and stops once the requested number of iterations have been run, so setup before
+   // the loop isn't measured.
+   inline bool keepRunning() noexcept
+   {
+      if (!m_started)
+      {
+         m_started = true;
+         m_allocationsBegin = allocationCount();
+         m_begin = std::chrono::steady_clock::now();
+      }
+
+      if (m_remaining > 0)
+      {
+         --m_remaining;
+         return true;
+      }
+
+      m_end = std::chrono::steady_clock::now();
+      m_allocationsEnd = allocationCount();
+      return false;
+   }
+
+   inline int64_t iterations() const noexcept
+   {
+      return m_iterations;
+   }
+
+   // The argument this benchmark was registered with (see CFXX_BENCHMARK_ARGS), or 0.
+   inline int64_t arg() const noexcept
+   {
+      return m_arg;
+   }
+
+   // Total number of bytes processed across *all* iterations; used to report bytes/s.
+   inline void setBytesProcessed(int64_t bytes) noexcept
+   {
+      m_bytesProcessed = bytes;
+   }
+
+   inline int64_t bytesProcessed() const noexcept
+   {
+      return m_bytesProcessed;
+   }
+
+   inline double elapsedSeconds() const noexcept
+   {
+      return std::chrono::duration<double>(m_end - m_begin).count();
+   }
+
+   // Allocations made during the timed loop.
+   inline int64_t allocations() const noexcept
+   {
+      return m_allocationsEnd - m_allocationsBegin;
+   }
+
+private:
+   int64_t m_iterations;
+   int64_t m_remaining;
+   int64_t m_arg;
+   int64_t m_bytesProcessed;
+   bool m_started;
+   int64_t m_allocationsBegin;
+   int64_t m_allocationsEnd;
+   std::chrono::steady_clock::time_point m_begin;
+   std::chrono::steady_clock::time_point m_end;
+};
+
+typedef void (*BenchmarkFunction)(State&);
+
+// Adds a benchmark to the global registry; used by the CFXX_BENCHMARK macros.
+struct Registration
+{
+   Registration(const char* group, const char* name, BenchmarkFunction function);
+   Registration(const char* group, const char* name, BenchmarkFunction function,
+      std::initializer_list<int64_t> args);
+};
+
+// CFAllocatorSetDefault only affects the calling thread, so benchmarks that spin up
+// their own threads need to call this on each of them to have their allocations counted.
+void installCountingAllocator() noexcept;
+
+// Keep the compiler from optimizing away a computed value.
+template<typename T>
+inline void doNotOptimize(const T& value) noexcept
+{
+   asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Force all pending writes to memory to be considered observable.
+inline void clobberMemory() noexcept
+{
+   asm volatile("" : : : "memory");
+}
+
+} // namespace CfxxBench
+
+#define CFXX_BENCHMARK_FUNCTION_NAME(group, name) group##_##name##_Benchmark
+
+// Define a benchmark that is run once.
+#define CFXX_BENCHMARK(group, name) \
+   static void CFXX_BENCHMARK_FUNCTION_NAME(group, name)(::CfxxBench::State& state); \
+   static ::CfxxBench::Registration group##_##name##_Registration( \
+      #group, #name, &CFXX_BENCHMARK_FUNCTION_NAME(group, name)); \
+   static void CFXX_BENCHMARK_FUNCTION_NAME(group, name)(::CfxxBench::State& state)
+
+// Define a benchmark that is run once for each of the given arguments (usually sizes),
+// available inside the benchmark as state.arg().
+#define CFXX_BENCHMARK_ARGS(group, name, ...) \
+   static void CFXX_BENCHMARK_FUNCTION_NAME(group, name)(::CfxxBench::State& state); \
+   static ::CfxxBench::Registration group##_##name##_Registration( \
+      #group, #name, &CFXX_BENCHMARK_FUNCTION_NAME(group, name), { __VA_ARGS__ }); \
+   static void CFXX_BENCHMARK_FUNCTION_NAME(group, name)(::CfxxBench::State& state)
+
+#endif // __cfxx_bench_h__
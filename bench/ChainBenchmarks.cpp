@@ -0,0 +1,79 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <vector>
+
+// Assembling a response out of many pieces that already exist as Data: copying them all
+// into one MutableData, versus chaining them and handing writev() the segments.
+// The argument is the size of each piece.
+
+namespace
+{
+
+const int kPiecesPerResponse = 64;
+
+std::vector<CoreFoundation::Data> makePieces(int64_t size)
+{
+   const std::vector<UInt8> bytes(static_cast<size_t>(size), 'x');
+   std::vector<CoreFoundation::Data> pieces;
+   for (int i = 0; i < kPiecesPerResponse; ++i)
+      pieces.push_back(CoreFoundation::Data(bytes.data(), static_cast<CFIndex>(size)));
+   return pieces;
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(ChainBenchmarks, MutableDataAppend, 64, 4096)
+{
+   const std::vector<CoreFoundation::Data> pieces = makePieces(state.arg());
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData response;
+      for (const CoreFoundation::Data& piece : pieces)
+         response.append(piece);
+      CfxxBench::doNotOptimize(response.data());
+   }
+
+   state.setBytesProcessed(state.iterations() * kPiecesPerResponse * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(ChainBenchmarks, DataChainAppend, 64, 4096)
+{
+   const std::vector<CoreFoundation::Data> pieces = makePieces(state.arg());
+   std::vector<iovec> vecs(kPiecesPerResponse);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::DataChain response;
+      for (const CoreFoundation::Data& piece : pieces)
+         response.append(piece);
+      CfxxBench::doNotOptimize(response.iovecs(vecs.data(), vecs.size()));
+   }
+
+   state.setBytesProcessed(state.iterations() * kPiecesPerResponse * state.arg());
+}
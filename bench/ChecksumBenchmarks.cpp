@@ -0,0 +1,85 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <vector>
+
+// Checksumming and content-hashing a Data in place, against CFHash() on the same data.
+// The argument is the size of the data. The CRC32C instructions are only used when the
+// benchmarks are built for a target that has them (e.g. with -msse4.2).
+
+namespace
+{
+
+CoreFoundation::Data makeData(int64_t size)
+{
+   std::vector<UInt8> bytes(static_cast<size_t>(size));
+   for (size_t i = 0; i < bytes.size(); ++i)
+      bytes[i] = static_cast<UInt8>(i * 31 + 7);
+   return CoreFoundation::Data(bytes.data(), static_cast<CFIndex>(bytes.size()));
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(ChecksumBenchmarks, Crc32c, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::crc32c(data));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(ChecksumBenchmarks, Crc32cScalar, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::Detail::crc32cScalar(~0u, data.data(), static_cast<size_t>(data.size())));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(ChecksumBenchmarks, XXHash64, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::xxhash64(data));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(ChecksumBenchmarks, RawCFHash, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CFHash(static_cast<CFDataRef>(data)));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
@@ -0,0 +1,353 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+// Every append benchmark builds a payload out of this many chunks of state.arg() bytes.
+const int kChunksPerPayload = 64;
+
+std::vector<UInt8> makeChunk(int64_t size)
+{
+   std::vector<UInt8> chunk(static_cast<size_t>(size));
+   for (size_t i = 0; i < chunk.size(); ++i)
+      chunk[i] = static_cast<UInt8>(i * 31);
+   return chunk;
+}
+
+// A scratch file of the given size, removed again when the benchmark finishes.
+class ScratchFile
+{
+public:
+   explicit ScratchFile(int64_t size)
+   {
+      char path[] = "/tmp/cfxx-bench-XXXXXX";
+      int fd = ::mkstemp(path);
+      const std::vector<UInt8> chunk = makeChunk(65536);
+      for (int64_t written = 0; written < size; written += static_cast<int64_t>(chunk.size()))
+      {
+         if (::write(fd, chunk.data(), chunk.size()) < 0)
+            break;
+      }
+      ::close(fd);
+      m_path = path;
+   }
+
+   ~ScratchFile()
+   {
+      std::remove(m_path.c_str());
+   }
+
+   const std::string& path() const
+   {
+      return m_path;
+   }
+
+private:
+   std::string m_path;
+};
+
+// Reads one byte out of every 'stride' bytes, standing in for a reader that only
+// looks at part of an asset.
+UInt64 touchBytes(const UInt8* bytes, size_t length, size_t stride)
+{
+   UInt64 sum = 0;
+   for (size_t i = 0; i < length; i += stride)
+      sum += bytes[i];
+   return sum;
+}
+
+} // namespace
+
+//=================================
+// Appending
+//=================================
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, MutableDataAppend, 1, 16, 256, 4096)
+{
+   const std::vector<UInt8> chunk = makeChunk(state.arg());
+   const CoreFoundation::Data empty(nullptr, 0);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData payload(empty);
+      for (int i = 0; i < kChunksPerPayload; ++i)
+         payload.append(chunk.data(), chunk.size());
+      CfxxBench::doNotOptimize(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * kChunksPerPayload * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, RawDataAppendBytes, 1, 16, 256, 4096)
+{
+   const std::vector<UInt8> chunk = makeChunk(state.arg());
+
+   while (state.keepRunning())
+   {
+      CFMutableDataRef payload = CFDataCreateMutable(kCFAllocatorDefault, 0);
+      for (int i = 0; i < kChunksPerPayload; ++i)
+         CFDataAppendBytes(payload, chunk.data(), static_cast<CFIndex>(chunk.size()));
+      CfxxBench::doNotOptimize(payload);
+      CFRelease(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * kChunksPerPayload * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, StdVectorInsert, 1, 16, 256, 4096)
+{
+   const std::vector<UInt8> chunk = makeChunk(state.arg());
+
+   while (state.keepRunning())
+   {
+      std::vector<UInt8> payload;
+      for (int i = 0; i < kChunksPerPayload; ++i)
+         payload.insert(payload.end(), chunk.begin(), chunk.end());
+      CfxxBench::doNotOptimize(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * kChunksPerPayload * state.arg());
+}
+
+// Building a payload a byte at a time, with and without reserving up front.
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, MutableDataPushBack, 4096, 1 << 20)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData payload;
+      for (int64_t i = 0; i < state.arg(); ++i)
+         payload.push_back(static_cast<UInt8>(i));
+      CfxxBench::doNotOptimize(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, MutableDataPushBackReserved, 4096, 1 << 20)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData payload = CoreFoundation::MutableData::with_capacity(state.arg());
+      for (int64_t i = 0; i < state.arg(); ++i)
+         payload.push_back(static_cast<UInt8>(i));
+      CfxxBench::doNotOptimize(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, RawDataAppendByte, 4096, 1 << 20)
+{
+   while (state.keepRunning())
+   {
+      CFMutableDataRef payload = CFDataCreateMutable(kCFAllocatorDefault, 0);
+      for (int64_t i = 0; i < state.arg(); ++i)
+      {
+         const UInt8 byte = static_cast<UInt8>(i);
+         CFDataAppendBytes(payload, &byte, 1);
+      }
+      CfxxBench::doNotOptimize(payload);
+      CFRelease(payload);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+//=================================
+// Construction
+//=================================
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, DataConstruct, 16, 4096, 65536)
+{
+   const std::vector<UInt8> bytes = makeChunk(state.arg());
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data data(bytes.data(), static_cast<CFIndex>(bytes.size()));
+      CfxxBench::doNotOptimize(data);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, RawDataCreate, 16, 4096, 65536)
+{
+   const std::vector<UInt8> bytes = makeChunk(state.arg());
+
+   while (state.keepRunning())
+   {
+      CFDataRef data = CFDataCreate(kCFAllocatorDefault, bytes.data(), static_cast<CFIndex>(bytes.size()));
+      CfxxBench::doNotOptimize(data);
+      CFRelease(data);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, StdVectorConstruct, 16, 4096, 65536)
+{
+   const std::vector<UInt8> bytes = makeChunk(state.arg());
+
+   while (state.keepRunning())
+   {
+      std::vector<UInt8> copy(bytes);
+      CfxxBench::doNotOptimize(copy);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+//=================================
+// Loading files
+//
+// state.arg() is the file size in MiB; each iteration opens the file and reads
+// one byte per 1 MiB of it.
+//=================================
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, MapFile, 1, 16, 256)
+{
+   const int64_t size = state.arg() << 20;
+   ScratchFile file(size);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data data = CoreFoundation::Data::map_file(file.path());
+      CfxxBench::doNotOptimize(touchBytes(data.data(), static_cast<size_t>(data.size()), 1 << 20));
+   }
+
+   state.setBytesProcessed(state.iterations() * size);
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, ReadFileIntoData, 1, 16, 256)
+{
+   const int64_t size = state.arg() << 20;
+   ScratchFile file(size);
+
+   while (state.keepRunning())
+   {
+      std::vector<UInt8> buffer(static_cast<size_t>(size));
+      int fd = ::open(file.path().c_str(), O_RDONLY);
+      size_t done = 0;
+      while (done < buffer.size())
+      {
+         ssize_t n = ::read(fd, buffer.data() + done, buffer.size() - done);
+         if (n <= 0)
+            break;
+         done += static_cast<size_t>(n);
+      }
+      ::close(fd);
+
+      CoreFoundation::Data data(buffer.data(), static_cast<CFIndex>(done));
+      CfxxBench::doNotOptimize(touchBytes(data.data(), static_cast<size_t>(data.size()), 1 << 20));
+   }
+
+   state.setBytesProcessed(state.iterations() * size);
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, ReadFile, 1, 16, 256)
+{
+   const int64_t size = state.arg() << 20;
+   ScratchFile file(size);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data data = CoreFoundation::Data::read_file(file.path());
+      CfxxBench::doNotOptimize(touchBytes(data.data(), static_cast<size_t>(data.size()), 1 << 20));
+   }
+
+   state.setBytesProcessed(state.iterations() * size);
+}
+
+//=================================
+// Slicing
+//=================================
+
+// Cutting a 64 KiB buffer into fields of state.arg() bytes each.
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, DataSlice, 16, 1024)
+{
+   const std::vector<UInt8> bytes = makeChunk(65536);
+   const CoreFoundation::Data buffer(bytes.data(), static_cast<CFIndex>(bytes.size()));
+   const CFIndex fields = buffer.size() / state.arg();
+
+   while (state.keepRunning())
+   {
+      for (CFIndex i = 0; i < fields; ++i)
+      {
+         CoreFoundation::Data field = buffer.slice(i * state.arg(), state.arg());
+         CfxxBench::doNotOptimize(field);
+      }
+   }
+
+   state.setBytesProcessed(state.iterations() * buffer.size());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, DataCopyRange, 16, 1024)
+{
+   const std::vector<UInt8> bytes = makeChunk(65536);
+   const CoreFoundation::Data buffer(bytes.data(), static_cast<CFIndex>(bytes.size()));
+   const CFIndex fields = buffer.size() / state.arg();
+
+   while (state.keepRunning())
+   {
+      for (CFIndex i = 0; i < fields; ++i)
+      {
+         CoreFoundation::Data field(buffer.data() + i * state.arg(), state.arg());
+         CfxxBench::doNotOptimize(field);
+      }
+   }
+
+   state.setBytesProcessed(state.iterations() * buffer.size());
+}
+
+CFXX_BENCHMARK_ARGS(DataBenchmarks, DataViewSubview, 16, 1024)
+{
+   const std::vector<UInt8> bytes = makeChunk(65536);
+   const CoreFoundation::Data buffer(bytes.data(), static_cast<CFIndex>(bytes.size()));
+   const CoreFoundation::DataView view = buffer;
+   const CFIndex fields = view.size() / state.arg();
+
+   while (state.keepRunning())
+   {
+      for (CFIndex i = 0; i < fields; ++i)
+      {
+         CoreFoundation::DataView field = view.subview(i * state.arg(), state.arg());
+         CfxxBench::doNotOptimize(field);
+      }
+   }
+
+   state.setBytesProcessed(state.iterations() * view.size());
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <string>
+#include <vector>
+
+// Base64 and hex between Data and String: encoding and decoding straight into the buffer
+// the result takes over, versus the usual route of a std::string built up by a scalar
+// loop and then copied into a String (or Data). The argument is the size of the data.
+// The vector kernels are only used when the benchmarks are built for a target that has
+// them (e.g. with -mssse3).
+
+namespace
+{
+
+CoreFoundation::Data makeData(int64_t size)
+{
+   std::vector<UInt8> bytes(static_cast<size_t>(size));
+   UInt32 state = 2463534242u;
+   for (size_t i = 0; i < bytes.size(); ++i)
+   {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      bytes[i] = static_cast<UInt8>(state);
+   }
+   return CoreFoundation::Data(bytes.data(), static_cast<CFIndex>(bytes.size()));
+}
+
+std::string stdStringBase64(const CoreFoundation::Data& data)
+{
+   static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+   std::string out;
+   UInt32 bits = 0;
+   int count = 0;
+   for (UInt8 b : data)
+   {
+      bits = (bits << 8) | b;
+      count += 8;
+      while (count >= 6)
+      {
+         count -= 6;
+         out.push_back(alphabet[(bits >> count) & 0x3F]);
+      }
+   }
+   if (count > 0)
+      out.push_back(alphabet[(bits << (6 - count)) & 0x3F]);
+   while (out.size() % 4 != 0)
+      out.push_back('=');
+   return out;
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, Base64Encode, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.to_base64());
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, StdStringBase64Encode, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::String(stdStringBase64(data), kCFStringEncodingASCII));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, Base64Decode, 64, 4096, 1048576)
+{
+   const CoreFoundation::String encoded(stdStringBase64(makeData(state.arg())), kCFStringEncodingASCII);
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::Data::from_base64(encoded));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, StdStringBase64Decode, 64, 4096, 1048576)
+{
+   const CoreFoundation::String encoded(stdStringBase64(makeData(state.arg())), kCFStringEncodingASCII);
+
+   while (state.keepRunning())
+   {
+      const std::string text = encoded.to_string();
+      std::vector<UInt8> bytes;
+      UInt32 bits = 0;
+      int count = 0;
+      for (char c : text)
+      {
+         int value;
+         if (c >= 'A' && c <= 'Z')      value = c - 'A';
+         else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+         else if (c >= '0' && c <= '9') value = c - '0' + 52;
+         else if (c == '+')             value = 62;
+         else if (c == '/')             value = 63;
+         else                           break;
+         bits = (bits << 6) | static_cast<UInt32>(value);
+         count += 6;
+         if (count >= 8)
+         {
+            count -= 8;
+            bytes.push_back(static_cast<UInt8>(bits >> count));
+         }
+      }
+      CfxxBench::doNotOptimize(CoreFoundation::Data(bytes.data(), static_cast<CFIndex>(bytes.size())));
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, HexEncode, 64, 4096, 1048576)
+{
+   const CoreFoundation::Data data = makeData(state.arg());
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.to_hex());
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(EncodingBenchmarks, HexDecode, 64, 4096, 1048576)
+{
+   const CoreFoundation::String encoded = makeData(state.arg()).to_hex();
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CoreFoundation::Data::from_hex(encoded));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
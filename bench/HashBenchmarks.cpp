@@ -0,0 +1,174 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Lookups of state.arg() distinct keys in tables holding those keys. The query keys are
+// separate objects from the ones in the table, as they would be when parsed out of a
+// request.
+
+namespace
+{
+
+std::vector<std::string> makeKeys(int64_t count)
+{
+   std::vector<std::string> keys;
+   for (int64_t i = 0; i < count; ++i)
+      keys.push_back("x-request-field-" + std::to_string(i));
+   return keys;
+}
+
+std::vector<CoreFoundation::String> makeStrings(const std::vector<std::string>& keys)
+{
+   std::vector<CoreFoundation::String> strings;
+   for (size_t i = 0; i < keys.size(); ++i)
+      strings.push_back(CoreFoundation::String(keys[i]));
+   return strings;
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(HashBenchmarks, CFHashMapLookup, 16, 1024, 65536)
+{
+   const std::vector<std::string> keys = makeKeys(state.arg());
+   const std::vector<CoreFoundation::String> stored = makeStrings(keys);
+   const std::vector<CoreFoundation::String> queries = makeStrings(keys);
+
+   CoreFoundation::CFHashMap<CoreFoundation::String, int> map;
+   for (size_t i = 0; i < stored.size(); ++i)
+      map[stored[i]] = static_cast<int>(i);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CfxxBench::doNotOptimize(map.find(queries[i])->second);
+      i = (i + 1) % queries.size();
+   }
+}
+
+CFXX_BENCHMARK_ARGS(HashBenchmarks, UnorderedMapStringLookup, 16, 1024, 65536)
+{
+   const std::vector<std::string> keys = makeKeys(state.arg());
+   const std::vector<CoreFoundation::String> stored = makeStrings(keys);
+   const std::vector<CoreFoundation::String> queries = makeStrings(keys);
+
+   std::unordered_map<CoreFoundation::String, int> map;
+   for (size_t i = 0; i < stored.size(); ++i)
+      map[stored[i]] = static_cast<int>(i);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CfxxBench::doNotOptimize(map.find(queries[i])->second);
+      i = (i + 1) % queries.size();
+   }
+}
+
+// What we used to do: convert the key to a std::string first.
+CFXX_BENCHMARK_ARGS(HashBenchmarks, UnorderedMapStdStringLookupConverted, 16, 1024, 65536)
+{
+   const std::vector<std::string> keys = makeKeys(state.arg());
+   const std::vector<CoreFoundation::String> queries = makeStrings(keys);
+
+   std::unordered_map<std::string, int> map;
+   for (size_t i = 0; i < keys.size(); ++i)
+      map[keys[i]] = static_cast<int>(i);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CfxxBench::doNotOptimize(map.find(queries[i].to_string())->second);
+      i = (i + 1) % queries.size();
+   }
+}
+
+// The best case for std::string: keys that are already std::strings.
+CFXX_BENCHMARK_ARGS(HashBenchmarks, UnorderedMapStdStringLookup, 16, 1024, 65536)
+{
+   const std::vector<std::string> keys = makeKeys(state.arg());
+   const std::vector<std::string> queries(keys);
+
+   std::unordered_map<std::string, int> map;
+   for (size_t i = 0; i < keys.size(); ++i)
+      map[keys[i]] = static_cast<int>(i);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CfxxBench::doNotOptimize(map.find(queries[i])->second);
+      i = (i + 1) % queries.size();
+   }
+}
+
+CFXX_BENCHMARK_ARGS(HashBenchmarks, CFDictionaryLookup, 16, 1024, 65536)
+{
+   const std::vector<std::string> keys = makeKeys(state.arg());
+   const std::vector<CoreFoundation::String> stored = makeStrings(keys);
+   const std::vector<CoreFoundation::String> queries = makeStrings(keys);
+
+   CFMutableDictionaryRef dict = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+      &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+   for (size_t i = 0; i < stored.size(); ++i)
+      CFDictionarySetValue(dict, stored[i], stored[i]);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CfxxBench::doNotOptimize(CFDictionaryGetValue(dict, queries[i]));
+      i = (i + 1) % queries.size();
+   }
+
+   CFRelease(dict);
+}
+
+CFXX_BENCHMARK_ARGS(HashBenchmarks, CFHashMapInsert, 16, 1024, 65536)
+{
+   const std::vector<CoreFoundation::String> keys = makeStrings(makeKeys(state.arg()));
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::CFHashMap<CoreFoundation::String, int> map;
+      for (size_t i = 0; i < keys.size(); ++i)
+         map[keys[i]] = static_cast<int>(i);
+      CfxxBench::doNotOptimize(map);
+   }
+}
+
+CFXX_BENCHMARK_ARGS(HashBenchmarks, UnorderedMapInsert, 16, 1024, 65536)
+{
+   const std::vector<CoreFoundation::String> keys = makeStrings(makeKeys(state.arg()));
+
+   while (state.keepRunning())
+   {
+      std::unordered_map<CoreFoundation::String, int> map;
+      for (size_t i = 0; i < keys.size(); ++i)
+         map[keys[i]] = static_cast<int>(i);
+      CfxxBench::doNotOptimize(map);
+   }
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kKeyCount = 1000;
+
+std::vector<std::string> makeKeys()
+{
+   std::vector<std::string> keys;
+   for (int i = 0; i < kKeyCount; ++i)
+      keys.push_back("x-header-field-" + std::to_string(i));
+   return keys;
+}
+
+} // namespace
+
+//=================================
+// Comparing
+//=================================
+
+CFXX_BENCHMARK(InternBenchmarks, EqualSeparateObjects)
+{
+   const CoreFoundation::String a("x-header-field-name");
+   const CoreFoundation::String b("x-header-field-name");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(a == b);
+}
+
+CFXX_BENCHMARK(InternBenchmarks, EqualInterned)
+{
+   CoreFoundation::StringInternPool pool;
+   const CoreFoundation::String a = pool.intern("x-header-field-name");
+   const CoreFoundation::String b = pool.intern(CoreFoundation::String("x-header-field-name"));
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(a == b);
+}
+
+//=================================
+// Interning
+//=================================
+
+CFXX_BENCHMARK(InternBenchmarks, InternExisting)
+{
+   CoreFoundation::StringInternPool pool;
+   const std::vector<std::string> keys = makeKeys();
+   for (size_t i = 0; i < keys.size(); ++i)
+      pool.intern(keys[i]);
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CoreFoundation::String s = pool.intern(keys[i]);
+      CfxxBench::doNotOptimize(s);
+      i = (i + 1) % keys.size();
+   }
+}
+
+CFXX_BENCHMARK(InternBenchmarks, ConstructWithoutInterning)
+{
+   const std::vector<std::string> keys = makeKeys();
+
+   size_t i = 0;
+   while (state.keepRunning())
+   {
+      CoreFoundation::String s(keys[i]);
+      CfxxBench::doNotOptimize(s);
+      i = (i + 1) % keys.size();
+   }
+}
+
+// state.arg() threads each intern every key once per iteration; with no contention the
+// time per iteration would stay flat as threads are added.
+CFXX_BENCHMARK_ARGS(InternBenchmarks, InternConcurrent, 1, 2, 4, 8)
+{
+   CoreFoundation::StringInternPool pool;
+   const std::vector<std::string> keys = makeKeys();
+   const int threadCount = static_cast<int>(state.arg());
+
+   while (state.keepRunning())
+   {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < threadCount; ++t)
+      {
+         threads.emplace_back([&pool, &keys, t]() {
+            CfxxBench::installCountingAllocator();
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+               CoreFoundation::String s = pool.intern(keys[(i + t * 97) % keys.size()]);
+               CfxxBench::doNotOptimize(s);
+            }
+         });
+      }
+      for (size_t t = 0; t < threads.size(); ++t)
+         threads[t].join();
+   }
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <cstdio>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Loading a directory's worth of small files, the way an application does at startup:
+// one after the other with Data::read_file(), versus all at once on a DataLoader.
+// The argument is the DataLoader's thread count.
+
+namespace
+{
+
+const int kFileCount = 512;
+const size_t kFileSize = 4096;
+
+// Scratch files, removed again when the benchmark finishes.
+class ScratchFiles
+{
+public:
+   ScratchFiles()
+   {
+      const std::vector<UInt8> contents(kFileSize, 'x');
+      for (int i = 0; i < kFileCount; ++i)
+      {
+         char path[] = "/tmp/cfxx-bench-XXXXXX";
+         int fd = ::mkstemp(path);
+         if (::write(fd, contents.data(), contents.size()) < 0)
+            break;
+         ::close(fd);
+         m_paths.push_back(path);
+      }
+   }
+
+   ~ScratchFiles()
+   {
+      for (const std::string& path : m_paths)
+         std::remove(path.c_str());
+   }
+
+   const std::vector<std::string>& paths() const
+   {
+      return m_paths;
+   }
+
+private:
+   std::vector<std::string> m_paths;
+};
+
+} // namespace
+
+CFXX_BENCHMARK(LoaderBenchmarks, ReadFilesSerially)
+{
+   ScratchFiles files;
+
+   while (state.keepRunning())
+   {
+      for (const std::string& path : files.paths())
+         CfxxBench::doNotOptimize(CoreFoundation::Data::read_file(path));
+   }
+
+   state.setBytesProcessed(state.iterations() * kFileCount * kFileSize);
+}
+
+CFXX_BENCHMARK_ARGS(LoaderBenchmarks, DataLoader, 1, 2, 4, 8)
+{
+   ScratchFiles files;
+   CoreFoundation::DataLoaderOptions options;
+   options.thread_count = static_cast<size_t>(state.arg());
+   CoreFoundation::DataLoader loader(options);
+
+   while (state.keepRunning())
+   {
+      std::vector<std::future<CoreFoundation::Data>> results = loader.load(files.paths());
+      for (std::future<CoreFoundation::Data>& result : results)
+         CfxxBench::doNotOptimize(result.get());
+   }
+
+   state.setBytesProcessed(state.iterations() * kFileCount * kFileSize);
+}
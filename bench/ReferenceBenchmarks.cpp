@@ -0,0 +1,139 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <memory>
+#include <string>
+
+// Copying a CFReference should cost exactly what a bare CFRetain/CFRelease pair does.
+
+CFXX_BENCHMARK(ReferenceBenchmarks, CFReferenceCopy)
+{
+   const CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithCString(kCFAllocatorDefault, "foobar", kCFStringEncodingUTF8));
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::CFReference<CFStringRef> copy(ref);
+      CfxxBench::doNotOptimize(copy);
+   }
+}
+
+CFXX_BENCHMARK(ReferenceBenchmarks, CFReferenceMove)
+{
+   CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithCString(kCFAllocatorDefault, "foobar", kCFStringEncodingUTF8));
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::CFReference<CFStringRef> moved(std::move(ref));
+      ref = std::move(moved);
+      CfxxBench::doNotOptimize(ref);
+   }
+}
+
+CFXX_BENCHMARK(ReferenceBenchmarks, RawRetainRelease)
+{
+   CFStringRef ref = CFStringCreateWithCString(kCFAllocatorDefault, "foobar", kCFStringEncodingUTF8);
+
+   while (state.keepRunning())
+   {
+      CFRetain(ref);
+      CfxxBench::doNotOptimize(ref);
+      CFRelease(ref);
+   }
+
+   CFRelease(ref);
+}
+
+CFXX_BENCHMARK(ReferenceBenchmarks, SharedPtrCopy)
+{
+   const std::shared_ptr<std::string> ptr = std::make_shared<std::string>("foobar");
+
+   while (state.keepRunning())
+   {
+      std::shared_ptr<std::string> copy(ptr);
+      CfxxBench::doNotOptimize(copy);
+   }
+}
+
+// Creating a brand new object from scratch, which is where adopt-vs-retain shows up.
+
+CFXX_BENCHMARK(ReferenceBenchmarks, CFReferenceFromCreate)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::CFReference<CFDataRef> ref =
+         CoreFoundation::makeCFReferenceFromCopyOrCreate(
+            CFDataCreate(kCFAllocatorDefault, nullptr, 0));
+      CfxxBench::doNotOptimize(ref);
+   }
+}
+
+CFXX_BENCHMARK(ReferenceBenchmarks, RawCreateRelease)
+{
+   while (state.keepRunning())
+   {
+      CFDataRef ref = CFDataCreate(kCFAllocatorDefault, nullptr, 0);
+      CfxxBench::doNotOptimize(ref);
+      CFRelease(ref);
+   }
+}
+
+// Passing an object we don't own into a wrapper API: wrapping it in a String costs a
+// retain/release pair, borrowing it costs nothing.
+
+CFXX_BENCHMARK(ReferenceBenchmarks, AppendWrapped)
+{
+   CFStringRef ref = CFStringCreateWithCString(kCFAllocatorDefault, "x", kCFStringEncodingUTF8);
+   CoreFoundation::MutableString s(kCFAllocatorDefault);
+
+   while (state.keepRunning())
+   {
+      s.append(CoreFoundation::String(ref));
+      if (s.size() > 4096)
+         s = CoreFoundation::MutableString(kCFAllocatorDefault);
+   }
+
+   CFRelease(ref);
+}
+
+CFXX_BENCHMARK(ReferenceBenchmarks, AppendBorrowed)
+{
+   CFStringRef ref = CFStringCreateWithCString(kCFAllocatorDefault, "x", kCFStringEncodingUTF8);
+   CoreFoundation::MutableString s(kCFAllocatorDefault);
+
+   while (state.keepRunning())
+   {
+      s.append(CoreFoundation::CFBorrowed<CFStringRef>(ref));
+      if (s.size() > 4096)
+         s = CoreFoundation::MutableString(kCFAllocatorDefault);
+   }
+
+   CFRelease(ref);
+}
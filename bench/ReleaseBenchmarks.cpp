@@ -0,0 +1,85 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <vector>
+
+// Dropping the last reference to a large object: inline, that's a free() of the whole
+// buffer on the calling thread; with DeferredRelease it's a push onto the thread's queue
+// and the free happens on the reclaimer. (That only pays off with a core to spare for
+// the reclaimer; on a single core it is pure overhead.)
+
+namespace
+{
+
+CoreFoundation::DeferredReleaseOptions benchmarkOptions()
+{
+   CoreFoundation::DeferredReleaseOptions options;
+   options.backpressure = CoreFoundation::ReleaseBackpressure::Wait;
+   return options;
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(ReleaseBenchmarks, InlineRelease, 4096, 1 << 20)
+{
+   const std::vector<UInt8> bytes(static_cast<size_t>(state.arg()), 0x2a);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data data(bytes.data(), bytes.size());
+      CfxxBench::doNotOptimize(data);
+   }
+}
+
+CFXX_BENCHMARK_ARGS(ReleaseBenchmarks, DeferredRelease, 4096, 1 << 20)
+{
+   const std::vector<UInt8> bytes(static_cast<size_t>(state.arg()), 0x2a);
+   CoreFoundation::DeferredRelease::enable(benchmarkOptions());
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data data(bytes.data(), bytes.size());
+      CfxxBench::doNotOptimize(data);
+   }
+
+   CoreFoundation::DeferredRelease::disable();
+}
+
+// The cost the hook adds to releases that aren't the last reference.
+CFXX_BENCHMARK(ReleaseBenchmarks, DeferredCopy)
+{
+   const CoreFoundation::Data data(reinterpret_cast<const UInt8*>("foobar"), 6);
+   CoreFoundation::DeferredRelease::enable(benchmarkOptions());
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::Data copy(data);
+      CfxxBench::doNotOptimize(copy);
+   }
+
+   CoreFoundation::DeferredRelease::disable();
+}
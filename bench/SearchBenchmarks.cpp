@@ -0,0 +1,165 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Searching and splitting a Data in place, against std::search and std::find on the same
+// bytes. The argument is the size of the data, from 1 KiB to 1 GiB. The data is lowercase
+// letters in lines of 80, and whatever is being looked for is only at the very end (or
+// for the rfind()s, the very start), so every search runs over all of it.
+
+namespace
+{
+
+// Eight bytes, or 48; the "|" is never in the text, and sits right after the first and
+// last bytes, so neither can be used to rule out a partial match early.
+const char kShortPattern[] = "z|yxwvut";
+const char kLongPattern[] = "z|yxwvutsrqponmlkjihgfedcbazyxwvutsrqponmlkjihgt";
+
+CoreFoundation::Data makeText(int64_t size, const char* head, const char* tail)
+{
+   CoreFoundation::MutableData data = CoreFoundation::MutableData::with_capacity(size);
+   data.resize(size);
+   UInt8* bytes = data.data();
+   uint32_t state = 12345;
+   for (int64_t i = 0; i < size; ++i)
+   {
+      state = state * 1103515245 + 12345;
+      bytes[i] = (i % 80 == 79) ? '\n' : static_cast<UInt8>('a' + (state >> 16) % 26);
+   }
+   std::memcpy(bytes, head, std::strlen(head));
+   std::memcpy(bytes + size - std::strlen(tail), tail, std::strlen(tail));
+   return data;
+}
+
+CoreFoundation::DataView makeView(const char* s)
+{
+   return CoreFoundation::DataView(reinterpret_cast<const UInt8*>(s), std::strlen(s));
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, FindByte, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", "|");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.find('|'));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, StdFindByte, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", "|");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(std::find(data.begin(), data.end(), '|'));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, RFindByte, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "|", "");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.rfind('|'));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, FindPattern, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", kShortPattern);
+   const CoreFoundation::DataView pattern = makeView(kShortPattern);
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.find(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, FindLongPattern, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", kLongPattern);
+   const CoreFoundation::DataView pattern = makeView(kLongPattern);
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.find(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, StdSearchPattern, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", kShortPattern);
+   const CoreFoundation::DataView pattern = makeView(kShortPattern);
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(std::search(data.begin(), data.end(), pattern.begin(), pattern.end()));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, RFindPattern, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), kShortPattern, "");
+   const CoreFoundation::DataView pattern = makeView(kShortPattern);
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.rfind(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, FindFirstOf, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", "|");
+   const CoreFoundation::DataView set = makeView("|&;#");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(data.find_first_of(set));
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+// Splitting into lines, touching each one.
+CFXX_BENCHMARK_ARGS(SearchBenchmarks, SplitLines, 1024, 1048576, 1073741824)
+{
+   const CoreFoundation::Data data = makeText(state.arg(), "", "");
+
+   while (state.keepRunning())
+   {
+      CFIndex total = 0;
+      for (const CoreFoundation::DataView& line : data.split('\n'))
+         total += line.size();
+      CfxxBench::doNotOptimize(total);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <string>
+#include <vector>
+
+// Splitting a String of comma-separated lines into fields, against converting it to a
+// std::string and splitting that into a std::vector<std::string>. The argument is the
+// length of the text in characters, up to 100 MiB.
+
+namespace
+{
+
+std::string makeCsv(int64_t length)
+{
+   static const char* const fields[] = { "alpha", "1234", "", "gamma delta", "42.5", "x" };
+   std::string s;
+   s.reserve(static_cast<size_t>(length));
+   for (size_t i = 0; static_cast<int64_t>(s.size()) < length; ++i)
+   {
+      s += fields[i % 6];
+      s += (i % 6 == 5) ? '\n' : ',';
+   }
+   s.resize(static_cast<size_t>(length));
+   return s;
+}
+
+bool isSeparator(UniChar c)
+{
+   return c == ',' || c == '\n';
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(SplitBenchmarks, Split, 65536, 1048576, 104857600)
+{
+   const CoreFoundation::String s = makeCsv(state.arg()).c_str();
+   const CoreFoundation::String comma = ",";
+
+   while (state.keepRunning())
+   {
+      CFIndex fields = 0;
+      for (const CoreFoundation::StringView& field : s.split(comma))
+         fields += field.length();
+      CfxxBench::doNotOptimize(fields);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+// A string CF won't hand out the characters of, so they're copied out a block at a time.
+CFXX_BENCHMARK_ARGS(SplitBenchmarks, SplitMutable, 65536, 1048576, 104857600)
+{
+   const CoreFoundation::MutableString s(makeCsv(state.arg()).c_str());
+   const CoreFoundation::String comma = ",";
+
+   while (state.keepRunning())
+   {
+      CFIndex fields = 0;
+      for (const CoreFoundation::StringView& field : s.split(comma))
+         fields += field.length();
+      CfxxBench::doNotOptimize(fields);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SplitBenchmarks, Tokenize, 65536, 1048576, 104857600)
+{
+   const CoreFoundation::String s = makeCsv(state.arg()).c_str();
+
+   while (state.keepRunning())
+   {
+      CFIndex tokens = 0;
+      for (const CoreFoundation::StringView& token : s.tokenize(isSeparator))
+         tokens += token.length();
+      CfxxBench::doNotOptimize(tokens);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(SplitBenchmarks, StdStringSplit, 65536, 1048576, 104857600)
+{
+   const CoreFoundation::String s = makeCsv(state.arg()).c_str();
+
+   while (state.keepRunning())
+   {
+      const std::string text = s.to_string();
+      std::vector<std::string> fields;
+      for (size_t start = 0; ; )
+      {
+         const size_t comma = text.find(',', start);
+         fields.push_back(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+         if (comma == std::string::npos)
+            break;
+         start = comma + 1;
+      }
+      CfxxBench::doNotOptimize(fields);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <cstdint>
+#include <string>
+
+// Serializing records of a few fields each: straight into the MutableData with a
+// DataWriter, versus building each record in a std::string and appending it.
+
+namespace
+{
+
+const int kRecordsPerPayload = 1024;
+
+struct Record
+{
+   uint64_t id;
+   int32_t delta;
+   double value;
+   const char* name;
+   size_t nameLength;
+};
+
+const Record kRecord = { 123456789, -42, 2.5, "some-record-name", 16 };
+
+void appendVarint(std::string& s, uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      s.push_back(static_cast<char>(static_cast<UInt8>(value) | 0x80));
+      value >>= 7;
+   }
+   s.push_back(static_cast<char>(value));
+}
+
+} // namespace
+
+CFXX_BENCHMARK(StreamBenchmarks, DataWriterRecords)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData payload;
+      CoreFoundation::DataWriter writer(payload);
+      for (int i = 0; i < kRecordsPerPayload; ++i)
+      {
+         writer.write_varint(kRecord.id)
+            .write_zigzag(kRecord.delta)
+            .write_le(kRecord.value)
+            .write_length_prefixed(kRecord.name, kRecord.nameLength);
+      }
+      writer.finish();
+      CfxxBench::doNotOptimize(payload);
+   }
+}
+
+CFXX_BENCHMARK(StreamBenchmarks, StdStringRecords)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::MutableData payload;
+      for (int i = 0; i < kRecordsPerPayload; ++i)
+      {
+         std::string record;
+         appendVarint(record, kRecord.id);
+         appendVarint(record, (static_cast<uint64_t>(kRecord.delta) << 1) ^ static_cast<uint64_t>(kRecord.delta >> 31));
+         record.append(reinterpret_cast<const char*>(&kRecord.value), sizeof(kRecord.value));
+         appendVarint(record, kRecord.nameLength);
+         record.append(kRecord.name, kRecord.nameLength);
+         payload.append(reinterpret_cast<const UInt8*>(record.data()), record.size());
+      }
+      CfxxBench::doNotOptimize(payload);
+   }
+}
+
+CFXX_BENCHMARK(StreamBenchmarks, DataReaderRecords)
+{
+   CoreFoundation::MutableData payload;
+   {
+      CoreFoundation::DataWriter writer(payload);
+      for (int i = 0; i < kRecordsPerPayload; ++i)
+      {
+         writer.write_varint(kRecord.id)
+            .write_zigzag(kRecord.delta)
+            .write_le(kRecord.value)
+            .write_length_prefixed(kRecord.name, kRecord.nameLength);
+      }
+   }
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::DataReader reader(payload);
+      uint64_t sum = 0;
+      while (!reader.at_end())
+      {
+         sum += reader.read_varint();
+         sum += static_cast<uint64_t>(reader.read_zigzag());
+         sum += static_cast<uint64_t>(reader.read_le<double>());
+         sum += static_cast<uint64_t>(reader.read_length_prefixed().size());
+      }
+      CfxxBench::doNotOptimize(sum);
+   }
+
+   state.setBytesProcessed(state.iterations() * payload.size());
+}
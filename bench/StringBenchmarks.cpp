@@ -0,0 +1,604 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Benchmark.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// An ASCII string of the given length; CF will usually store this as 8-bit characters.
+std::string makeAsciiText(int64_t length)
+{
+   static const char pattern[] = "The quick brown fox jumps over the lazy dog. ";
+   std::string s;
+   s.reserve(static_cast<size_t>(length));
+   while (static_cast<int64_t>(s.size()) < length)
+      s += pattern[s.size() % (sizeof(pattern) - 1)];
+   return s;
+}
+
+// A UTF-8 string of roughly the given number of UTF-16 characters, with enough non-ASCII
+// content that CF has to store it as UTF-16 and can't hand out a C string pointer.
+std::string makeUnicodeText(int64_t length)
+{
+   static const struct { const char* utf8; int64_t characters; } words[] =
+   {
+      { "caf\xC3\xA9 ", 5 },
+      { "na\xC3\xAFve ", 6 },
+      { "\xE2\x82\xAC" "5 ", 3 },
+      { "plain ", 6 },
+   };
+
+   std::string s;
+   int64_t characters = 0;
+   for (size_t i = 0; characters < length; ++i)
+   {
+      s += words[i % 4].utf8;
+      characters += words[i % 4].characters;
+   }
+   return s;
+}
+
+} // namespace
+
+//=================================
+// Copying
+//=================================
+
+CFXX_BENCHMARK(StringBenchmarks, StringCopy)
+{
+   const CoreFoundation::String s = "Content-Type";
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::String copy(s);
+      CfxxBench::doNotOptimize(copy);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, StringMove)
+{
+   CoreFoundation::String s = "Content-Type";
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::String moved(std::move(s));
+      s = std::move(moved);
+      CfxxBench::doNotOptimize(s);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, StringCopyAfterIndexing)
+{
+   // Indexing populates the original's window; copies still shouldn't allocate.
+   const CoreFoundation::String s = "Content-Type: application/octet-stream";
+   CfxxBench::doNotOptimize(s[10]);
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::String copy(s);
+      CfxxBench::doNotOptimize(copy);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, RawStringRetainRelease)
+{
+   CFStringRef s = CFStringCreateWithCString(kCFAllocatorDefault, "Content-Type", kCFStringEncodingUTF8);
+
+   while (state.keepRunning())
+   {
+      CFRetain(s);
+      CfxxBench::doNotOptimize(s);
+      CFRelease(s);
+   }
+
+   CFRelease(s);
+}
+
+CFXX_BENCHMARK(StringBenchmarks, StdStringCopy)
+{
+   // Long enough to defeat the small string optimization.
+   const std::string s = "Content-Type: application/octet-stream";
+
+   while (state.keepRunning())
+   {
+      std::string copy(s);
+      CfxxBench::doNotOptimize(copy);
+   }
+}
+
+//=================================
+// Comparison
+//=================================
+
+namespace
+{
+
+// Sortable keys sharing a long common prefix, as path-like or namespaced keys tend to.
+std::vector<CoreFoundation::String> makeSortKeys(bool unicode)
+{
+   std::vector<CoreFoundation::String> keys;
+   for (int i = 0; i < 10000; ++i)
+   {
+      const std::string key = std::string(unicode ? "r\xC3\xA9" : "re") + "source/collection/item-"
+         + std::to_string((i * 7919) % 10000);
+      keys.push_back(CoreFoundation::String(key.c_str()));
+   }
+   return keys;
+}
+
+} // namespace
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, SortOperatorLess, 0, 1)
+{
+   const std::vector<CoreFoundation::String> keys = makeSortKeys(state.arg() != 0);
+
+   while (state.keepRunning())
+   {
+      std::vector<CoreFoundation::String> sorted(keys);
+      std::sort(sorted.begin(), sorted.end());
+      CfxxBench::doNotOptimize(sorted);
+   }
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, SortRawCFStringCompare, 0, 1)
+{
+   const std::vector<CoreFoundation::String> keys = makeSortKeys(state.arg() != 0);
+
+   while (state.keepRunning())
+   {
+      std::vector<CoreFoundation::String> sorted(keys);
+      std::sort(sorted.begin(), sorted.end(), [](const CoreFoundation::String& a, const CoreFoundation::String& b) {
+         return CFStringCompare(a, b, 0) == kCFCompareLessThan;
+      });
+      CfxxBench::doNotOptimize(sorted);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, SortCaseInsensitive)
+{
+   const std::vector<CoreFoundation::String> keys = makeSortKeys(false);
+
+   while (state.keepRunning())
+   {
+      std::vector<CoreFoundation::String> sorted(keys);
+      std::sort(sorted.begin(), sorted.end(), CoreFoundation::StringLess(kCFCompareCaseInsensitive));
+      CfxxBench::doNotOptimize(sorted);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, EqualDifferentLengths)
+{
+   const CoreFoundation::String a("resource/collection/item-1");
+   const CoreFoundation::String b("resource/collection/item-10");
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(a == b);
+}
+
+//=================================
+// Literal keys
+//=================================
+
+CFXX_BENCHMARK(StringBenchmarks, LiteralKeyConstruct)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::String key("content-type");
+      CfxxBench::doNotOptimize(key);
+   }
+}
+
+CFXX_BENCHMARK(StringBenchmarks, LiteralKeyMacro)
+{
+   while (state.keepRunning())
+   {
+      CoreFoundation::String key = CFXX_STR("content-type");
+      CfxxBench::doNotOptimize(key);
+   }
+}
+
+#if CFXX_HAS_STRING_LITERAL_OPERATOR
+CFXX_BENCHMARK(StringBenchmarks, LiteralKeyOperator)
+{
+   using namespace CoreFoundation::Literals;
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::String key = "content-type"_cfs;
+      CfxxBench::doNotOptimize(key);
+   }
+}
+#endif
+
+CFXX_BENCHMARK(StringBenchmarks, DictionaryLookupConstructedKey)
+{
+   CFMutableDictionaryRef dict = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+      &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+   CFDictionarySetValue(dict, CFXX_STR("content-type"), CFXX_STR("text/plain"));
+
+   while (state.keepRunning())
+   {
+      const void* value = CFDictionaryGetValue(dict, CoreFoundation::String("content-type"));
+      CfxxBench::doNotOptimize(value);
+   }
+
+   CFRelease(dict);
+}
+
+CFXX_BENCHMARK(StringBenchmarks, DictionaryLookupConstantKey)
+{
+   CFMutableDictionaryRef dict = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+      &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+   CFDictionarySetValue(dict, CFXX_STR("content-type"), CFXX_STR("text/plain"));
+
+   while (state.keepRunning())
+   {
+      const void* value = CFDictionaryGetValue(dict, CFXX_STR("content-type"));
+      CfxxBench::doNotOptimize(value);
+   }
+
+   CFRelease(dict);
+}
+
+//=================================
+// Construction from std::string
+//=================================
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, ConstructFromStdStringCopy, 256, 65536, 1048576)
+{
+   const std::string payload = makeAsciiText(state.arg());
+
+   while (state.keepRunning())
+   {
+      CoreFoundation::String s(payload);
+      CfxxBench::doNotOptimize(s);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, ConstructFromStdStringAdopt, 256, 65536, 1048576)
+{
+   const std::string payload = makeAsciiText(state.arg());
+
+   int64_t bytes = 0;
+   while (state.keepRunning())
+   {
+      // The copy being adopted is made outside of the interesting part, but still
+      // inside the timed loop, so compare against StdStringCopySized/.
+      std::string owned(payload);
+      CoreFoundation::String s(std::move(owned));
+      CfxxBench::doNotOptimize(s);
+      bytes += state.arg();
+   }
+
+   state.setBytesProcessed(bytes);
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, RawCreateWithBytes, 256, 65536, 1048576)
+{
+   const std::string payload = makeAsciiText(state.arg());
+
+   while (state.keepRunning())
+   {
+      CFStringRef s = CFStringCreateWithBytes(kCFAllocatorDefault,
+         reinterpret_cast<const UInt8*>(payload.data()), static_cast<CFIndex>(payload.size()),
+         kCFStringEncodingUTF8, false);
+      CfxxBench::doNotOptimize(s);
+      CFRelease(s);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StdStringCopySized, 256, 65536, 1048576)
+{
+   const std::string payload = makeAsciiText(state.arg());
+
+   while (state.keepRunning())
+   {
+      std::string copy(payload);
+      CfxxBench::doNotOptimize(copy);
+   }
+
+   state.setBytesProcessed(state.iterations() * state.arg());
+}
+
+//=================================
+// Iteration
+//=================================
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StringIterate, 16, 256, 4096, 65536)
+{
+   const CoreFoundation::String s = makeUnicodeText(state.arg()).c_str();
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      unsigned sum = 0;
+      for (auto itr = s.begin(); itr != s.end(); ++itr)
+         sum += *itr;
+      CfxxBench::doNotOptimize(sum);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, RawGetCharacterAtIndex, 16, 256, 4096, 65536)
+{
+   CFStringRef s = CFStringCreateWithCString(
+      kCFAllocatorDefault, makeUnicodeText(state.arg()).c_str(), kCFStringEncodingUTF8);
+   const CFIndex length = CFStringGetLength(s);
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      unsigned sum = 0;
+      for (CFIndex i = 0; i < length; ++i)
+         sum += CFStringGetCharacterAtIndex(s, i);
+      CfxxBench::doNotOptimize(sum);
+      characters += length;
+   }
+
+   state.setBytesProcessed(characters * sizeof(UniChar));
+   CFRelease(s);
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StdU16StringIterate, 16, 256, 4096, 65536)
+{
+   const CoreFoundation::String cf = makeUnicodeText(state.arg()).c_str();
+   std::u16string s;
+   for (UniChar c : cf)
+      s.push_back(c);
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      unsigned sum = 0;
+      for (auto itr = s.begin(); itr != s.end(); ++itr)
+         sum += *itr;
+      CfxxBench::doNotOptimize(sum);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(char16_t));
+}
+
+//=================================
+// Scanning (std::count for a character)
+//=================================
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StringIteratorCount, 256, 4096, 65536)
+{
+   const CoreFoundation::String s = makeUnicodeText(state.arg()).c_str();
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      const auto n = std::count(s.begin(), s.end(), static_cast<UniChar>('e'));
+      CfxxBench::doNotOptimize(n);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StringChunkedCount, 256, 4096, 65536)
+{
+   const CoreFoundation::String s = makeUnicodeText(state.arg()).c_str();
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      std::ptrdiff_t n = 0;
+      s.for_each_chunk([&](const UniChar* chars, CFIndex count) {
+         n += std::count(chars, chars + count, static_cast<UniChar>('e'));
+      });
+      CfxxBench::doNotOptimize(n);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, MutableStringChunkedCount, 256, 4096, 65536)
+{
+   // Mutable strings generally can't hand out a direct pointer, so this exercises the
+   // buffered path.
+   const CoreFoundation::MutableString s = makeUnicodeText(state.arg()).c_str();
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      std::ptrdiff_t n = 0;
+      s.for_each_chunk([&](const UniChar* chars, CFIndex count) {
+         n += std::count(chars, chars + count, static_cast<UniChar>('e'));
+      });
+      CfxxBench::doNotOptimize(n);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StdU16StringCount, 256, 4096, 65536)
+{
+   const CoreFoundation::String cf = makeUnicodeText(state.arg()).c_str();
+   std::u16string s;
+   for (UniChar c : cf)
+      s.push_back(c);
+   int64_t characters = 0;
+
+   while (state.keepRunning())
+   {
+      const auto n = std::count(s.begin(), s.end(), u'e');
+      CfxxBench::doNotOptimize(n);
+      characters += s.size();
+   }
+
+   state.setBytesProcessed(characters * sizeof(char16_t));
+}
+
+//=================================
+// Conversion to std::string
+//=================================
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, ToStringAscii, 16, 256, 4096, 65536)
+{
+   const CoreFoundation::String s = makeAsciiText(state.arg()).c_str();
+   int64_t bytes = 0;
+
+   while (state.keepRunning())
+   {
+      const std::string converted = s.to_string();
+      CfxxBench::doNotOptimize(converted);
+      bytes += converted.size();
+   }
+
+   state.setBytesProcessed(bytes);
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, ToStringUnicode, 16, 256, 4096, 65536)
+{
+   const CoreFoundation::String s = makeUnicodeText(state.arg()).c_str();
+   int64_t bytes = 0;
+
+   while (state.keepRunning())
+   {
+      const std::string converted = s.to_string();
+      CfxxBench::doNotOptimize(converted);
+      bytes += converted.size();
+   }
+
+   state.setBytesProcessed(bytes);
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, RawGetBytesUnicode, 16, 256, 4096, 65536)
+{
+   CFStringRef s = CFStringCreateWithCString(
+      kCFAllocatorDefault, makeUnicodeText(state.arg()).c_str(), kCFStringEncodingUTF8);
+   const CFRange range = CFRangeMake(0, CFStringGetLength(s));
+   int64_t bytes = 0;
+
+   while (state.keepRunning())
+   {
+      // The conventional way to do this from C: size the buffer, then fill it.
+      CFIndex required = 0;
+      CFStringGetBytes(s, range, kCFStringEncodingUTF8, 0, false, nullptr, 0, &required);
+      std::vector<UInt8> buffer(required);
+      CFStringGetBytes(s, range, kCFStringEncodingUTF8, 0, false, buffer.data(), required, nullptr);
+      CfxxBench::doNotOptimize(buffer);
+      bytes += required;
+   }
+
+   state.setBytesProcessed(bytes);
+   CFRelease(s);
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StdStringCopyUnicode, 16, 256, 4096, 65536)
+{
+   const std::string s = makeUnicodeText(state.arg());
+   int64_t bytes = 0;
+
+   while (state.keepRunning())
+   {
+      const std::string copy(s);
+      CfxxBench::doNotOptimize(copy);
+      bytes += copy.size();
+   }
+
+   state.setBytesProcessed(bytes);
+}
+
+//=================================
+// Searching
+//=================================
+
+// The argument is the length of the string searched, in characters (counted as UTF-16,
+// whatever CF stores); the pattern is only at the very end, so every search runs over
+// all of it.
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, FindAscii, 256, 4096, 65536, 1048576)
+{
+   const CoreFoundation::String s = (makeAsciiText(state.arg()) + "needle!").c_str();
+   const CoreFoundation::String pattern = "needle!";
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(s.find(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg() * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, FindUnicode, 256, 4096, 65536, 1048576)
+{
+   const CoreFoundation::String s = (makeUnicodeText(state.arg()) + "n\xC3\xA9" "edle").c_str();
+   const CoreFoundation::String pattern = "n\xC3\xA9" "edle";
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(s.find(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg() * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, RawCFStringFindUnicode, 256, 4096, 65536, 1048576)
+{
+   const CoreFoundation::String s = (makeUnicodeText(state.arg()) + "n\xC3\xA9" "edle").c_str();
+   const CoreFoundation::String pattern = "n\xC3\xA9" "edle";
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(CFStringFind(s, pattern, 0));
+
+   state.setBytesProcessed(state.iterations() * state.arg() * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, StdU16StringFindUnicode, 256, 4096, 65536, 1048576)
+{
+   const CoreFoundation::String s = (makeUnicodeText(state.arg()) + "n\xC3\xA9" "edle").c_str();
+   std::u16string text;
+   for (UniChar c : s)
+      text.push_back(c);
+   const std::u16string pattern = u"n\u00E9edle";
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(text.find(pattern));
+
+   state.setBytesProcessed(state.iterations() * state.arg() * sizeof(UniChar));
+}
+
+CFXX_BENCHMARK_ARGS(StringBenchmarks, FindCharacterUnicode, 256, 4096, 65536, 1048576)
+{
+   const CoreFoundation::String s = (makeUnicodeText(state.arg()) + "!").c_str();
+
+   while (state.keepRunning())
+      CfxxBench::doNotOptimize(s.find('!'));
+
+   state.setBytesProcessed(state.iterations() * state.arg() * sizeof(UniChar));
+}
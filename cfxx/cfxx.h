@@ -42,7 +42,20 @@
 
 #include <CoreFoundation/CoreFoundation.h>
 #include "cfxx_base.h"
+#include "cfxx_allocator.h"
+#include "cfxx_atomic.h"
+#include "cfxx_release.h"
 #include "cfxx_data.h"
+#include "cfxx_chain.h"
+#include "cfxx_loader.h"
+#include "cfxx_stream.h"
+#include "cfxx_checksum.h"
+#include "cfxx_search.h"
+#include "cfxx_unicode.h"
 #include "cfxx_string.h"
+#include "cfxx_split.h"
+#include "cfxx_encoding.h"
+#include "cfxx_intern.h"
+#include "cfxx_hash.h"
 
 #endif // __cfxx_h__
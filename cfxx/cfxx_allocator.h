@@ -0,0 +1,501 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_allocator_h__
+#define __cfxx_allocator_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace CoreFoundation
+{
+
+// Builds a CFAllocatorRef that gets its memory from a copy of a C++ allocator. Any
+// std::allocator-compatible type works; it is rebound to 16-byte units.
+//
+// CF only tells the deallocate callback the address, while C++ allocators want the
+// size back too, so each block carries a 16-byte header recording it.
+template<typename Allocator>
+class AllocatorBridge
+{
+public:
+   static inline CFReference<CFAllocatorRef> create(const Allocator& allocator = Allocator())
+   {
+      CFAllocatorContext context;
+      std::memset(&context, 0, sizeof(context));
+      context.info = new UnitAllocator(allocator);
+      context.release = &AllocatorBridge::release;
+      context.allocate = &AllocatorBridge::allocate;
+      context.reallocate = &AllocatorBridge::reallocate;
+      context.deallocate = &AllocatorBridge::deallocate;
+
+      CFAllocatorRef cfAllocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+      if (!cfAllocator)
+      {
+         delete static_cast<UnitAllocator*>(context.info);
+         throw std::bad_alloc();
+      }
+      return makeCFReferenceFromCopyOrCreate(cfAllocator);
+   }
+
+private:
+   struct Unit
+   {
+      alignas(16) unsigned char bytes[16];
+   };
+
+   typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Unit> UnitAllocator;
+   typedef std::allocator_traits<UnitAllocator>                                   UnitTraits;
+
+   static inline size_t unitsFor(CFIndex size) noexcept
+   {
+      // One extra for the header.
+      return (static_cast<size_t>(size) + sizeof(Unit) - 1) / sizeof(Unit) + 1;
+   }
+
+   static void release(const void* info)
+   {
+      delete static_cast<const UnitAllocator*>(info);
+   }
+
+   static void* allocate(CFIndex size, CFOptionFlags, void* info)
+   {
+      UnitAllocator& allocator = *static_cast<UnitAllocator*>(info);
+      size_t units = unitsFor(size);
+      Unit* block;
+      try
+      {
+         block = UnitTraits::allocate(allocator, units);
+      }
+      catch (...)
+      {
+         // CF expects failure to be reported as NULL.
+         return nullptr;
+      }
+      *reinterpret_cast<size_t*>(block) = units;
+      return block + 1;
+   }
+
+   static void deallocate(void* ptr, void* info)
+   {
+      UnitAllocator& allocator = *static_cast<UnitAllocator*>(info);
+      Unit* block = static_cast<Unit*>(ptr) - 1;
+      UnitTraits::deallocate(allocator, block, *reinterpret_cast<size_t*>(block));
+   }
+
+   static void* reallocate(void* ptr, CFIndex newSize, CFOptionFlags hint, void* info)
+   {
+      Unit* block = static_cast<Unit*>(ptr) - 1;
+      size_t oldUnits = *reinterpret_cast<size_t*>(block);
+      if (unitsFor(newSize) == oldUnits)
+         return ptr;
+
+      void* replacement = allocate(newSize, hint, info);
+      if (!replacement)
+         return nullptr;
+      size_t oldSize = (oldUnits - 1) * sizeof(Unit);
+      std::memcpy(replacement, ptr, std::min(oldSize, static_cast<size_t>(newSize)));
+      deallocate(ptr, info);
+      return replacement;
+   }
+};
+
+template<typename Allocator>
+inline CFReference<CFAllocatorRef> makeCFAllocator(const Allocator& allocator = Allocator())
+{
+   return AllocatorBridge<Allocator>::create(allocator);
+}
+
+// A bump allocator: allocation is a pointer increment, freeing is (mostly) a no-op,
+// and reset() throws everything away at once. Meant for objects that all die together,
+// such as the Strings and Datas made while handling a single request:
+//
+//    MonotonicArena arena;
+//    {
+//       String name("...", kCFStringEncodingUTF8, arena.allocator());
+//       ...
+//    }
+//    arena.reset();
+//
+// Every CF object made with allocator() must have been released before reset() or the
+// arena's destruction. Not thread-safe; use one arena per thread.
+class MonotonicArena
+{
+public:
+   enum { kDefaultBlockSize = 64 * 1024 };
+   enum { kAlignment = 16 };
+
+   inline explicit MonotonicArena(size_t blockSize = kDefaultBlockSize) :
+      m_blockSize(blockSize),
+      m_current(0),
+      m_offset(0),
+      m_lastAllocation(nullptr),
+      m_bytesAllocated(0)
+   {
+      CFAllocatorContext context;
+      std::memset(&context, 0, sizeof(context));
+      context.info = this;
+      context.allocate = &MonotonicArena::allocateCallback;
+      context.reallocate = &MonotonicArena::reallocateCallback;
+      context.deallocate = &MonotonicArena::deallocateCallback;
+
+      CFAllocatorRef cfAllocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+      if (!cfAllocator)
+         throw std::bad_alloc();
+      m_allocator = makeCFReferenceFromCopyOrCreate(cfAllocator);
+   }
+
+   MonotonicArena(const MonotonicArena&) = delete;
+   MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+   inline ~MonotonicArena()
+   {
+      m_allocator.release();
+      for (size_t i = 0; i < m_blocks.size(); ++i)
+         std::free(m_blocks[i].m_memory);
+   }
+
+   // The CFAllocatorRef to hand to constructors. Owned by the arena.
+   inline CFAllocatorRef allocator() const noexcept
+   {
+      return m_allocator.get();
+   }
+
+   // Returns 'size' bytes aligned to kAlignment, or nullptr if memory is exhausted.
+   inline void* allocate(size_t size) noexcept
+   {
+      size_t needed = kHeaderSize + roundUp(size);
+      if (m_current >= m_blocks.size() || m_offset + needed > m_blocks[m_current].m_size)
+      {
+         if (!nextBlock(needed))
+            return nullptr;
+      }
+
+      char* header = static_cast<char*>(m_blocks[m_current].m_memory) + m_offset;
+      *reinterpret_cast<size_t*>(header) = size;
+      m_offset += needed;
+      m_bytesAllocated += size;
+      m_lastAllocation = header + kHeaderSize;
+      return m_lastAllocation;
+   }
+
+   // Forget every allocation. The first block is kept for reuse; the rest go back to
+   // the system.
+   inline void reset() noexcept
+   {
+      for (size_t i = 1; i < m_blocks.size(); ++i)
+         std::free(m_blocks[i].m_memory);
+      if (!m_blocks.empty())
+         m_blocks.resize(1);
+      m_current = 0;
+      m_offset = 0;
+      m_lastAllocation = nullptr;
+      m_bytesAllocated = 0;
+   }
+
+   // Bytes handed out since construction or the last reset().
+   inline size_t bytes_allocated() const noexcept
+   {
+      return m_bytesAllocated;
+   }
+
+private:
+   enum { kHeaderSize = kAlignment };
+
+   struct Block
+   {
+      void*  m_memory;
+      size_t m_size;
+   };
+
+   static inline size_t roundUp(size_t size) noexcept
+   {
+      return (size + kAlignment - 1) & ~static_cast<size_t>(kAlignment - 1);
+   }
+
+   static inline size_t sizeOf(void* ptr) noexcept
+   {
+      return *reinterpret_cast<size_t*>(static_cast<char*>(ptr) - kHeaderSize);
+   }
+
+   inline bool nextBlock(size_t needed) noexcept
+   {
+      // Allocations bigger than a block get one to themselves.
+      Block block;
+      block.m_size = std::max(m_blockSize, needed);
+      block.m_memory = std::malloc(block.m_size);
+      if (!block.m_memory)
+         return false;
+      try
+      {
+         m_blocks.push_back(block);
+      }
+      catch (...)
+      {
+         std::free(block.m_memory);
+         return false;
+      }
+      m_current = m_blocks.size() - 1;
+      m_offset = 0;
+      return true;
+   }
+
+   // Whether 'ptr' is the most recent allocation, which can still be grown or given back.
+   inline bool isLast(void* ptr) const noexcept
+   {
+      return ptr == m_lastAllocation;
+   }
+
+   static void* allocateCallback(CFIndex size, CFOptionFlags, void* info)
+   {
+      return static_cast<MonotonicArena*>(info)->allocate(static_cast<size_t>(size));
+   }
+
+   static void* reallocateCallback(void* ptr, CFIndex newSize, CFOptionFlags, void* info)
+   {
+      MonotonicArena& arena = *static_cast<MonotonicArena*>(info);
+      size_t oldSize = sizeOf(ptr);
+      size_t size = static_cast<size_t>(newSize);
+
+      if (arena.isLast(ptr))
+      {
+         // Grow or shrink in place if the block has room.
+         size_t start = static_cast<size_t>(static_cast<char*>(ptr) - static_cast<char*>(arena.m_blocks[arena.m_current].m_memory));
+         if (start + roundUp(size) <= arena.m_blocks[arena.m_current].m_size)
+         {
+            arena.m_offset = start + roundUp(size);
+            arena.m_bytesAllocated = arena.m_bytesAllocated - oldSize + size;
+            *reinterpret_cast<size_t*>(static_cast<char*>(ptr) - kHeaderSize) = size;
+            return ptr;
+         }
+      }
+      else if (size <= roundUp(oldSize))
+      {
+         return ptr;
+      }
+
+      void* replacement = arena.allocate(size);
+      if (replacement)
+         std::memcpy(replacement, ptr, std::min(oldSize, size));
+      return replacement;
+   }
+
+   static void deallocateCallback(void* ptr, void* info)
+   {
+      // Only the most recent allocation can be given back; everything else waits for reset().
+      MonotonicArena& arena = *static_cast<MonotonicArena*>(info);
+      if (arena.isLast(ptr))
+      {
+         arena.m_offset = static_cast<size_t>(static_cast<char*>(ptr) - kHeaderSize - static_cast<char*>(arena.m_blocks[arena.m_current].m_memory));
+         arena.m_bytesAllocated -= sizeOf(ptr);
+         arena.m_lastAllocation = nullptr;
+      }
+   }
+
+   size_t                      m_blockSize;
+   std::vector<Block>          m_blocks;
+   size_t                      m_current;
+   size_t                      m_offset;
+   void*                       m_lastAllocation;
+   size_t                      m_bytesAllocated;
+   CFReference<CFAllocatorRef> m_allocator;
+};
+
+// A process-wide CFAllocator that keeps freed small blocks on per-thread free lists,
+// one per 16-byte size class, so that short-lived small objects are recycled without
+// going back to malloc or taking any locks. Blocks are ordinary malloc blocks, so it
+// doesn't matter which thread frees them; they simply end up cached on that thread.
+// Anything over kMaxPooledSize goes straight to malloc.
+class ThreadLocalPool
+{
+public:
+   enum { kGranularity = 16 };
+   enum { kClassCount = 32 };
+   enum { kMaxPooledSize = kGranularity * kClassCount };
+   // Per thread and per class; beyond this, freed blocks go back to malloc.
+   enum { kMaxCachedBlocks = 256 };
+
+   // Never released, so that it stays valid for objects freed during static destruction.
+   static inline CFAllocatorRef allocator()
+   {
+      static CFAllocatorRef s_allocator = createAllocator();
+      return s_allocator;
+   }
+
+   // Return this thread's cached blocks to malloc.
+   static inline void trim() noexcept
+   {
+      if (!cacheDestroyed())
+         cache().clear();
+   }
+
+private:
+   // Stored in front of every block; padded to keep the payload 16-byte aligned.
+   struct alignas(16) Header
+   {
+      size_t m_size; // usable size
+   };
+
+   struct FreeBlock
+   {
+      FreeBlock* m_next;
+   };
+
+   struct Cache
+   {
+      FreeBlock* m_heads[kClassCount];
+      unsigned   m_counts[kClassCount];
+
+      inline Cache() noexcept
+      {
+         std::memset(m_heads, 0, sizeof(m_heads));
+         std::memset(m_counts, 0, sizeof(m_counts));
+      }
+
+      inline ~Cache()
+      {
+         clear();
+         cacheDestroyed() = true;
+      }
+
+      inline void clear() noexcept
+      {
+         for (int c = 0; c < kClassCount; ++c)
+         {
+            while (m_heads[c])
+            {
+               FreeBlock* block = m_heads[c];
+               m_heads[c] = block->m_next;
+               std::free(reinterpret_cast<Header*>(block) - 1);
+            }
+            m_counts[c] = 0;
+         }
+      }
+   };
+
+   static inline Cache& cache() noexcept
+   {
+      static thread_local Cache s_cache;
+      return s_cache;
+   }
+
+   // Threads can still free CF objects after their Cache has been destroyed (from other
+   // thread_local destructors); this trivially-destructible flag says when that's the case.
+   static inline bool& cacheDestroyed() noexcept
+   {
+      static thread_local bool s_destroyed = false;
+      return s_destroyed;
+   }
+
+   static inline size_t classOf(size_t size) noexcept
+   {
+      return size == 0 ? 0 : (size - 1) / kGranularity;
+   }
+
+   static inline CFAllocatorRef createAllocator()
+   {
+      CFAllocatorContext context;
+      std::memset(&context, 0, sizeof(context));
+      context.allocate = &ThreadLocalPool::allocate;
+      context.reallocate = &ThreadLocalPool::reallocate;
+      context.deallocate = &ThreadLocalPool::deallocate;
+      CFAllocatorRef cfAllocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+      if (!cfAllocator)
+         throw std::bad_alloc();
+      return cfAllocator;
+   }
+
+   static void* allocate(CFIndex allocSize, CFOptionFlags, void*)
+   {
+      size_t size = static_cast<size_t>(allocSize);
+      if (size <= kMaxPooledSize)
+      {
+         size_t sizeClass = classOf(size);
+         size = (sizeClass + 1) * kGranularity;
+         if (!cacheDestroyed())
+         {
+            Cache& c = cache();
+            if (FreeBlock* block = c.m_heads[sizeClass])
+            {
+               c.m_heads[sizeClass] = block->m_next;
+               --c.m_counts[sizeClass];
+               return block;
+            }
+         }
+      }
+
+      Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+      if (!header)
+         return nullptr;
+      header->m_size = size;
+      return header + 1;
+   }
+
+   static void deallocate(void* ptr, void*)
+   {
+      Header* header = static_cast<Header*>(ptr) - 1;
+      if (header->m_size <= kMaxPooledSize && !cacheDestroyed())
+      {
+         Cache& c = cache();
+         size_t sizeClass = classOf(header->m_size);
+         if (c.m_counts[sizeClass] < kMaxCachedBlocks)
+         {
+            FreeBlock* block = static_cast<FreeBlock*>(ptr);
+            block->m_next = c.m_heads[sizeClass];
+            c.m_heads[sizeClass] = block;
+            ++c.m_counts[sizeClass];
+            return;
+         }
+      }
+      std::free(header);
+   }
+
+   static void* reallocate(void* ptr, CFIndex newSize, CFOptionFlags hint, void* info)
+   {
+      Header* header = static_cast<Header*>(ptr) - 1;
+      size_t size = static_cast<size_t>(newSize);
+      // Stay put if the block would land in the same place anyway.
+      bool pooled = header->m_size <= kMaxPooledSize;
+      if (pooled ? (size <= kMaxPooledSize && classOf(size) == classOf(header->m_size))
+                 : (size > kMaxPooledSize && size <= header->m_size))
+         return ptr;
+
+      void* replacement = allocate(newSize, hint, info);
+      if (!replacement)
+         return nullptr;
+      std::memcpy(replacement, ptr, std::min(header->m_size, size));
+      deallocate(ptr, info);
+      return replacement;
+   }
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_allocator_h__
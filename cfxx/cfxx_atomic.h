@@ -0,0 +1,160 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_atomic_h__
+#define __cfxx_atomic_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "cfxx_base.h"
+
+namespace CoreFoundation
+{
+
+// AtomicCFReference is a CFReference that many threads can load from and store to at
+// once, for publishing objects that are read constantly and replaced occasionally.
+//
+// Loads never take a lock. The hard part is that a reader has to retain the object
+// before a concurrent store releases it, so reclamation is epoch based: a reader
+// announces itself in the counter for the current epoch before loading, and a store
+// swaps the pointer, moves everyone on to the next epoch, and then waits for the
+// readers still in the previous one (who might have loaded the old pointer) to finish
+// retaining it before releasing its own reference. Readers only ever wait by retrying
+// if an epoch change lands in the middle of their announcement. Stores are serialized
+// by a mutex and are expected to be rare.
+template <typename T>
+class AtomicCFReference
+{
+public:
+   inline AtomicCFReference() noexcept :
+      m_ptr(nullptr),
+      m_epoch(0)
+   {
+      m_readers[0].store(0, std::memory_order_relaxed);
+      m_readers[1].store(0, std::memory_order_relaxed);
+   }
+
+   inline explicit AtomicCFReference(CFReference<T> ref) noexcept :
+      AtomicCFReference()
+   {
+      m_ptr.store(ref.detach(), std::memory_order_relaxed);
+   }
+
+   AtomicCFReference(const AtomicCFReference&) = delete;
+   AtomicCFReference& operator=(const AtomicCFReference&) = delete;
+
+   // Nothing may be loading or storing concurrently with destruction.
+   inline ~AtomicCFReference()
+   {
+      T ref = m_ptr.load(std::memory_order_relaxed);
+      if (ref)
+         releaseReference(ref);
+   }
+
+   inline CFReference<T> load() const noexcept
+   {
+      std::atomic<uint32_t>& readers = enter();
+      T ref = m_ptr.load();
+      if (ref)
+      {
+         CFRetain(ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Retain, ref);
+      }
+      readers.fetch_sub(1, std::memory_order_release);
+      return CFReference<T>(ref, adopt_reference);
+   }
+
+   inline void store(CFReference<T> desired) noexcept
+   {
+      exchange(std::move(desired));
+   }
+
+   // Store 'desired' and return what was there before.
+   inline CFReference<T> exchange(CFReference<T> desired) noexcept
+   {
+      std::lock_guard<std::mutex> lock(m_writeMutex);
+      T previous = m_ptr.exchange(desired.detach());
+      synchronize();
+      return CFReference<T>(previous, adopt_reference);
+   }
+
+   // Objects are compared by identity. On failure, 'expected' is set to the current value.
+   inline bool compare_exchange(CFReference<T>& expected, CFReference<T> desired) noexcept
+   {
+      std::lock_guard<std::mutex> lock(m_writeMutex);
+      // Only writers change m_ptr, and we're the only writer right now.
+      T current = m_ptr.load(std::memory_order_relaxed);
+      if (current != expected.get())
+      {
+         expected = CFReference<T>(current);
+         return false;
+      }
+
+      m_ptr.store(desired.detach());
+      synchronize();
+      if (current)
+         releaseReference(current);
+      return true;
+   }
+
+private:
+   // Register as a reader in the current epoch, and return the counter to leave through.
+   inline std::atomic<uint32_t>& enter() const noexcept
+   {
+      for (;;)
+      {
+         const uint64_t epoch = m_epoch.load();
+         std::atomic<uint32_t>& readers = m_readers[epoch & 1];
+         readers.fetch_add(1);
+         // If a store moved the epoch on before we were counted, it may not have waited
+         // for us; back out and try again in the new epoch.
+         if (m_epoch.load() == epoch)
+            return readers;
+         readers.fetch_sub(1, std::memory_order_release);
+      }
+   }
+
+   // Called by writers (holding m_writeMutex) after replacing m_ptr. Once this returns,
+   // no reader can still be about to retain the old pointer.
+   inline void synchronize() noexcept
+   {
+      const uint64_t epoch = m_epoch.fetch_add(1);
+      const std::atomic<uint32_t>& readers = m_readers[epoch & 1];
+      while (readers.load() != 0)
+         std::this_thread::yield();
+   }
+
+   std::atomic<T> m_ptr;
+   std::atomic<uint64_t> m_epoch;
+   mutable std::atomic<uint32_t> m_readers[2];
+   std::mutex m_writeMutex;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_atomic_h__
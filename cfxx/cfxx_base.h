@@ -28,8 +28,12 @@
 
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreFoundation/CFBase.h>
+#include <atomic>
+#include <cstring>
+#include <new>
 #include <type_traits>
 #include <utility>
+#include "cfxx_instrument.h"
 
 namespace CoreFoundation
 {
@@ -64,9 +68,39 @@ inline typename std::enable_if<
    return reinterpret_cast<CFBaseTypeRef>(r);
 }
 
+// Every reference a CFReference gives up goes through releaseReference(). Normally that's
+// just CFRelease(), but a hook can be installed to take deallocation off the calling thread
+// (see DeferredRelease in cfxx_release.h).
+typedef void (*ReleaseHook)(CFTypeRef);
+
+template<typename Unused = void>
+struct ReleaseHookStorage
+{
+   static std::atomic<ReleaseHook> hook;
+};
+
+template<typename Unused>
+std::atomic<ReleaseHook> ReleaseHookStorage<Unused>::hook(nullptr);
+
+inline void releaseReference(CFTypeRef ref) noexcept
+{
+   Instrumentation::recordRelease(ref);
+   const ReleaseHook hook = ReleaseHookStorage<>::hook.load(std::memory_order_relaxed);
+   if (hook)
+      hook(ref);
+   else
+      CFRelease(ref);
+}
+
+// Tag for constructing a CFReference that takes over a reference the caller already owns
+// (from a Create or Copy function), instead of retaining the object again.
+struct AdoptReferenceTag {};
+constexpr AdoptReferenceTag adopt_reference = AdoptReferenceTag();
+
 // CFReference handles RAII semantics for retain/releasing CoreFoundation references.
 //
-// It's modeled somewhat after std::shared_ptr.
+// It's modeled somewhat after std::shared_ptr. Copies retain, moves never touch the
+// retain count, and a null reference is never passed to CFRetain or CFRelease.
 template <typename T>
 class CFReference
 {
@@ -81,7 +115,14 @@ public:
    inline CFReference(T raw) noexcept :
       m_ref(raw)
    {
-      CFRetain(m_ref);
+      retain();
+   }
+
+   // Take over the caller's reference to 'raw' without retaining it; the CFReference
+   // releases it when done.
+   inline CFReference(T raw, AdoptReferenceTag) noexcept :
+      m_ref(raw)
+   {
    }
 
    // Copy an existing CFReference.
@@ -90,7 +131,8 @@ public:
    {
       // Both ref and other.ref have references to the object, so we need
       // to bump the retain count.
-      CFRetain(m_ref);
+      retain();
+      Instrumentation::recordEvent(Instrumentation::Event::Copy, m_ref);
    }
 
    // Copy an existing CFReference.
@@ -100,7 +142,8 @@ public:
       // (e.g., we could be casting a CFReference<CFDataRef> to a CFReference<CFStringRef>)
       m_ref(reinterpret_cast<T>(other.get()))
    {
-      CFRetain(m_ref);
+      retain();
+      Instrumentation::recordEvent(Instrumentation::Event::Copy, m_ref);
    }
 
    // Move from an existing CFReference.
@@ -110,14 +153,15 @@ public:
       // 'other' now no longer holds a reference to the object.
       // We don't need to CFRetain() because the reference count isn't changing.
       other.m_ref = nullptr;
+      Instrumentation::recordEvent(Instrumentation::Event::Move, m_ref);
    }
 
    // Move from an existing CFReference.
    template<typename Y>
-   inline CFReference(CFReference<T>&& other) noexcept :
-      m_ref(other.get())
+   inline CFReference(CFReference<Y>&& other) noexcept :
+      m_ref(reinterpret_cast<T>(other.detach()))
    {
-      other.m_ref = nullptr;
+      Instrumentation::recordEvent(Instrumentation::Event::Move, m_ref);
    }
 
    // Destroy this CFReference, thus dropping the refcount.
@@ -128,43 +172,52 @@ public:
 
    inline CFReference& operator=(const CFReference& other) noexcept
    {
-      if (&other != this)
+      // Retain before releasing, so that assigning a reference to the same object is safe.
+      T ref = other.get();
+      if (ref)
       {
-         release();
-         m_ref = other.get();
-         CFRetain(m_ref);
+         CFRetain(ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Retain, ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Copy, ref);
       }
+      release();
+      m_ref = ref;
       return *this;
    }
 
    template<typename Y>
    inline CFReference& operator=(const CFReference<Y>& other) noexcept
    {
-      if (&other != this)
+      T ref = reinterpret_cast<T>(other.get());
+      if (ref)
       {
-         release();
-         m_ref = other.get();
-         CFRetain(m_ref);
+         CFRetain(ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Retain, ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Copy, ref);
       }
+      release();
+      m_ref = ref;
       return *this;
    }
 
    inline CFReference& operator=(CFReference&& other) noexcept
    {
-      release();
-      m_ref = other.get();
-      CFRetain(m_ref);
-      other.release();
+      if (&other != this)
+      {
+         release();
+         m_ref = other.detach();
+         Instrumentation::recordEvent(Instrumentation::Event::Move, m_ref);
+      }
       return *this;
    }
 
    template<typename Y>
    inline CFReference& operator=(CFReference<Y>&& other) noexcept
    {
+      T ref = reinterpret_cast<T>(other.detach());
       release();
-      m_ref = other.get();
-      CFRetain(m_ref);
-      other.release();
+      m_ref = ref;
+      Instrumentation::recordEvent(Instrumentation::Event::Move, m_ref);
       return *this;
    }
 
@@ -191,24 +244,133 @@ public:
    {
       if (m_ref)
       {
-         CFRelease(m_ref);
+         releaseReference(m_ref);
          m_ref = nullptr;
       }
    }
 
+   // Give up ownership without releasing; the caller becomes responsible for the
+   // reference (e.g. to return it from a function following the Create rule).
+   inline T detach() noexcept
+   {
+      T ref = m_ref;
+      m_ref = nullptr;
+      return ref;
+   }
+
 private:
+   inline void retain() noexcept
+   {
+      if (m_ref)
+      {
+         CFRetain(m_ref);
+         Instrumentation::recordEvent(Instrumentation::Event::Retain, m_ref);
+      }
+   }
+
    T m_ref;
 };
 
 // Helper to make a CFReference<T> from a newly-created object. It is assumed that 'arg' is the
-// result of a function creating a new reference (like CFStringCreateCopy), and is therefore a
-// temporary value that needs to be released.
+// result of a function creating a new reference (like CFStringCreateCopy), so the CFReference
+// adopts it rather than retaining it again.
 template<typename T>
 inline CFReference<T> makeCFReferenceFromCopyOrCreate(T arg) noexcept
 {
-   CFReference<T> x(arg);
-   CFRelease(arg);
-   return x;
+   Instrumentation::recordCreate(arg);
+   return CFReference<T>(arg, adopt_reference);
+}
+
+// CFBorrowed is a non-owning view of a CoreFoundation object: it never retains or releases.
+// Use it for references whose lifetime is already guaranteed by someone else (a wrapper
+// further up the stack, or a value obtained under the Get rule), where wrapping them in a
+// CFReference would just cost a retain/release pair.
+template <typename T>
+class CFBorrowed
+{
+public:
+   inline CFBorrowed() noexcept :
+      m_ref(nullptr)
+   {
+   }
+
+   inline CFBorrowed(T raw) noexcept :
+      m_ref(raw)
+   {
+   }
+
+   template<typename Y>
+   inline CFBorrowed(const CFReference<Y>& ref) noexcept :
+      m_ref(reinterpret_cast<T>(ref.get()))
+   {
+   }
+
+   inline explicit operator bool() const noexcept
+   {
+      return (m_ref != nullptr);
+   }
+
+   inline operator T() const noexcept
+   {
+      return m_ref;
+   }
+
+   inline T get() const noexcept
+   {
+      return m_ref;
+   }
+
+   // Take a reference of our own, for when the object needs to outlive the borrow.
+   inline CFReference<T> retain() const noexcept
+   {
+      return CFReference<T>(m_ref);
+   }
+
+private:
+   T m_ref;
+};
+
+// Make a CFAllocator whose only job is to be the deallocator passed to one of the
+// *CreateWithBytesNoCopy functions, so that CF can adopt memory owned by a C++ object.
+// 'owner' is deleted when CF releases the allocator, which happens once CF is done with
+// the bytes: when the CF object is destroyed, or straight away if CF decided to copy or
+// convert the bytes instead. Takes ownership of 'owner' even if this throws.
+template<typename Owner>
+inline CFReference<CFAllocatorRef> makeOwningDeallocator(Owner* owner)
+{
+   struct Callbacks
+   {
+      static void release(const void* info)
+      {
+         delete static_cast<const Owner*>(info);
+      }
+
+      // Never used for allocating; CF only ever asks this allocator to deallocate.
+      static void* allocate(CFIndex, CFOptionFlags, void*)
+      {
+         return nullptr;
+      }
+
+      // The bytes belong to 'owner', which goes away in release().
+      static void deallocate(void*, void*)
+      {
+      }
+   };
+
+   CFAllocatorContext context;
+   std::memset(&context, 0, sizeof(context));
+   context.info = owner;
+   context.release = &Callbacks::release;
+   context.allocate = &Callbacks::allocate;
+   context.deallocate = &Callbacks::deallocate;
+
+   CFAllocatorRef allocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+   if (!allocator)
+   {
+      delete owner;
+      throw std::bad_alloc();
+   }
+   return makeCFReferenceFromCopyOrCreate(allocator);
 }
 
 // Base is the base class; it just owns the CFReference, so that all the derived
@@ -236,6 +398,11 @@ protected:
       m_ref(ref)
    { }
 
+   template<typename T>
+   inline Base(CFReference<T>&& ref) noexcept :
+      m_ref(std::move(ref))
+   { }
+
    CFReference<CFTypeRef> m_ref;
 };
 
@@ -0,0 +1,367 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_chain_h__
+#define __cfxx_chain_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "cfxx_data.h"
+
+namespace CoreFoundation
+{
+
+// An ordered sequence of Data segments that reads as one run of bytes, for building up a
+// message out of many pieces without copying them into one buffer. Segments are retained,
+// not copied; appending a MutableData shares it too, so don't change one after handing it
+// over. Flattening into a single contiguous Data only happens when flatten() is called.
+class DataChain
+{
+public:
+   typedef UInt8                                 value_type;
+   typedef const UInt8&                          const_reference;
+   typedef const UInt8*                          const_pointer;
+   typedef CFIndex                               size_type;
+   typedef std::deque<Data>                      segment_list;
+
+   // Walks the bytes of every segment in order.
+   class const_iterator
+   {
+   public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef UInt8                     value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef const UInt8*              pointer;
+      typedef const UInt8&              reference;
+
+      inline const_iterator() noexcept :
+         m_segment(),
+         m_end(),
+         m_bytes(nullptr),
+         m_length(0),
+         m_offset(0)
+      { }
+
+      inline const_reference operator*() const noexcept
+      {
+         return m_bytes[m_offset];
+      }
+
+      inline const_pointer operator->() const noexcept
+      {
+         return m_bytes + m_offset;
+      }
+
+      inline const_iterator& operator++() noexcept
+      {
+         if (++m_offset == m_length)
+         {
+            ++m_segment;
+            enterSegment();
+         }
+         return *this;
+      }
+
+      inline const_iterator operator++(int) noexcept
+      {
+         const_iterator previous = *this;
+         ++*this;
+         return previous;
+      }
+
+      inline bool operator==(const const_iterator& other) const noexcept
+      {
+         return m_segment == other.m_segment && m_offset == other.m_offset;
+      }
+
+      inline bool operator!=(const const_iterator& other) const noexcept
+      {
+         return !(*this == other);
+      }
+
+   private:
+      friend class DataChain;
+
+      inline const_iterator(segment_list::const_iterator segment, segment_list::const_iterator end) noexcept :
+         m_segment(segment),
+         m_end(end)
+      {
+         enterSegment();
+      }
+
+      inline void enterSegment() noexcept
+      {
+         m_offset = 0;
+         if (m_segment != m_end)
+         {
+            m_bytes = m_segment->data();
+            m_length = m_segment->size();
+         }
+         else
+         {
+            m_bytes = nullptr;
+            m_length = 0;
+         }
+      }
+
+      segment_list::const_iterator m_segment;
+      segment_list::const_iterator m_end;
+      // The current segment's bytes, so that dereferencing doesn't go back to CF.
+      const UInt8* m_bytes;
+      size_type m_length;
+      size_type m_offset;
+   };
+
+   typedef const_iterator iterator;
+
+   inline DataChain() noexcept :
+      m_size(0)
+   { }
+
+   DataChain(const DataChain& other) = default;
+   DataChain& operator=(const DataChain& other) = default;
+
+   inline DataChain(DataChain&& other) noexcept :
+      m_segments(std::move(other.m_segments)),
+      m_size(other.m_size)
+   {
+      other.m_segments.clear();
+      other.m_size = 0;
+   }
+
+   inline DataChain& operator=(DataChain&& other) noexcept
+   {
+      if (&other != this)
+      {
+         m_segments = std::move(other.m_segments);
+         m_size = other.m_size;
+         other.m_segments.clear();
+         other.m_size = 0;
+      }
+      return *this;
+   }
+
+   inline size_type size() const noexcept
+   {
+      return m_size;
+   }
+
+   inline bool empty() const noexcept
+   {
+      return m_size == 0;
+   }
+
+   // Empty segments are never stored, so every segment has at least one byte in it.
+   inline size_type segment_count() const noexcept
+   {
+      return static_cast<size_type>(m_segments.size());
+   }
+
+   inline const segment_list& segments() const noexcept
+   {
+      return m_segments;
+   }
+
+   inline const_iterator begin() const noexcept
+   {
+      return const_iterator(m_segments.begin(), m_segments.end());
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return const_iterator(m_segments.end(), m_segments.end());
+   }
+
+   inline void clear() noexcept
+   {
+      m_segments.clear();
+      m_size = 0;
+   }
+
+   inline DataChain& append(Data segment)
+   {
+      if (!segment.empty())
+      {
+         m_size += segment.size();
+         m_segments.push_back(std::move(segment));
+      }
+      return *this;
+   }
+
+   inline DataChain& append(const DataChain& other)
+   {
+      // Copy first, in case 'other' is this chain.
+      segment_list segments(other.m_segments);
+      for (Data& segment : segments)
+         m_segments.push_back(std::move(segment));
+      m_size += other.m_size;
+      return *this;
+   }
+
+   inline DataChain& append(DataChain&& other)
+   {
+      if (&other == this)
+         return append(static_cast<const DataChain&>(other));
+      if (m_segments.empty())
+         return *this = std::move(other);
+      for (Data& segment : other.m_segments)
+         m_segments.push_back(std::move(segment));
+      m_size += other.m_size;
+      other.clear();
+      return *this;
+   }
+
+   inline DataChain& prepend(Data segment)
+   {
+      if (!segment.empty())
+      {
+         m_size += segment.size();
+         m_segments.push_front(std::move(segment));
+      }
+      return *this;
+   }
+
+   // Removes the first 'offset' bytes and returns them as a chain of their own, leaving
+   // the rest in this one. A segment that straddles the offset is sliced in two with
+   // Data::slice(), so nothing is copied unless that segment is a MutableData.
+   inline DataChain split(size_type offset)
+   {
+      if (offset < 0 || offset > m_size)
+         throw std::out_of_range("DataChain");
+
+      DataChain front;
+      while (offset > 0)
+      {
+         Data& segment = m_segments.front();
+         const size_type length = segment.size();
+         if (length <= offset)
+         {
+            front.append(std::move(segment));
+            m_segments.pop_front();
+            m_size -= length;
+            offset -= length;
+         }
+         else
+         {
+            front.append(segment.slice(0, offset));
+            segment = segment.slice(offset);
+            m_size -= offset;
+            offset = 0;
+         }
+      }
+      return front;
+   }
+
+   // Drops the first 'count' bytes; e.g. what a partial writev() got through. A segment
+   // that's only partly dropped is re-sliced; since a slice of a slice holds on to the
+   // original CFData rather than the slice before it, writing a big segment out a little at
+   // a time never leaves more than one slice of it alive.
+   inline void consume(size_type count)
+   {
+      if (count < 0 || count > m_size)
+         throw std::out_of_range("DataChain");
+
+      while (count > 0)
+      {
+         Data& segment = m_segments.front();
+         const size_type length = segment.size();
+         if (length <= count)
+         {
+            m_segments.pop_front();
+            m_size -= length;
+            count -= length;
+         }
+         else
+         {
+            segment = segment.slice(count);
+            m_size -= count;
+            count = 0;
+         }
+      }
+   }
+
+   // Fills in up to 'count' iovecs, one per segment, for writev(). Returns how many were
+   // filled in; a chain with more segments than that has to be written in several calls
+   // (IOV_MAX is 1024 on most systems), consuming what was written in between. The
+   // buffers are the segments' own bytes, and must not be written to: they're for
+   // writev(), not readv().
+   inline size_t iovecs(iovec* vecs, size_t count) const noexcept
+   {
+      size_t filled = 0;
+      for (segment_list::const_iterator it = m_segments.begin();
+           it != m_segments.end() && filled < count;
+           ++it, ++filled)
+      {
+         vecs[filled].iov_base = const_cast<UInt8*>(it->data());
+         vecs[filled].iov_len = static_cast<size_t>(it->size());
+      }
+      return filled;
+   }
+
+   inline std::vector<iovec> iovecs() const
+   {
+      std::vector<iovec> vecs(m_segments.size());
+      iovecs(vecs.data(), vecs.size());
+      return vecs;
+   }
+
+   // All of the bytes, in a single Data. A chain of one segment returns that segment
+   // as-is; otherwise the bytes are copied, once, into a buffer of exactly the right size.
+   inline Data flatten(CFAllocatorRef allocator = kCFAllocatorDefault) const
+   {
+      if (m_segments.size() == 1)
+         return m_segments.front();
+      if (m_segments.empty())
+         return Data(nullptr, 0, allocator);
+
+      UInt8* bytes = static_cast<UInt8*>(CFAllocatorAllocate(allocator, m_size, 0));
+      if (!bytes)
+         throw std::bad_alloc();
+      UInt8* p = bytes;
+      for (const Data& segment : m_segments)
+      {
+         std::memcpy(p, segment.data(), static_cast<size_t>(segment.size()));
+         p += segment.size();
+      }
+      return Data::withImmutableBytes(makeCFReferenceFromCopyOrCreate(
+         CFDataCreateWithBytesNoCopy(allocator, bytes, m_size, allocator)));
+   }
+
+private:
+   segment_list m_segments;
+   size_type m_size;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_chain_h__
@@ -0,0 +1,440 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_checksum_h__
+#define __cfxx_checksum_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "cfxx_data.h"
+#include "cfxx_stream.h"
+
+// As in cfxx_unicode.h, the CRC32C instructions are used when the compiler is targeting an
+// instruction set that has them (e.g. -msse4.2 or -march=armv8-a+crc). Define
+// CFXX_NO_SIMD to force the table-driven code everywhere.
+#if !defined(CFXX_NO_SIMD)
+   #if defined(__SSE4_2__) && defined(__x86_64__)
+      #define CFXX_HAS_SSE42 1
+      #include <nmmintrin.h>
+   #endif
+   #if defined(__ARM_FEATURE_CRC32) && defined(__aarch64__)
+      #define CFXX_HAS_ARM_CRC32 1
+      #include <arm_acle.h>
+   #endif
+#endif
+
+namespace CoreFoundation
+{
+
+// Checksums and content hashes that run over the bytes of a Data (or anything else) in
+// place. Unlike CFHash(), which only looks at some of the bytes and may change between
+// releases, these are specified algorithms: their values can be stored, or compared
+// with ones computed elsewhere.
+
+namespace Detail
+{
+
+// CRC32C (Castagnoli), bit-reflected.
+enum : uint32_t { kCrc32cPolynomial = 0x82F63B78 };
+
+// The product of two polynomials modulo the CRC32C polynomial, in the reflected bit
+// order (x^0 is the top bit).
+inline uint32_t crc32cMultiply(uint32_t a, uint32_t b) noexcept
+{
+   uint32_t product = 0;
+   for (uint32_t m = 1u << 31; m != 0; m >>= 1)
+   {
+      if (a & m)
+         product ^= b;
+      b = (b & 1) ? (b >> 1) ^ kCrc32cPolynomial : b >> 1;
+   }
+   return product;
+}
+
+// x^(8 * n) modulo the polynomial: multiplying a CRC register by this is the same as
+// running n zero bytes through it.
+inline uint32_t crc32cShiftFactor(size_t n) noexcept
+{
+   uint32_t factor = 1u << 31;
+   uint32_t power = 1u << 23;   // x^8
+   for (; n != 0; n >>= 1)
+   {
+      if (n & 1)
+         factor = crc32cMultiply(factor, power);
+      power = crc32cMultiply(power, power);
+   }
+   return factor;
+}
+
+// Slicing-by-8 tables; table[0] is the classic byte-at-a-time table, and table[k] steps
+// a byte through k more zero bytes.
+struct Crc32cTables
+{
+   inline Crc32cTables() noexcept
+   {
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+         uint32_t crc = i;
+         for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (crc >> 1) ^ kCrc32cPolynomial : crc >> 1;
+         table[0][i] = crc;
+      }
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+         for (int k = 1; k < 8; ++k)
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+      }
+   }
+
+   uint32_t table[8][256];
+};
+
+inline const Crc32cTables& crc32cTables() noexcept
+{
+   static const Crc32cTables tables;
+   return tables;
+}
+
+// Advances a raw CRC register (no pre- or post-inversion) over 'n' bytes.
+inline uint32_t crc32cScalar(uint32_t crc, const UInt8* p, size_t n) noexcept
+{
+   const uint32_t (&t)[8][256] = crc32cTables().table;
+   for (; n >= 8; p += 8, n -= 8)
+   {
+      const uint32_t lo = crc ^ loadLittleEndian<uint32_t>(p);
+      const uint32_t hi = loadLittleEndian<uint32_t>(p + 4);
+      crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+   }
+   for (; n != 0; ++p, --n)
+      crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+   return crc;
+}
+
+#if defined(CFXX_HAS_SSE42) || defined(CFXX_HAS_ARM_CRC32)
+
+#if defined(CFXX_HAS_SSE42)
+inline uint32_t crc32cWord(uint32_t crc, const UInt8* p) noexcept
+{
+   return static_cast<uint32_t>(_mm_crc32_u64(crc, loadLittleEndian<uint64_t>(p)));
+}
+
+inline uint32_t crc32cByte(uint32_t crc, UInt8 byte) noexcept
+{
+   return _mm_crc32_u8(crc, byte);
+}
+#else
+inline uint32_t crc32cWord(uint32_t crc, const UInt8* p) noexcept
+{
+   return __crc32cd(crc, loadLittleEndian<uint64_t>(p));
+}
+
+inline uint32_t crc32cByte(uint32_t crc, UInt8 byte) noexcept
+{
+   return __crc32cb(crc, byte);
+}
+#endif
+
+// The CRC instruction takes a few cycles to produce its result but can start a new one
+// every cycle, so long inputs are run as three interleaved streams over consecutive
+// blocks, which are then stitched back together: the first two are shifted past the
+// blocks after them (a table lookup per byte, as multiplying by a constant is linear)
+// and combined with the third.
+enum { kCrc32cBlock = 256 };
+
+struct Crc32cShiftTable
+{
+   inline explicit Crc32cShiftTable(size_t n) noexcept
+   {
+      const uint32_t factor = crc32cShiftFactor(n);
+      for (uint32_t i = 0; i < 256; ++i)
+      {
+         for (int k = 0; k < 4; ++k)
+            table[k][i] = crc32cMultiply(factor, i << (8 * k));
+      }
+   }
+
+   inline uint32_t shift(uint32_t crc) const noexcept
+   {
+      return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+             table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+   }
+
+   uint32_t table[4][256];
+};
+
+inline uint32_t crc32cHardware(uint32_t crc, const UInt8* p, size_t n) noexcept
+{
+   if (n >= 3 * kCrc32cBlock)
+   {
+      static const Crc32cShiftTable shiftOne(kCrc32cBlock);
+      static const Crc32cShiftTable shiftTwo(2 * kCrc32cBlock);
+      for (; n >= 3 * kCrc32cBlock; p += 3 * kCrc32cBlock, n -= 3 * kCrc32cBlock)
+      {
+         uint32_t a = crc;
+         uint32_t b = 0;
+         uint32_t c = 0;
+         for (size_t i = 0; i < kCrc32cBlock; i += 8)
+         {
+            a = crc32cWord(a, p + i);
+            b = crc32cWord(b, p + kCrc32cBlock + i);
+            c = crc32cWord(c, p + 2 * kCrc32cBlock + i);
+         }
+         crc = shiftTwo.shift(a) ^ shiftOne.shift(b) ^ c;
+      }
+   }
+   for (; n >= 8; p += 8, n -= 8)
+      crc = crc32cWord(crc, p);
+   for (; n != 0; ++p, --n)
+      crc = crc32cByte(crc, *p);
+   return crc;
+}
+
+#endif
+
+// XXH64's primes.
+enum : uint64_t
+{
+   kXXPrime1 = 0x9E3779B185EBCA87ull,
+   kXXPrime2 = 0xC2B2AE3D27D4EB4Full,
+   kXXPrime3 = 0x165667B19E3779F9ull,
+   kXXPrime4 = 0x85EBCA77C2B2AE63ull,
+   kXXPrime5 = 0x27D4EB2F165667C5ull
+};
+
+inline uint64_t rotateLeft(uint64_t x, int r) noexcept
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t xxRound(uint64_t accumulator, uint64_t input) noexcept
+{
+   accumulator += input * kXXPrime2;
+   return rotateLeft(accumulator, 31) * kXXPrime1;
+}
+
+inline uint64_t xxMergeRound(uint64_t accumulator, uint64_t value) noexcept
+{
+   accumulator ^= xxRound(0, value);
+   return accumulator * kXXPrime1 + kXXPrime4;
+}
+
+// Runs the four lanes over as many whole 32-byte stripes as there are; returns the
+// number of bytes consumed.
+inline size_t xxStripes(uint64_t (&v)[4], const UInt8* p, size_t n) noexcept
+{
+   size_t done = 0;
+   for (; n - done >= 32; done += 32)
+   {
+      v[0] = xxRound(v[0], loadLittleEndian<uint64_t>(p + done));
+      v[1] = xxRound(v[1], loadLittleEndian<uint64_t>(p + done + 8));
+      v[2] = xxRound(v[2], loadLittleEndian<uint64_t>(p + done + 16));
+      v[3] = xxRound(v[3], loadLittleEndian<uint64_t>(p + done + 24));
+   }
+   return done;
+}
+
+// Everything after the stripes: folds in the lanes (if there were any stripes), the
+// total length and the last (fewer than 32) bytes, then mixes.
+inline uint64_t xxFinish(const uint64_t (&v)[4], bool striped, uint64_t seed, uint64_t total,
+   const UInt8* p, size_t n) noexcept
+{
+   uint64_t h;
+   if (striped)
+   {
+      h = rotateLeft(v[0], 1) + rotateLeft(v[1], 7) + rotateLeft(v[2], 12) + rotateLeft(v[3], 18);
+      for (int i = 0; i < 4; ++i)
+         h = xxMergeRound(h, v[i]);
+   }
+   else
+   {
+      h = seed + kXXPrime5;
+   }
+   h += total;
+
+   for (; n >= 8; p += 8, n -= 8)
+      h = rotateLeft(h ^ xxRound(0, loadLittleEndian<uint64_t>(p)), 27) * kXXPrime1 + kXXPrime4;
+   if (n >= 4)
+   {
+      h = rotateLeft(h ^ (loadLittleEndian<uint32_t>(p) * kXXPrime1), 23) * kXXPrime2 + kXXPrime3;
+      p += 4;
+      n -= 4;
+   }
+   for (; n != 0; ++p, --n)
+      h = rotateLeft(h ^ (*p * kXXPrime5), 11) * kXXPrime1;
+
+   h ^= h >> 33;
+   h *= kXXPrime2;
+   h ^= h >> 29;
+   h *= kXXPrime3;
+   h ^= h >> 32;
+   return h;
+}
+
+inline void xxStart(uint64_t (&v)[4], uint64_t seed) noexcept
+{
+   v[0] = seed + kXXPrime1 + kXXPrime2;
+   v[1] = seed + kXXPrime2;
+   v[2] = seed;
+   v[3] = seed - kXXPrime1;
+}
+
+} // namespace Detail
+
+// CRC32C (the Castagnoli CRC used by iSCSI, ext4, and others) of 'n' bytes. Passing the
+// result for the bytes before these as 'crc' extends it, so crc32c(b, crc32c(a)) is the
+// CRC of a followed by b.
+inline uint32_t crc32c(const UInt8* bytes, size_t n, uint32_t crc = 0) noexcept
+{
+#if defined(CFXX_HAS_SSE42) || defined(CFXX_HAS_ARM_CRC32)
+   return ~Detail::crc32cHardware(~crc, bytes, n);
+#else
+   return ~Detail::crc32cScalar(~crc, bytes, n);
+#endif
+}
+
+inline uint32_t crc32c(DataView data, uint32_t crc = 0) noexcept
+{
+   return crc32c(data.data(), static_cast<size_t>(data.size()), crc);
+}
+
+// XXH64 of 'n' bytes: a fast 64-bit non-cryptographic hash, the same as the reference
+// implementation's XXH64(). Its four independent lanes already keep a modern core's
+// multipliers busy, so there's no separate vector path.
+inline uint64_t xxhash64(const UInt8* bytes, size_t n, uint64_t seed = 0) noexcept
+{
+   uint64_t v[4];
+   Detail::xxStart(v, seed);
+   const size_t striped = Detail::xxStripes(v, bytes, n);
+   return Detail::xxFinish(v, striped != 0, seed, n, bytes + striped, n - striped);
+}
+
+inline uint64_t xxhash64(DataView data, uint64_t seed = 0) noexcept
+{
+   return xxhash64(data.data(), static_cast<size_t>(data.size()), seed);
+}
+
+// Incremental CRC32C, for bytes that arrive in pieces: e.g. each chunk as it's appended
+// to a MutableData, rather than the whole thing again at the end.
+class Crc32c
+{
+public:
+   inline explicit Crc32c(uint32_t crc = 0) noexcept :
+      m_crc(crc)
+   { }
+
+   inline Crc32c& update(const UInt8* bytes, size_t n) noexcept
+   {
+      m_crc = crc32c(bytes, n, m_crc);
+      return *this;
+   }
+
+   inline Crc32c& update(DataView data) noexcept
+   {
+      return update(data.data(), static_cast<size_t>(data.size()));
+   }
+
+   inline uint32_t value() const noexcept
+   {
+      return m_crc;
+   }
+
+   inline void reset(uint32_t crc = 0) noexcept
+   {
+      m_crc = crc;
+   }
+
+private:
+   uint32_t m_crc;
+};
+
+// Incremental XXH64. Gives the same value as xxhash64() over all of the bytes together,
+// however they were split up.
+class XXHash64
+{
+public:
+   inline explicit XXHash64(uint64_t seed = 0) noexcept
+   {
+      reset(seed);
+   }
+
+   inline XXHash64& update(const UInt8* bytes, size_t n) noexcept
+   {
+      const UInt8* p = bytes;
+      m_total += n;
+
+      // Top up a partial stripe left over from last time first.
+      if (m_buffered != 0)
+      {
+         const size_t take = std::min(n, sizeof(m_buffer) - m_buffered);
+         std::memcpy(m_buffer + m_buffered, p, take);
+         m_buffered += take;
+         p += take;
+         n -= take;
+         if (m_buffered < sizeof(m_buffer))
+            return *this;
+         Detail::xxStripes(m_lanes, m_buffer, sizeof(m_buffer));
+         m_buffered = 0;
+      }
+
+      const size_t striped = Detail::xxStripes(m_lanes, p, n);
+      std::memcpy(m_buffer, p + striped, n - striped);
+      m_buffered = n - striped;
+      return *this;
+   }
+
+   inline XXHash64& update(DataView data) noexcept
+   {
+      return update(data.data(), static_cast<size_t>(data.size()));
+   }
+
+   // The hash of everything so far; more can still be added afterwards.
+   inline uint64_t digest() const noexcept
+   {
+      return Detail::xxFinish(m_lanes, m_total >= sizeof(m_buffer), m_seed, m_total, m_buffer, m_buffered);
+   }
+
+   inline void reset(uint64_t seed = 0) noexcept
+   {
+      Detail::xxStart(m_lanes, seed);
+      m_seed = seed;
+      m_total = 0;
+      m_buffered = 0;
+   }
+
+private:
+   uint64_t m_lanes[4];
+   uint64_t m_seed;
+   uint64_t m_total;
+   UInt8 m_buffer[32];
+   size_t m_buffered;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_checksum_h__
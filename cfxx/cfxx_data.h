@@ -29,14 +29,27 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreFoundation/CFData.h>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
 #include <string>
+#include <system_error>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace CoreFoundation
 {
 
 class Data;
+class DataChain;
+class DataSplit;
 class MutableData;
+class String;
 
 template<>
 struct IsParentCFType<CFTypeRef, CFDataRef> : public std::integral_constant<bool, true> {};
@@ -56,6 +69,148 @@ struct ParentCFType<CFMutableDataRef>
    typedef CFDataRef type;
 };
 
+// Hints passed to madvise() for a mapping made by Data::map_file().
+enum class MapAdvice
+{
+   Normal,     // Let the kernel decide.
+   Sequential, // Read ahead aggressively; pages behind the reader can be dropped.
+   Random,     // Don't bother reading ahead.
+   WillNeed    // Start paging the whole file in now.
+};
+
+// How Data::from_base64() and Data::from_hex() (and the decoders in cfxx_encoding.h)
+// treat their input.
+enum class DecodeMode
+{
+   Strict,     // Only the encoding's own characters; base64 has to be padded.
+   Lenient     // Whitespace anywhere is skipped, and base64 padding is optional.
+};
+
+// DataView is a non-owning view of a run of bytes (usually part of a Data), in the spirit
+// of std::string_view. It's for passing bytes around internally, e.g. the fields of a
+// message being parsed, without any CF objects or copying; the bytes have to outlive it.
+// Data::slice() is the equivalent that does own (a reference to) its bytes.
+class DataView
+{
+public:
+   typedef UInt8                                 value_type;
+   typedef const UInt8&                          const_reference;
+   typedef const UInt8*                          const_pointer;
+   typedef CFIndex                               size_type;
+   typedef const_pointer                         const_iterator;
+   typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+   inline DataView() noexcept :
+      m_data(nullptr),
+      m_size(0)
+   { }
+
+   inline DataView(const UInt8* bytes, size_type length) noexcept :
+      m_data(bytes),
+      m_size(length)
+   { }
+
+   inline DataView(const Data& data) noexcept;
+
+   inline const_iterator begin() const noexcept
+   {
+      return m_data;
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return m_data + m_size;
+   }
+
+   inline const_reverse_iterator rbegin() const noexcept
+   {
+      return const_reverse_iterator(end());
+   }
+
+   inline const_reverse_iterator rend() const noexcept
+   {
+      return const_reverse_iterator(begin());
+   }
+
+   inline const_reference operator[](size_type index) const noexcept
+   {
+      return m_data[index];
+   }
+
+   inline const_reference at(size_type index) const
+   {
+      if (index < 0 || index >= m_size)
+         throw std::out_of_range("DataView");
+      return m_data[index];
+   }
+
+   inline const_pointer data() const noexcept
+   {
+      return m_data;
+   }
+
+   inline size_type size() const noexcept
+   {
+      return m_size;
+   }
+
+   inline bool empty() const noexcept
+   {
+      return m_size == 0;
+   }
+
+   // The 'length' bytes starting at 'offset'.
+   inline DataView subview(size_type offset, size_type length) const
+   {
+      if (offset < 0 || length < 0 || offset > m_size || length > m_size - offset)
+         throw std::out_of_range("DataView");
+      return DataView(m_data + offset, length);
+   }
+
+   // Everything from 'offset' on.
+   inline DataView subview(size_type offset) const
+   {
+      if (offset < 0 || offset > m_size)
+         throw std::out_of_range("DataView");
+      return DataView(m_data + offset, m_size - offset);
+   }
+
+   // The index of the first byte or run of bytes at or after 'from' that matches, or
+   // kCFNotFound. The rfind()s look for the last match starting at or before 'from'
+   // (by default, anywhere). An empty pattern matches at 'from'. Defined in cfxx_search.h.
+   inline size_type find(UInt8 value, size_type from = 0) const noexcept;
+   inline size_type find(DataView pattern, size_type from = 0) const noexcept;
+   inline size_type rfind(UInt8 value, size_type from = kCFNotFound) const noexcept;
+   inline size_type rfind(DataView pattern, size_type from = kCFNotFound) const noexcept;
+
+   // The first byte at or after 'from' that is (or isn't) one of the bytes in 'set'.
+   inline size_type find_first_of(DataView set, size_type from = 0) const noexcept;
+   inline size_type find_first_not_of(DataView set, size_type from = 0) const noexcept;
+
+   // Lazily splits the bytes into the fields between each occurrence of 'delimiter', as
+   // DataViews of this one's bytes: n delimiters always make n + 1 fields, some of which
+   // may be empty. tokenize() instead yields the non-empty runs of bytes that aren't in
+   // 'delimiters'. Defined in cfxx_search.h.
+   inline DataSplit split(UInt8 delimiter) const noexcept;
+   inline DataSplit split(DataView delimiter) const;
+   inline DataSplit tokenize(DataView delimiters) const noexcept;
+
+private:
+   const UInt8* m_data;
+   size_type m_size;
+};
+
+inline bool operator==(const DataView& a, const DataView& b) noexcept
+{
+   return a.size() == b.size() &&
+      (a.data() == b.data() || std::memcmp(a.data(), b.data(), static_cast<size_t>(a.size())) == 0);
+}
+
+inline bool operator!=(const DataView& a, const DataView& b) noexcept
+{
+   return !(a == b);
+}
+
 class Data : public Base
 {
 public:
@@ -72,23 +227,66 @@ public:
       Base()
    { }
 
-   inline Data(const UInt8* bytes, size_type length) noexcept :
+   // Constructors that create a CFData take an optional CFAllocatorRef to create it
+   // with (see cfxx_allocator.h).
+   inline Data(const UInt8* bytes, size_type length, CFAllocatorRef allocator = kCFAllocatorDefault) noexcept :
       Base(makeCFReferenceFromCopyOrCreate(
          CFDataCreate(
-            kCFAllocatorDefault,
+            allocator,
             reinterpret_cast<const UInt8*>(bytes),
-            length)))
+            length))),
+      m_bytesImmutable(true)
    { }
 
    inline Data(const Data& other) noexcept :
       // CFDatas are immutable, so we can share references.
-      Base(other.m_ref)
+      Base(other.m_ref),
+      m_hash(other.m_hash.load(std::memory_order_relaxed)),
+      m_hashCacheable(other.m_hashCacheable),
+      m_bytesImmutable(other.m_bytesImmutable),
+      m_sliceDeallocator(retainSliceDeallocator(other.m_sliceDeallocator.load(std::memory_order_acquire)))
    { }
 
    inline Data(Data&& other) noexcept :
-      Base(std::move(other.m_ref))
+      Base(std::move(other.m_ref)),
+      m_hash(other.m_hash.load(std::memory_order_relaxed)),
+      m_hashCacheable(other.m_hashCacheable),
+      m_bytesImmutable(other.m_bytesImmutable),
+      m_sliceDeallocator(other.m_sliceDeallocator.exchange(nullptr))
    { }
 
+   inline ~Data()
+   {
+      releaseSliceDeallocator();
+   }
+
+   inline Data& operator=(const Data& other) noexcept
+   {
+      if (&other == this)
+         return *this;
+      releaseSliceDeallocator();
+      m_ref = other.m_ref;
+      m_hash.store(other.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      m_hashCacheable = other.m_hashCacheable;
+      m_bytesImmutable = other.m_bytesImmutable;
+      m_sliceDeallocator.store(retainSliceDeallocator(other.m_sliceDeallocator.load(std::memory_order_acquire)));
+      return *this;
+   }
+
+   inline Data& operator=(Data&& other) noexcept
+   {
+      if (&other != this)
+      {
+         releaseSliceDeallocator();
+         m_ref = std::move(other.m_ref);
+         m_hash.store(other.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+         m_hashCacheable = other.m_hashCacheable;
+         m_bytesImmutable = other.m_bytesImmutable;
+         m_sliceDeallocator.store(other.m_sliceDeallocator.exchange(nullptr));
+      }
+      return *this;
+   }
+
    inline const_iterator begin() const noexcept
    {
       return CFDataGetBytePtr(getRef());
@@ -141,6 +339,116 @@ public:
       return CFDataGetLength(getRef()) == 0;
    }
 
+   inline DataView view() const noexcept
+   {
+      return DataView(data(), size());
+   }
+
+   // The 'length' bytes starting at 'offset', as a Data of its own that shares this one's
+   // bytes rather than copying them: it's created with CFDataCreateWithBytesNoCopy, and
+   // keeps this Data's CFData alive until it's done with them. O(1) whatever the length.
+   // A slice of a slice keeps the original CFData alive rather than the slice in between,
+   // so repeated slicing never builds up a chain of CFDatas.
+   //
+   // A MutableData's bytes can move or change, so slicing one copies the bytes instead;
+   // so does slicing a Data whose CFData might be a CFMutableData (see m_bytesImmutable).
+   inline Data slice(size_type offset, size_type length, CFAllocatorRef allocator = kCFAllocatorDefault) const
+   {
+      if (offset < 0 || length < 0 || offset > size() || length > size() - offset)
+         throw std::out_of_range("Data");
+      if (!m_bytesImmutable)
+         return Data(data() + offset, length, allocator);
+      if (offset == 0 && length == size())
+         return *this;
+
+      const CFAllocatorRef deallocator = sliceDeallocator();
+      Data result = withImmutableBytes(makeCFReferenceFromCopyOrCreate(
+         CFDataCreateWithBytesNoCopy(
+            allocator,
+            data() + offset,
+            length,
+            deallocator)));
+      // Unless CF copied the bytes after all, the slice's own slices can use the same
+      // deallocator, and so hold on to the same CFData.
+      if (result.data() == data() + offset)
+         result.m_sliceDeallocator.store(retainSliceDeallocator(deallocator), std::memory_order_release);
+      return result;
+   }
+
+   // Everything from 'offset' on.
+   inline Data slice(size_type offset) const
+   {
+      if (offset < 0 || offset > size())
+         throw std::out_of_range("Data");
+      return slice(offset, size() - offset);
+   }
+
+   // The same searches as DataView's, over all of the bytes. Like view(), the DataViews
+   // that split() and tokenize() yield are only good for as long as this Data is.
+   inline size_type find(UInt8 value, size_type from = 0) const noexcept
+   {
+      return view().find(value, from);
+   }
+
+   inline size_type find(DataView pattern, size_type from = 0) const noexcept
+   {
+      return view().find(pattern, from);
+   }
+
+   inline size_type rfind(UInt8 value, size_type from = kCFNotFound) const noexcept
+   {
+      return view().rfind(value, from);
+   }
+
+   inline size_type rfind(DataView pattern, size_type from = kCFNotFound) const noexcept
+   {
+      return view().rfind(pattern, from);
+   }
+
+   inline size_type find_first_of(DataView set, size_type from = 0) const noexcept
+   {
+      return view().find_first_of(set, from);
+   }
+
+   inline size_type find_first_not_of(DataView set, size_type from = 0) const noexcept
+   {
+      return view().find_first_not_of(set, from);
+   }
+
+   inline DataSplit split(UInt8 delimiter) const noexcept;
+   inline DataSplit split(DataView delimiter) const;
+   inline DataSplit tokenize(DataView delimiters) const noexcept;
+
+   // The bytes as padded base64, or as lowercase hex. The characters are encoded straight
+   // into the buffer that the String then takes over. Defined in cfxx_encoding.h.
+   inline String to_base64(CFAllocatorRef allocator = kCFAllocatorDefault) const;
+   inline String to_hex(CFAllocatorRef allocator = kCFAllocatorDefault) const;
+
+   // Decode base64 or hex (in either case) straight into the buffer that the Data then takes
+   // over. Throws std::invalid_argument if 's' isn't valid. Defined in cfxx_encoding.h.
+   inline static Data from_base64(const String& s, DecodeMode mode = DecodeMode::Strict,
+      CFAllocatorRef allocator = kCFAllocatorDefault);
+   inline static Data from_hex(const String& s, DecodeMode mode = DecodeMode::Strict,
+      CFAllocatorRef allocator = kCFAllocatorDefault);
+
+   // CFHash() of the bytes. Remembered after the first call, except for MutableData,
+   // whose bytes can change behind our back through data() and the iterators.
+   inline CFHashCode hash() const noexcept
+   {
+      if (!m_ref)
+         return 0;
+      if (!m_hashCacheable)
+         return CFHash(getRef());
+
+      CFHashCode hash = m_hash.load(std::memory_order_relaxed);
+      if (hash == 0)
+      {
+         hash = CFHash(getRef());
+         m_hash.store(hash, std::memory_order_relaxed);
+      }
+      return hash;
+   }
+
    inline operator CFDataRef() const noexcept
    {
       return getRef();
@@ -151,18 +459,300 @@ public:
       return CFDataGetTypeID();
    }
 
+   // Maps 'path' read-only into memory and wraps the mapping without copying it;
+   // pages are only read in as they are touched. The mapping is unmapped when the
+   // last reference to the CFData goes away. The file must not be truncated while
+   // it is mapped. Throws std::system_error if the file can't be opened or mapped.
+   inline static Data map_file(const std::string& path, MapAdvice advice = MapAdvice::Normal,
+      CFAllocatorRef allocator = kCFAllocatorDefault)
+   {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         throw std::system_error(errno, std::generic_category(), "Data::map_file");
+
+      struct stat info;
+      if (::fstat(fd, &info) != 0)
+      {
+         int error = errno;
+         ::close(fd);
+         throw std::system_error(error, std::generic_category(), "Data::map_file");
+      }
+
+      // mmap() refuses zero-length mappings.
+      if (info.st_size == 0)
+      {
+         ::close(fd);
+         return Data(nullptr, 0, allocator);
+      }
+
+      size_t length = static_cast<size_t>(info.st_size);
+      void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      int error = errno;
+      // The mapping keeps its own reference to the file.
+      ::close(fd);
+      if (address == MAP_FAILED)
+         throw std::system_error(error, std::generic_category(), "Data::map_file");
+
+      adviseMapping(address, length, advice);
+
+      CFReference<CFAllocatorRef> deallocator =
+         makeOwningDeallocator(new FileMapping(address, length));
+      return withImmutableBytes(makeCFReferenceFromCopyOrCreate(
+         CFDataCreateWithBytesNoCopy(
+            allocator,
+            static_cast<const UInt8*>(address),
+            static_cast<CFIndex>(length),
+            deallocator.get())));
+   }
+
+   // Reads all of 'path' into a buffer allocated with 'allocator', which the CFData then
+   // takes over (CFDataCreateWithBytesNoCopy), so the bytes are only copied once, by the
+   // read itself. Better than map_file() for small files, which aren't worth a mapping.
+   // Reads until end of file, so a file that grows after it's opened isn't cut short, and
+   // files whose size fstat() doesn't know (pipes, /proc) work too.
+   // Throws std::system_error if the file can't be read, or with EFBIG if it's larger
+   // than 'max_size' bytes.
+   inline static Data read_file(const std::string& path, size_t max_size = static_cast<size_t>(-1),
+      CFAllocatorRef allocator = kCFAllocatorDefault)
+   {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         throw std::system_error(errno, std::generic_category(), "Data::read_file");
+
+      struct stat info;
+      if (::fstat(fd, &info) != 0)
+      {
+         int error = errno;
+         ::close(fd);
+         throw std::system_error(error, std::generic_category(), "Data::read_file");
+      }
+      if (S_ISREG(info.st_mode) && static_cast<size_t>(info.st_size) > max_size)
+      {
+         ::close(fd);
+         throw std::system_error(EFBIG, std::generic_category(), "Data::read_file");
+      }
+
+      // A regular file's size is taken as the likely length, so the usual case allocates
+      // exactly once; anything else starts from kReadFileChunk and doubles.
+      size_t capacity = S_ISREG(info.st_mode) && info.st_size > 0 ?
+         static_cast<size_t>(info.st_size) : std::min<size_t>(kReadFileChunk, max_size);
+      UInt8* bytes = nullptr;
+      if (capacity > 0)
+      {
+         bytes = static_cast<UInt8*>(CFAllocatorAllocate(allocator, static_cast<CFIndex>(capacity), 0));
+         if (!bytes)
+         {
+            ::close(fd);
+            throw std::bad_alloc();
+         }
+      }
+
+      size_t done = 0;
+      int error = 0;
+      for (;;)
+      {
+         // With the buffer full, read one more byte to tell end of file from a file that
+         // has grown, before paying for a bigger buffer.
+         UInt8 probe;
+         const bool full = done == capacity;
+         ssize_t n = full ? ::read(fd, &probe, 1) : ::read(fd, bytes + done, capacity - done);
+         if (n < 0 && errno == EINTR)
+            continue;
+         if (n < 0)
+         {
+            error = errno;
+            break;
+         }
+         if (n == 0)
+            break;
+         if (!full)
+         {
+            done += static_cast<size_t>(n);
+            continue;
+         }
+
+         if (done >= max_size)
+         {
+            error = EFBIG;
+            break;
+         }
+         const size_t grown = std::min(std::max<size_t>(capacity * 2, kReadFileChunk), max_size);
+         UInt8* moved = static_cast<UInt8*>(bytes ?
+            CFAllocatorReallocate(allocator, bytes, static_cast<CFIndex>(grown), 0) :
+            CFAllocatorAllocate(allocator, static_cast<CFIndex>(grown), 0));
+         if (!moved)
+         {
+            ::close(fd);
+            CFAllocatorDeallocate(allocator, bytes);
+            throw std::bad_alloc();
+         }
+         bytes = moved;
+         capacity = grown;
+         bytes[done++] = probe;
+      }
+      ::close(fd);
+
+      if (error != 0 || done == 0)
+      {
+         if (bytes)
+            CFAllocatorDeallocate(allocator, bytes);
+         if (error != 0)
+            throw std::system_error(error, std::generic_category(), "Data::read_file");
+         return Data(nullptr, 0, allocator);
+      }
+
+      return withImmutableBytes(makeCFReferenceFromCopyOrCreate(
+         CFDataCreateWithBytesNoCopy(
+            allocator,
+            bytes,
+            static_cast<CFIndex>(done),
+            allocator)));
+   }
+
+   // A non-owning view of the underlying CFDataRef, valid for as long as this Data is.
+   inline CFBorrowed<CFDataRef> borrow() const noexcept
+   {
+      return CFBorrowed<CFDataRef>(getRef());
+   }
+
 protected:
+   friend class DataChain;
+
    inline Data(const CFReference<CFDataRef>& ref) :
       Base(ref)
    { }
 
+   inline Data(CFReference<CFDataRef>&& ref) noexcept :
+      Base(std::move(ref))
+   { }
+
+   // For CFDatas that are known to be immutable because they were just created as such.
+   inline static Data withImmutableBytes(CFReference<CFDataRef>&& ref) noexcept
+   {
+      Data data(std::move(ref));
+      data.m_bytesImmutable = true;
+      return data;
+   }
+
+   // Called by MutableData's constructors.
+   inline void disableHashCache() noexcept
+   {
+      m_hashCacheable = false;
+      m_hash.store(0, std::memory_order_relaxed);
+   }
+
 private:
+   // What read_file() starts with, and grows by at least, when fstat() has no size.
+   enum { kReadFileChunk = 4096 };
+
+   // Keeps the CFData a slice was taken from alive; handed to makeOwningDeallocator().
+   struct SliceOwner
+   {
+      inline explicit SliceOwner(const CFReference<CFTypeRef>& parent) noexcept :
+         m_parent(parent)
+      { }
+
+      CFReference<CFTypeRef> m_parent;
+   };
+
+   // The deallocator for slices of this Data, which keeps the CFData that owns its bytes
+   // alive. Every slice shares the same one (CF retains it for each), so that only the
+   // first slice pays for creating it.
+   inline CFAllocatorRef sliceDeallocator() const
+   {
+      CFAllocatorRef deallocator = m_sliceDeallocator.load(std::memory_order_acquire);
+      if (deallocator)
+         return deallocator;
+
+      CFReference<CFAllocatorRef> created = makeOwningDeallocator(new SliceOwner(m_ref));
+      CFAllocatorRef expected = nullptr;
+      if (m_sliceDeallocator.compare_exchange_strong(expected, created.get()))
+         return created.detach();
+      // Another thread got there first.
+      return expected;
+   }
+
+   inline static CFAllocatorRef retainSliceDeallocator(CFAllocatorRef deallocator) noexcept
+   {
+      if (deallocator)
+         CFRetain(deallocator);
+      return deallocator;
+   }
+
+   inline void releaseSliceDeallocator() noexcept
+   {
+      CFAllocatorRef deallocator = m_sliceDeallocator.exchange(nullptr);
+      if (deallocator)
+         releaseReference(deallocator);
+   }
+
+   // Owns a region returned by mmap(); handed to makeOwningDeallocator().
+   struct FileMapping
+   {
+      inline FileMapping(void* address, size_t length) noexcept :
+         m_address(address),
+         m_length(length)
+      { }
+
+      inline ~FileMapping()
+      {
+         ::munmap(m_address, m_length);
+      }
+
+      void*  m_address;
+      size_t m_length;
+   };
+
+   inline static void adviseMapping(void* address, size_t length, MapAdvice advice) noexcept
+   {
+      int flag = MADV_NORMAL;
+      switch (advice)
+      {
+      case MapAdvice::Normal:     flag = MADV_NORMAL;     break;
+      case MapAdvice::Sequential: flag = MADV_SEQUENTIAL; break;
+      case MapAdvice::Random:     flag = MADV_RANDOM;     break;
+      case MapAdvice::WillNeed:   flag = MADV_WILLNEED;   break;
+      }
+      // Only a hint; a failure here doesn't make the mapping any less usable.
+      if (flag != MADV_NORMAL)
+         (void)::madvise(address, length, flag);
+   }
+
    inline CFDataRef getRef() const
    {
       return reinterpret_cast<CFDataRef>(m_ref.get());
    }
+
+   // CFHash() of the bytes, or 0 if it hasn't been asked for yet (or happens to be 0).
+   mutable std::atomic<CFHashCode> m_hash { 0 };
+   // False exactly for MutableData.
+   bool m_hashCacheable = true;
+   // Whether the bytes are known never to move or change, so that slice() can share them.
+   // CFDataGetTypeID() is the same for a CFMutableData, so a Data made from some other
+   // CFDataRef can't tell, and has to assume they might; so does MutableData.
+   bool m_bytesImmutable = false;
+   // Created by the first slice() and owned by this Data; see sliceDeallocator(). Copies
+   // share it, and so do slices, since their bytes belong to the same CFData.
+   mutable std::atomic<CFAllocatorRef> m_sliceDeallocator { nullptr };
 };
 
+inline DataView::DataView(const Data& data) noexcept :
+   m_data(data.data()),
+   m_size(data.size())
+{ }
+
+inline bool operator==(const Data& a, const Data& b) noexcept
+{
+   if (static_cast<CFDataRef>(a) == static_cast<CFDataRef>(b))
+      return true;
+   return a.size() == b.size() && std::memcmp(a.data(), b.data(), static_cast<size_t>(a.size())) == 0;
+}
+
+inline bool operator!=(const Data& a, const Data& b) noexcept
+{
+   return !(a == b);
+}
+
 class MutableData : public Data
 {
 public:
@@ -170,21 +760,117 @@ public:
    typedef std::reverse_iterator<iterator> reverse_iterator;
 
    inline MutableData() noexcept :
-      Data()
+      MutableData(kCFAllocatorDefault)
    { }
 
-   inline MutableData(const Data& other) noexcept :
+   inline explicit MutableData(CFAllocatorRef allocator) noexcept :
+      Data(makeCFReferenceFromCopyOrCreate(
+         CFDataCreateMutable(
+            allocator, 0)))
+   {
+      disableHashCache();
+   }
+
+   inline MutableData(const Data& other, CFAllocatorRef allocator = kCFAllocatorDefault) noexcept :
       Data(makeCFReferenceFromCopyOrCreate(
          CFDataCreateMutableCopy(
-            kCFAllocatorDefault, 0, other)))
+            allocator, 0, other))),
+      m_capacity(other.size())
+   {
+      disableHashCache();
+   }
+
+   // Copies are deep; unlike immutable Datas, MutableDatas can't share storage.
+   inline MutableData(const MutableData& other) noexcept :
+      MutableData(static_cast<const Data&>(other))
    { }
 
    inline MutableData(MutableData&& other) noexcept :
-      Data(std::move(other.m_ref))
-   { }
+      Data(std::move(other.m_ref)),
+      m_capacity(other.m_capacity)
+   {
+      other.m_capacity = 0;
+      disableHashCache();
+   }
+
+   inline MutableData& operator=(const MutableData& other) noexcept
+   {
+      if (&other != this)
+         *this = MutableData(other);
+      return *this;
+   }
+
+   inline MutableData& operator=(MutableData&& other) noexcept
+   {
+      if (&other != this)
+      {
+         Data::operator=(std::move(other));
+         m_capacity = other.m_capacity;
+         other.m_capacity = 0;
+         disableHashCache();
+      }
+      return *this;
+   }
+
+   // An empty MutableData with room for 'capacity' bytes.
+   inline static MutableData with_capacity(size_type capacity, CFAllocatorRef allocator = kCFAllocatorDefault) noexcept
+   {
+      MutableData data(allocator);
+      data.reserve(capacity);
+      return data;
+   }
+
+   // Number of bytes the data can hold before its storage has to be reallocated.
+   //
+   // CF doesn't report this, so it's tracked here. It's exact as long as the data is
+   // only changed through this class.
+   inline size_type capacity() const noexcept
+   {
+      return std::max(m_capacity, size());
+   }
+
+   // Make room for at least 'n' bytes, so that growing up to 'n' doesn't reallocate.
+   inline void reserve(size_type n) noexcept
+   {
+      if (n <= capacity())
+         return;
+      // There's no CF call to set the capacity of a CFMutableData, but its storage never
+      // shrinks when the length does, so growing it to 'n' and back again leaves room
+      // for 'n' bytes. (CF zero-fills the bytes on the way, so this costs a memset.)
+      const size_type length = size();
+      CFDataSetLength(getRef(), n);
+      CFDataSetLength(getRef(), length);
+      m_capacity = n;
+   }
+
+   inline void clear() noexcept
+   {
+      CFDataSetLength(getRef(), 0);
+   }
+
+   inline void push_back(UInt8 value) noexcept
+   {
+      growBy(1);
+      CFDataAppendBytes(getRef(), &value, 1);
+   }
+
+   inline void pop_back() noexcept
+   {
+      CFDataSetLength(getRef(), size() - 1);
+   }
 
    inline MutableData& append(const UInt8* bytes, size_t n) noexcept
    {
+      if (n == 0)
+         return *this;
+      if (size() + static_cast<size_type>(n) > capacity())
+      {
+         // Appending (part of) ourselves: growing moves the bytes.
+         const size_type offset = isInside(bytes) ? bytes - data() : -1;
+         growBy(n);
+         if (offset >= 0)
+            bytes = data() + offset;
+      }
       CFDataAppendBytes(getRef(), bytes, n);
       return *this;
    }
@@ -194,6 +880,72 @@ public:
       return append(other.data(), other.size());
    }
 
+   // Append a CFData we don't own, without wrapping (and so retaining) it first.
+   inline MutableData& append(CFBorrowed<CFDataRef> other) noexcept
+   {
+      return append(CFDataGetBytePtr(other), CFDataGetLength(other));
+   }
+
+   inline iterator insert(const_iterator pos, UInt8 value) noexcept
+   {
+      return insert(pos, 1, value);
+   }
+
+   inline iterator insert(const_iterator pos, size_type count, UInt8 value) noexcept
+   {
+      const size_type offset = pos - Data::begin();
+      std::memset(openGap(offset, count), value, static_cast<size_t>(count));
+      return begin() + offset;
+   }
+
+   inline iterator insert(const_iterator pos, const UInt8* first, const UInt8* last)
+   {
+      if (isInside(first))
+      {
+         const std::vector<UInt8> copy(first, last);
+         return insert(pos, copy.data(), copy.data() + copy.size());
+      }
+      const size_type offset = pos - Data::begin();
+      std::memcpy(openGap(offset, last - first), first, static_cast<size_t>(last - first));
+      return begin() + offset;
+   }
+
+   template<typename InputIt,
+      typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+   inline iterator insert(const_iterator pos, InputIt first, InputIt last)
+   {
+      const std::vector<UInt8> bytes(first, last);
+      return insert(pos, bytes.data(), bytes.data() + bytes.size());
+   }
+
+   inline void assign(size_type count, UInt8 value) noexcept
+   {
+      clear();
+      reserve(count);
+      CFDataSetLength(getRef(), count);
+      std::memset(data(), value, static_cast<size_t>(count));
+   }
+
+   inline void assign(const UInt8* first, const UInt8* last)
+   {
+      if (isInside(first))
+      {
+         const std::vector<UInt8> copy(first, last);
+         return assign(copy.data(), copy.data() + copy.size());
+      }
+      clear();
+      reserve(last - first);
+      CFDataAppendBytes(getRef(), first, last - first);
+   }
+
+   template<typename InputIt,
+      typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+   inline void assign(InputIt first, InputIt last)
+   {
+      const std::vector<UInt8> bytes(first, last);
+      assign(bytes.data(), bytes.data() + bytes.size());
+   }
+
    inline void erase(iterator pos) noexcept
    {
       CFDataDeleteBytes(getRef(),
@@ -263,10 +1015,21 @@ public:
       return CFDataGetMutableBytePtr(getRef());
    }
 
+   // New bytes are zero.
    inline void resize(size_type n) noexcept
    {
+      if (n > size())
+         growBy(n - size());
       CFDataSetLength(getRef(), n);
    }
+
+   inline void resize(size_type n, UInt8 value) noexcept
+   {
+      const size_type length = size();
+      resize(n);
+      if (n > length)
+         std::memset(data() + length, value, static_cast<size_t>(n - length));
+   }
    
    inline operator CFMutableDataRef() const noexcept
    {
@@ -274,10 +1037,54 @@ public:
    }
 
 private:
+   friend class DataWriter;
+   friend class MutableDataStreamBuf;
+
+   enum { kMinimumGrowth = 64 };
+
    inline CFMutableDataRef getRef() const noexcept
    {
       return reinterpret_cast<CFMutableDataRef>(const_cast<void *>(m_ref.get()));
    }
+
+   // Make sure there's room for 'n' more bytes. Capacity at least doubles each time it
+   // has to grow, so that building data up a byte at a time is amortized O(1) per byte.
+   inline void growBy(size_type n) noexcept
+   {
+      const size_type needed = size() + n;
+      if (needed > capacity())
+         reserve(std::max(needed, std::max<size_type>(capacity() * 2, kMinimumGrowth)));
+   }
+
+   // Make room for at least 'n' bytes as growBy() would, and then make the length the
+   // whole capacity, for writers that encode straight into the spare bytes and trim the
+   // length back when they're done. Unlike reserve() followed by resize(), this sets the
+   // length once, so CF zero-fills the new bytes once.
+   inline void growToCapacity(size_type n) noexcept
+   {
+      if (n > capacity())
+         m_capacity = std::max(n, std::max<size_type>(capacity() * 2, kMinimumGrowth));
+      CFDataSetLength(getRef(), capacity());
+   }
+
+   // Insert 'n' uninitialized bytes at 'offset', and return a pointer to them.
+   inline UInt8* openGap(size_type offset, size_type n) noexcept
+   {
+      const size_type length = size();
+      growBy(n);
+      CFDataSetLength(getRef(), length + n);
+      UInt8* bytes = CFDataGetMutableBytePtr(getRef());
+      std::memmove(bytes + offset + n, bytes + offset, static_cast<size_t>(length - offset));
+      return bytes + offset;
+   }
+
+   inline bool isInside(const UInt8* p) const noexcept
+   {
+      const UInt8* bytes = Data::data();
+      return bytes && p >= bytes && p < bytes + size();
+   }
+
+   size_type m_capacity = 0;
 };
 
 } // namespace CoreFoundation
@@ -0,0 +1,703 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_encoding_h__
+#define __cfxx_encoding_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include "cfxx_data.h"
+#include "cfxx_string.h"
+
+// As in cfxx_unicode.h, the vector kernels are used when the compiler is targeting an
+// instruction set that has them: SSSE3 for its byte shuffle, or NEON on AArch64. Plain
+// x86-64 only promises SSE2, so the SSSE3 kernels have to be asked for (-mssse3, or an
+// -march that includes it); without that, x86 builds use the scalar code. Define
+// CFXX_NO_SIMD to force the scalar code paths everywhere.
+#if !defined(CFXX_NO_SIMD)
+   #if defined(__SSSE3__)
+      #define CFXX_HAS_SSSE3 1
+      #include <tmmintrin.h>
+   #endif
+   #if defined(__ARM_NEON) && defined(__aarch64__)
+      #define CFXX_HAS_NEON 1
+      #include <arm_neon.h>
+   #endif
+#endif
+
+namespace CoreFoundation
+{
+
+// Base64 (RFC 4648, with the '+' and '/' alphabet and '=' padding) and hex encoding.
+//
+// The encoders write straight into a caller-sized buffer. The decoders take their input in
+// pieces, so that multi-megabyte inputs can be decoded as they arrive (or as
+// String::for_each_chunk hands them out) without being gathered up first. Both throw
+// std::invalid_argument on malformed input. In DecodeMode::Lenient they skip ASCII
+// whitespace, and base64 padding is optional.
+
+namespace Detail
+{
+
+enum : UInt8
+{
+   kDecodeInvalid    = 0xFF,
+   kDecodeWhitespace = 0xFE,
+   kDecodePadding    = 0xFD
+};
+
+inline const char* base64Alphabet() noexcept
+{
+   return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+inline const char* hexDigits() noexcept
+{
+   return "0123456789abcdef";
+}
+
+// Character to value tables for the decoders; anything that isn't a digit maps to one of
+// the kDecode values above.
+struct DecodeTables
+{
+   inline DecodeTables() noexcept
+   {
+      for (int i = 0; i < 256; ++i)
+         base64[i] = hex[i] = kDecodeInvalid;
+      for (int i = 0; i < 64; ++i)
+         base64[static_cast<UInt8>(base64Alphabet()[i])] = static_cast<UInt8>(i);
+      for (int i = 0; i < 10; ++i)
+         hex['0' + i] = static_cast<UInt8>(i);
+      for (int i = 0; i < 6; ++i)
+         hex['a' + i] = hex['A' + i] = static_cast<UInt8>(10 + i);
+      for (const char* c = " \t\n\v\f\r"; *c; ++c)
+         base64[static_cast<UInt8>(*c)] = hex[static_cast<UInt8>(*c)] = kDecodeWhitespace;
+      base64['='] = kDecodePadding;
+   }
+
+   UInt8 base64[256];
+   UInt8 hex[256];
+};
+
+inline const DecodeTables& decodeTables() noexcept
+{
+   static const DecodeTables tables;
+   return tables;
+}
+
+#if defined(CFXX_HAS_SSSE3)
+
+// How much the base64 kernels below take at a time: encodeBase64Block() encodes 12 bytes
+// but reads 16, and decodeBase64Block() decodes 16 characters.
+enum : size_t
+{
+   kBase64EncodeBlock = 12,
+   kBase64EncodeRead  = 16,
+   kBase64DecodeBlock = 16
+};
+
+// 12 bytes to 16 characters; reads 16 bytes. The shuffle gathers each 3-byte group into a
+// 32-bit lane, the multiplies move the four 6-bit fields into bytes of their own, and a
+// second shuffle picks the offset that turns each field into its character.
+inline void encodeBase64Block(const UInt8* in, char* out) noexcept
+{
+   __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+   v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+   const __m128i high = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+   const __m128i low = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+   const __m128i fields = _mm_or_si128(high, low);
+
+   const __m128i offsets = _mm_setr_epi8('A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 0, 0);
+   __m128i index = _mm_subs_epu8(fields, _mm_set1_epi8(51));
+   index = _mm_sub_epi8(index, _mm_cmpgt_epi8(fields, _mm_set1_epi8(25)));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_add_epi8(fields, _mm_shuffle_epi8(offsets, index)));
+}
+
+// 16 characters to 12 bytes, if they're all in the alphabet; stores 16 bytes. Validity is
+// checked with a pair of nibble lookups whose results only overlap for characters
+// outside the alphabet.
+inline bool decodeBase64Block(const UInt8* in, UInt8* out) noexcept
+{
+   const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+   const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+   const __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(v, 4), nibbleMask);
+   const __m128i lowNibbles = _mm_and_si128(v, nibbleMask);
+   const __m128i lowBits = _mm_shuffle_epi8(
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A),
+      lowNibbles);
+   const __m128i highBits = _mm_shuffle_epi8(
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),
+      highNibbles);
+   if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lowBits, highBits), _mm_setzero_si128())) != 0xFFFF)
+      return false;
+
+   // '/' shares its high nibble with '+', so it gets a row of its own.
+   const __m128i isSlash = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+   const __m128i offsets = _mm_shuffle_epi8(
+      _mm_setr_epi8(0, 63 - '/', 62 - '+', 52 - '0', -'A', -'A', 26 - 'a', 26 - 'a', 0, 0, 0, 0, 0, 0, 0, 0),
+      _mm_add_epi8(isSlash, highNibbles));
+   const __m128i fields = _mm_add_epi8(v, offsets);
+
+   // Pack each group of four 6-bit fields into 24 bits, then squeeze out the gaps.
+   const __m128i pairs = _mm_maddubs_epi16(fields, _mm_set1_epi32(0x01400140));
+   const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+      _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+   return true;
+}
+
+// 16 bytes to 32 characters.
+inline void encodeHexBlock(const UInt8* in, char* out) noexcept
+{
+   const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexDigits()));
+   const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+   const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+   const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), nibbleMask));
+   const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(v, nibbleMask));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+}
+
+// The values of 16 hex digits, clearing lanes of 'valid' that aren't hex digits.
+inline __m128i hexValues(__m128i v, __m128i& valid) noexcept
+{
+   const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+   const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+   const __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+   valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+   return _mm_or_si128(
+      _mm_and_si128(isDigit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+      _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+}
+
+// 32 characters to 16 bytes, if they're all hex digits.
+inline bool decodeHexBlock(const UInt8* in, UInt8* out) noexcept
+{
+   __m128i valid = _mm_set1_epi8(-1);
+   const __m128i a = hexValues(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), valid);
+   const __m128i b = hexValues(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), valid);
+   if (_mm_movemask_epi8(valid) != 0xFFFF)
+      return false;
+
+   const __m128i weights = _mm_set1_epi16(0x0110);
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+      _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights)));
+   return true;
+}
+
+#elif defined(CFXX_HAS_NEON)
+
+// The structure loads and stores split and merge 3- and 4-byte groups for free, so the
+// base64 kernels work on 48 bytes (64 characters) at a time, with no over-read.
+enum : size_t
+{
+   kBase64EncodeBlock = 48,
+   kBase64EncodeRead  = 48,
+   kBase64DecodeBlock = 64
+};
+
+// 48 bytes to 64 characters.
+inline void encodeBase64Block(const UInt8* in, char* out) noexcept
+{
+   const UInt8* const alphabet = reinterpret_cast<const UInt8*>(base64Alphabet());
+   uint8x16x4_t table;
+   for (int i = 0; i < 4; ++i)
+      table.val[i] = vld1q_u8(alphabet + 16 * i);
+
+   const uint8x16x3_t v = vld3q_u8(in);
+   const uint8x16_t fieldMask = vdupq_n_u8(0x3F);
+   uint8x16x4_t chars;
+   chars.val[0] = vshrq_n_u8(v.val[0], 2);
+   chars.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[0], 4), vshrq_n_u8(v.val[1], 4)), fieldMask);
+   chars.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[1], 2), vshrq_n_u8(v.val[2], 6)), fieldMask);
+   chars.val[3] = vandq_u8(v.val[2], fieldMask);
+   for (int i = 0; i < 4; ++i)
+      chars.val[i] = vqtbl4q_u8(table, chars.val[i]);
+   vst4q_u8(reinterpret_cast<UInt8*>(out), chars);
+}
+
+// 64 characters to 48 bytes, if they're all in the alphabet. The first half of the decode
+// table covers ASCII in two 64-byte lookups; everything else, and anything the table
+// doesn't map to a value, has its top bit set.
+inline bool decodeBase64Block(const UInt8* in, UInt8* out) noexcept
+{
+   const UInt8* const values = decodeTables().base64;
+   uint8x16x4_t low, high;
+   for (int i = 0; i < 4; ++i)
+   {
+      low.val[i] = vld1q_u8(values + 16 * i);
+      high.val[i] = vld1q_u8(values + 64 + 16 * i);
+   }
+
+   uint8x16x4_t v = vld4q_u8(in);
+   uint8x16_t invalid = vdupq_n_u8(0);
+   for (int i = 0; i < 4; ++i)
+   {
+      const uint8x16_t c = v.val[i];
+      v.val[i] = vqtbx4q_u8(vqtbl4q_u8(low, c), high, vsubq_u8(c, vdupq_n_u8(64)));
+      invalid = vorrq_u8(invalid, vorrq_u8(v.val[i], c));
+   }
+   if (vmaxvq_u8(invalid) & 0x80)
+      return false;
+
+   uint8x16x3_t bytes;
+   bytes.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+   bytes.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+   bytes.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+   vst3q_u8(out, bytes);
+   return true;
+}
+
+// 16 bytes to 32 characters.
+inline void encodeHexBlock(const UInt8* in, char* out) noexcept
+{
+   const uint8x16_t digits = vld1q_u8(reinterpret_cast<const UInt8*>(hexDigits()));
+   const uint8x16_t v = vld1q_u8(in);
+   uint8x16x2_t chars;
+   chars.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(v, 4));
+   chars.val[1] = vqtbl1q_u8(digits, vandq_u8(v, vdupq_n_u8(0x0F)));
+   vst2q_u8(reinterpret_cast<UInt8*>(out), chars);
+}
+
+// The values of 16 hex digits, setting lanes of 'invalid' that aren't hex digits.
+inline uint8x16_t hexValues(uint8x16_t v, uint8x16_t& invalid) noexcept
+{
+   const uint8x16_t digit = vsubq_u8(v, vdupq_n_u8('0'));
+   const uint8x16_t letter = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+   const uint8x16_t isDigit = vcltq_u8(digit, vdupq_n_u8(10));
+   const uint8x16_t isLetter = vcltq_u8(letter, vdupq_n_u8(6));
+   invalid = vorrq_u8(invalid, vmvnq_u8(vorrq_u8(isDigit, isLetter)));
+   return vbslq_u8(isDigit, digit, vaddq_u8(letter, vdupq_n_u8(10)));
+}
+
+// 32 characters to 16 bytes, if they're all hex digits.
+inline bool decodeHexBlock(const UInt8* in, UInt8* out) noexcept
+{
+   const uint8x16x2_t v = vld2q_u8(in);
+   uint8x16_t invalid = vdupq_n_u8(0);
+   const uint8x16_t high = hexValues(v.val[0], invalid);
+   const uint8x16_t low = hexValues(v.val[1], invalid);
+   if (vmaxvq_u8(invalid) != 0)
+      return false;
+   vst1q_u8(out, vorrq_u8(vshlq_n_u8(high, 4), low));
+   return true;
+}
+
+#endif
+
+} // namespace Detail
+
+inline size_t base64_encoded_size(size_t n) noexcept
+{
+   return (n + 2) / 3 * 4;
+}
+
+// Encode 'n' bytes as padded base64 into 'out', which must have room for
+// base64_encoded_size(n) characters. Returns the number of characters written.
+inline size_t base64_encode(const UInt8* in, size_t n, char* out) noexcept
+{
+   const char* const alphabet = Detail::base64Alphabet();
+   char* o = out;
+   size_t i = 0;
+
+#if defined(CFXX_HAS_SSSE3) || defined(CFXX_HAS_NEON)
+   for (; n - i >= Detail::kBase64EncodeRead; i += Detail::kBase64EncodeBlock, o += Detail::kBase64EncodeBlock / 3 * 4)
+      Detail::encodeBase64Block(in + i, o);
+#endif
+
+   for (; n - i >= 3; i += 3, o += 4)
+   {
+      const UInt32 v = (static_cast<UInt32>(in[i]) << 16) | (static_cast<UInt32>(in[i + 1]) << 8) | in[i + 2];
+      o[0] = alphabet[v >> 18];
+      o[1] = alphabet[(v >> 12) & 0x3F];
+      o[2] = alphabet[(v >> 6) & 0x3F];
+      o[3] = alphabet[v & 0x3F];
+   }
+
+   if (i < n)
+   {
+      const UInt32 v = (static_cast<UInt32>(in[i]) << 16) | (i + 1 < n ? static_cast<UInt32>(in[i + 1]) << 8 : 0);
+      o[0] = alphabet[v >> 18];
+      o[1] = alphabet[(v >> 12) & 0x3F];
+      o[2] = i + 1 < n ? alphabet[(v >> 6) & 0x3F] : '=';
+      o[3] = '=';
+      o += 4;
+   }
+
+   return static_cast<size_t>(o - out);
+}
+
+inline size_t hex_encoded_size(size_t n) noexcept
+{
+   return 2 * n;
+}
+
+// Encode 'n' bytes as lowercase hex into 'out', which must have room for
+// hex_encoded_size(n) characters. Returns the number of characters written.
+inline size_t hex_encode(const UInt8* in, size_t n, char* out) noexcept
+{
+   const char* const digits = Detail::hexDigits();
+   size_t i = 0;
+
+#if defined(CFXX_HAS_SSSE3) || defined(CFXX_HAS_NEON)
+   for (; n - i >= 16; i += 16)
+      Detail::encodeHexBlock(in + i, out + 2 * i);
+#endif
+
+   for (; i < n; ++i)
+   {
+      out[2 * i] = digits[in[i] >> 4];
+      out[2 * i + 1] = digits[in[i] & 0x0F];
+   }
+   return 2 * n;
+}
+
+// Decodes base64 fed to it in pieces; a group of characters split between pieces is held
+// on to until the next one. Whole groups of alphabet characters take the vector and
+// table-driven fast paths; whitespace and padding drop to a character at a time.
+class Base64Decoder
+{
+public:
+   inline explicit Base64Decoder(DecodeMode mode = DecodeMode::Strict) noexcept :
+      m_mode(mode)
+   {
+      reset();
+   }
+
+   // The most bytes that decode() can write for 'count' characters, plus what finish()
+   // might add. The vector loop stores a few bytes past what it decodes, hence the slack.
+   static inline size_t max_output_size(size_t count) noexcept
+   {
+      return 3 * (count / 4) + 3 + 2 + 4;
+   }
+
+   // Decode 'count' characters into 'out', which must have room for
+   // max_output_size(count) bytes. Returns the number of bytes written.
+   inline size_t decode(const char* in, size_t count, UInt8* out)
+   {
+      const UInt8* const table = Detail::decodeTables().base64;
+      const UInt8* p = reinterpret_cast<const UInt8*>(in);
+      const UInt8* const end = p + count;
+      UInt8* o = out;
+
+      while (p != end)
+      {
+         if (m_pending == 0 && !m_ended)
+         {
+#if defined(CFXX_HAS_SSSE3) || defined(CFXX_HAS_NEON)
+            const std::ptrdiff_t block = Detail::kBase64DecodeBlock;
+            for (; end - p >= block && Detail::decodeBase64Block(p, o); p += block, o += block / 4 * 3)
+               ;
+#endif
+            for (; end - p >= 4; p += 4, o += 3)
+            {
+               const UInt32 a = table[p[0]], b = table[p[1]], c = table[p[2]], d = table[p[3]];
+               if ((a | b | c | d) & 0xC0)
+                  break;
+               const UInt32 v = (a << 18) | (b << 12) | (c << 6) | d;
+               o[0] = static_cast<UInt8>(v >> 16);
+               o[1] = static_cast<UInt8>(v >> 8);
+               o[2] = static_cast<UInt8>(v);
+            }
+            if (p == end)
+               break;
+         }
+         o = decodeCharacter(table[*p++], o);
+      }
+
+      return static_cast<size_t>(o - out);
+   }
+
+   // Check that the input ended where it may, and write out a final unpadded group (in
+   // DecodeMode::Lenient). Returns the number of bytes written, and readies the decoder
+   // for new input.
+   inline size_t finish(UInt8* out)
+   {
+      UInt8* o = out;
+      if ((m_pending != 0 || m_padding != 0) && !m_ended)
+      {
+         if (m_mode == DecodeMode::Strict)
+            throw std::invalid_argument("Base64Decoder: missing padding");
+         o = flushPartialGroup(o);
+      }
+      reset();
+      return static_cast<size_t>(o - out);
+   }
+
+private:
+   inline UInt8* decodeCharacter(UInt8 value, UInt8* o)
+   {
+      if (value < 64)
+      {
+         if (m_ended || m_padding != 0)
+            throw std::invalid_argument("Base64Decoder: data after padding");
+         m_bits = (m_bits << 6) | value;
+         if (++m_pending == 4)
+         {
+            o[0] = static_cast<UInt8>(m_bits >> 16);
+            o[1] = static_cast<UInt8>(m_bits >> 8);
+            o[2] = static_cast<UInt8>(m_bits);
+            o += 3;
+            m_bits = 0;
+            m_pending = 0;
+         }
+      }
+      else if (value == Detail::kDecodePadding)
+      {
+         if (m_ended || m_pending < 2)
+            throw std::invalid_argument("Base64Decoder: misplaced padding");
+         if (m_pending + ++m_padding == 4)
+         {
+            o = flushPartialGroup(o);
+            m_ended = true;
+         }
+      }
+      else if (value != Detail::kDecodeWhitespace || m_mode != DecodeMode::Lenient)
+      {
+         throw std::invalid_argument("Base64Decoder: invalid character");
+      }
+      return o;
+   }
+
+   // Two or three characters of a group make one or two bytes; the bits left over have
+   // to be zero in DecodeMode::Strict, so that each byte string has only one encoding.
+   inline UInt8* flushPartialGroup(UInt8* o)
+   {
+      if (m_pending == 1)
+         throw std::invalid_argument("Base64Decoder: truncated input");
+      const int spareBits = (m_pending == 2) ? 4 : 2;
+      if (m_mode == DecodeMode::Strict && (m_bits & ((1u << spareBits) - 1)) != 0)
+         throw std::invalid_argument("Base64Decoder: non-zero padding bits");
+      const UInt32 v = m_bits >> spareBits;
+      if (m_pending == 3)
+         *o++ = static_cast<UInt8>(v >> 8);
+      *o++ = static_cast<UInt8>(v);
+      m_bits = 0;
+      m_pending = 0;
+      return o;
+   }
+
+   inline void reset() noexcept
+   {
+      m_bits = 0;
+      m_pending = 0;
+      m_padding = 0;
+      m_ended = false;
+   }
+
+   DecodeMode m_mode;
+   UInt32 m_bits;       // The characters of the current group so far, 6 bits each.
+   int m_pending;       // How many that is.
+   int m_padding;       // '=' seen so far.
+   bool m_ended;        // The padding is complete; only whitespace may follow.
+};
+
+// Decodes hex (in either case) fed to it in pieces; a digit split from its pair at the
+// end of one piece is held on to until the next one.
+class HexDecoder
+{
+public:
+   inline explicit HexDecoder(DecodeMode mode = DecodeMode::Strict) noexcept :
+      m_mode(mode),
+      m_pending(-1)
+   { }
+
+   // The most bytes that decode() can write for 'count' characters.
+   static inline size_t max_output_size(size_t count) noexcept
+   {
+      return count / 2 + 1;
+   }
+
+   // Decode 'count' characters into 'out', which must have room for
+   // max_output_size(count) bytes. Returns the number of bytes written.
+   inline size_t decode(const char* in, size_t count, UInt8* out)
+   {
+      const UInt8* const table = Detail::decodeTables().hex;
+      const UInt8* p = reinterpret_cast<const UInt8*>(in);
+      const UInt8* const end = p + count;
+      UInt8* o = out;
+
+      while (p != end)
+      {
+         if (m_pending < 0)
+         {
+#if defined(CFXX_HAS_SSSE3) || defined(CFXX_HAS_NEON)
+            for (; end - p >= 32 && Detail::decodeHexBlock(p, o); p += 32, o += 16)
+               ;
+#endif
+            for (; end - p >= 2; p += 2, ++o)
+            {
+               const UInt32 high = table[p[0]], low = table[p[1]];
+               if ((high | low) & 0xF0)
+                  break;
+               *o = static_cast<UInt8>((high << 4) | low);
+            }
+            if (p == end)
+               break;
+         }
+
+         const UInt8 value = table[*p++];
+         if (value < 16)
+         {
+            if (m_pending < 0)
+            {
+               m_pending = value;
+            }
+            else
+            {
+               *o++ = static_cast<UInt8>((m_pending << 4) | value);
+               m_pending = -1;
+            }
+         }
+         else if (value != Detail::kDecodeWhitespace || m_mode != DecodeMode::Lenient)
+         {
+            throw std::invalid_argument("HexDecoder: invalid character");
+         }
+      }
+
+      return static_cast<size_t>(o - out);
+   }
+
+   // Check that the input didn't end halfway through a byte, and ready the decoder for
+   // new input.
+   inline size_t finish(UInt8*)
+   {
+      const bool odd = m_pending >= 0;
+      m_pending = -1;
+      if (odd)
+         throw std::invalid_argument("HexDecoder: odd number of digits");
+      return 0;
+   }
+
+private:
+   DecodeMode m_mode;
+   int m_pending;       // The first digit of a byte, or -1.
+};
+
+namespace Detail
+{
+
+enum { kDecodeChunkSize = 4096 };
+
+// Runs a String's characters through one of the decoders above into a buffer allocated
+// with 'allocator', which the resulting Data then takes over.
+template<typename Decoder>
+inline CFReference<CFDataRef> decodeString(const String& s, DecodeMode mode, CFAllocatorRef allocator)
+{
+   const CFStringRef ref = s;
+   const size_t length = static_cast<size_t>(s.size());
+   UInt8* const bytes = static_cast<UInt8*>(CFAllocatorAllocate(allocator, static_cast<CFIndex>(Decoder::max_output_size(length)), 0));
+   if (!bytes)
+      throw std::bad_alloc();
+
+   Decoder decoder(mode);
+   size_t written = 0;
+   try
+   {
+      // ASCII strings (which any valid input is) can usually be read in place.
+      if (const char* characters = CFStringGetCStringPtr(ref, kCFStringEncodingASCII))
+      {
+         written = decoder.decode(characters, length, bytes);
+      }
+      else
+      {
+         // Anything outside ASCII comes out as 0x80, which is just as invalid.
+         UInt8 buffer[kDecodeChunkSize];
+         for (CFIndex done = 0; done < static_cast<CFIndex>(length); )
+         {
+            CFIndex used = 0;
+            const CFIndex converted = CFStringGetBytes(ref,
+               CFRangeMake(done, std::min<CFIndex>(static_cast<CFIndex>(length) - done, kDecodeChunkSize)),
+               kCFStringEncodingASCII, 0x80, false, buffer, kDecodeChunkSize, &used);
+            written += decoder.decode(reinterpret_cast<const char*>(buffer), static_cast<size_t>(used), bytes + written);
+            done += converted;
+         }
+      }
+      written += decoder.finish(bytes + written);
+   }
+   catch (...)
+   {
+      CFAllocatorDeallocate(allocator, bytes);
+      throw;
+   }
+
+   return makeCFReferenceFromCopyOrCreate(
+      CFDataCreateWithBytesNoCopy(allocator, bytes, static_cast<CFIndex>(written), allocator));
+}
+
+// Runs an encoder into a buffer allocated with 'allocator', which the resulting String
+// then takes over; the output is ASCII, so CF keeps the bytes as they are.
+template<typename Encode>
+inline String encodeToString(size_t length, Encode encode, CFAllocatorRef allocator)
+{
+   if (length == 0)
+      return String("", kCFStringEncodingASCII, allocator);
+
+   char* const characters = static_cast<char*>(CFAllocatorAllocate(allocator, static_cast<CFIndex>(length), 0));
+   if (!characters)
+      throw std::bad_alloc();
+   encode(characters);
+
+   const CFReference<CFStringRef> ref = makeCFReferenceFromCopyOrCreate(
+      CFStringCreateWithBytesNoCopy(allocator, reinterpret_cast<const UInt8*>(characters),
+         static_cast<CFIndex>(length), kCFStringEncodingASCII, false, allocator));
+   return String(ref.get());
+}
+
+} // namespace Detail
+
+inline String Data::to_base64(CFAllocatorRef allocator) const
+{
+   const UInt8* const bytes = data();
+   const size_t n = static_cast<size_t>(size());
+   return Detail::encodeToString(base64_encoded_size(n),
+      [bytes, n](char* out) { base64_encode(bytes, n, out); }, allocator);
+}
+
+inline String Data::to_hex(CFAllocatorRef allocator) const
+{
+   const UInt8* const bytes = data();
+   const size_t n = static_cast<size_t>(size());
+   return Detail::encodeToString(hex_encoded_size(n),
+      [bytes, n](char* out) { hex_encode(bytes, n, out); }, allocator);
+}
+
+inline Data Data::from_base64(const String& s, DecodeMode mode, CFAllocatorRef allocator)
+{
+   return withImmutableBytes(Detail::decodeString<Base64Decoder>(s, mode, allocator));
+}
+
+inline Data Data::from_hex(const String& s, DecodeMode mode, CFAllocatorRef allocator)
+{
+   return withImmutableBytes(Detail::decodeString<HexDecoder>(s, mode, allocator));
+}
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_encoding_h__
@@ -0,0 +1,542 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_hash_h__
+#define __cfxx_hash_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Hashing for the wrappers. Equal Strings (and Datas) hash equal however they were made,
+// since this goes through CFHash(); the wrappers remember the value after the first call.
+// std::equal_to works through the operator== overloads.
+namespace std
+{
+
+template<>
+struct hash<CoreFoundation::String>
+{
+   inline size_t operator()(const CoreFoundation::String& s) const noexcept
+   {
+      return static_cast<size_t>(s.hash());
+   }
+};
+
+template<>
+struct hash<CoreFoundation::Data>
+{
+   inline size_t operator()(const CoreFoundation::Data& d) const noexcept
+   {
+      return static_cast<size_t>(d.hash());
+   }
+};
+
+} // namespace std
+
+namespace CoreFoundation
+{
+
+// A hash map laid out as two flat arrays: one of hash values and one of entries. Lookups
+// probe linearly through the hash array, and only call KeyEqual on entries whose stored
+// hash matches, so for CF keys CFHash() runs once per key and CFEqual (or operator==)
+// only on a likely hit.
+//
+// The interface follows std::unordered_map where it can. Differences: erase() only takes
+// a key, and any insertion or erasure invalidates iterators and references.
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class CFHashMap
+{
+public:
+   typedef Key                        key_type;
+   typedef T                          mapped_type;
+   typedef std::pair<const Key, T>    value_type;
+   typedef size_t                     size_type;
+   typedef Hash                       hasher;
+   typedef KeyEqual                   key_equal;
+
+   template<bool IsConst>
+   class Iterator
+   {
+   public:
+      typedef std::forward_iterator_tag                                                iterator_category;
+      typedef typename CFHashMap::value_type                                           value_type;
+      typedef std::ptrdiff_t                                                           difference_type;
+      typedef typename std::conditional<IsConst, const value_type*, value_type*>::type pointer;
+      typedef typename std::conditional<IsConst, const value_type&, value_type&>::type reference;
+      typedef typename std::conditional<IsConst, const CFHashMap*, CFHashMap*>::type   map_pointer;
+
+      inline Iterator() noexcept :
+         m_map(nullptr),
+         m_index(0)
+      { }
+
+      inline Iterator(map_pointer map, size_type index) noexcept :
+         m_map(map),
+         m_index(index)
+      {
+         skipEmpty();
+      }
+
+      // Allow iterator -> const_iterator.
+      template<bool OtherConst, typename = typename std::enable_if<IsConst && !OtherConst>::type>
+      inline Iterator(const Iterator<OtherConst>& other) noexcept :
+         m_map(other.m_map),
+         m_index(other.m_index)
+      { }
+
+      inline reference operator*() const noexcept
+      {
+         return m_map->slot(m_index);
+      }
+
+      inline pointer operator->() const noexcept
+      {
+         return &m_map->slot(m_index);
+      }
+
+      inline Iterator& operator++() noexcept
+      {
+         ++m_index;
+         skipEmpty();
+         return *this;
+      }
+
+      inline Iterator operator++(int) noexcept
+      {
+         Iterator previous(*this);
+         ++(*this);
+         return previous;
+      }
+
+      inline bool operator==(const Iterator& other) const noexcept
+      {
+         return m_index == other.m_index;
+      }
+
+      inline bool operator!=(const Iterator& other) const noexcept
+      {
+         return m_index != other.m_index;
+      }
+
+   private:
+      template<bool> friend class Iterator;
+
+      inline void skipEmpty() noexcept
+      {
+         while (m_index < m_map->m_capacity && m_map->m_hashes[m_index] == 0)
+            ++m_index;
+      }
+
+      map_pointer m_map;
+      size_type   m_index;
+   };
+
+   typedef Iterator<false> iterator;
+   typedef Iterator<true>  const_iterator;
+
+   inline CFHashMap() noexcept :
+      m_hashes(nullptr),
+      m_slots(nullptr),
+      m_capacity(0),
+      m_capacityBits(0),
+      m_size(0)
+   { }
+
+   inline explicit CFHashMap(size_type expectedSize) :
+      CFHashMap()
+   {
+      reserve(expectedSize);
+   }
+
+   inline CFHashMap(size_type expectedSize, const Hash& hash, const KeyEqual& equal = KeyEqual()) :
+      m_hashes(nullptr),
+      m_slots(nullptr),
+      m_capacity(0),
+      m_capacityBits(0),
+      m_size(0),
+      m_hasher(hash),
+      m_equal(equal)
+   {
+      reserve(expectedSize);
+   }
+
+   // Copies other's Hash and KeyEqual along with its entries (and so does operator=,
+   // which copies through here), since the stored hashes came from other's Hash.
+   inline CFHashMap(const CFHashMap& other) :
+      CFHashMap(0, other.m_hasher, other.m_equal)
+   {
+      reserve(other.m_size);
+      for (size_type i = 0; i < other.m_capacity; ++i)
+      {
+         if (other.m_hashes[i])
+         {
+            const size_type index = findFree(other.m_hashes[i]);
+            new (&slot(index)) value_type(other.slot(i));
+            occupy(index, other.m_hashes[i]);
+         }
+      }
+   }
+
+   inline CFHashMap(CFHashMap&& other) noexcept :
+      CFHashMap()
+   {
+      swap(other);
+   }
+
+   inline CFHashMap& operator=(CFHashMap other) noexcept
+   {
+      swap(other);
+      return *this;
+   }
+
+   inline ~CFHashMap()
+   {
+      clear();
+      deallocate(m_hashes, m_slots);
+   }
+
+   inline void swap(CFHashMap& other) noexcept
+   {
+      std::swap(m_hashes, other.m_hashes);
+      std::swap(m_slots, other.m_slots);
+      std::swap(m_capacity, other.m_capacity);
+      std::swap(m_capacityBits, other.m_capacityBits);
+      std::swap(m_size, other.m_size);
+      std::swap(m_hasher, other.m_hasher);
+      std::swap(m_equal, other.m_equal);
+   }
+
+   inline iterator begin() noexcept
+   {
+      return iterator(this, 0);
+   }
+
+   inline iterator end() noexcept
+   {
+      return iterator(this, m_capacity);
+   }
+
+   inline const_iterator begin() const noexcept
+   {
+      return const_iterator(this, 0);
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return const_iterator(this, m_capacity);
+   }
+
+   inline const_iterator cbegin() const noexcept
+   {
+      return begin();
+   }
+
+   inline const_iterator cend() const noexcept
+   {
+      return end();
+   }
+
+   inline size_type size() const noexcept
+   {
+      return m_size;
+   }
+
+   inline bool empty() const noexcept
+   {
+      return m_size == 0;
+   }
+
+   inline hasher hash_function() const
+   {
+      return m_hasher;
+   }
+
+   inline key_equal key_eq() const
+   {
+      return m_equal;
+   }
+
+   // Number of slots; always a power of two (or zero).
+   inline size_type capacity() const noexcept
+   {
+      return m_capacity;
+   }
+
+   inline void clear() noexcept
+   {
+      for (size_type i = 0; i < m_capacity && m_size > 0; ++i)
+      {
+         if (m_hashes[i])
+         {
+            slot(i).~value_type();
+            m_hashes[i] = 0;
+            --m_size;
+         }
+      }
+   }
+
+   // Make room for 'count' entries without rehashing.
+   inline void reserve(size_type count)
+   {
+      size_type capacity = kMinimumCapacity;
+      while (capacity * kMaxLoadNumerator / kMaxLoadDenominator < count)
+         capacity *= 2;
+      if (capacity > m_capacity)
+         rehash(capacity);
+   }
+
+   inline iterator find(const Key& key)
+   {
+      const size_type index = findIndex(key, hashOf(key));
+      return index == npos ? end() : iterator(this, index);
+   }
+
+   inline const_iterator find(const Key& key) const
+   {
+      const size_type index = findIndex(key, hashOf(key));
+      return index == npos ? end() : const_iterator(this, index);
+   }
+
+   inline size_type count(const Key& key) const
+   {
+      return findIndex(key, hashOf(key)) == npos ? 0 : 1;
+   }
+
+   inline T& at(const Key& key)
+   {
+      const size_type index = findIndex(key, hashOf(key));
+      if (index == npos)
+         throw std::out_of_range("CFHashMap");
+      return slot(index).second;
+   }
+
+   inline const T& at(const Key& key) const
+   {
+      const size_type index = findIndex(key, hashOf(key));
+      if (index == npos)
+         throw std::out_of_range("CFHashMap");
+      return slot(index).second;
+   }
+
+   inline T& operator[](const Key& key)
+   {
+      return try_emplace(key).first->second;
+   }
+
+   inline T& operator[](Key&& key)
+   {
+      return try_emplace(std::move(key)).first->second;
+   }
+
+   inline std::pair<iterator, bool> insert(const value_type& value)
+   {
+      return try_emplace(value.first, value.second);
+   }
+
+   inline std::pair<iterator, bool> insert(value_type&& value)
+   {
+      return try_emplace(value.first, std::move(value.second));
+   }
+
+   // Insert a value constructed from 'args' if 'key' isn't there yet; leaves the map
+   // untouched (and 'args' unused) otherwise.
+   template<typename K, typename... Args>
+   inline std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+   {
+      const size_type hash = hashOf(key);
+      size_type index = findIndex(key, hash);
+      if (index != npos)
+         return std::make_pair(iterator(this, index), false);
+
+      if ((m_size + 1) * kMaxLoadDenominator > m_capacity * kMaxLoadNumerator)
+         rehash(m_capacity ? m_capacity * 2 : size_type(kMinimumCapacity));
+
+      index = findFree(hash);
+      new (&slot(index)) value_type(std::piecewise_construct,
+         std::forward_as_tuple(std::forward<K>(key)),
+         std::forward_as_tuple(std::forward<Args>(args)...));
+      occupy(index, hash);
+      return std::make_pair(iterator(this, index), true);
+   }
+
+   inline size_type erase(const Key& key)
+   {
+      size_type hole = findIndex(key, hashOf(key));
+      if (hole == npos)
+         return 0;
+
+      slot(hole).~value_type();
+      m_hashes[hole] = 0;
+      --m_size;
+
+      // Backward-shift deletion: pull later entries of the probe run into the hole
+      // unless that would put them before their home slot. No tombstones needed.
+      const size_type mask = m_capacity - 1;
+      for (size_type next = (hole + 1) & mask; m_hashes[next]; next = (next + 1) & mask)
+      {
+         const size_type home = homeOf(m_hashes[next]);
+         const bool homeBetween = (hole <= next)
+            ? (hole < home && home <= next)
+            : (hole < home || home <= next);
+         if (homeBetween)
+            continue;
+
+         new (&slot(hole)) value_type(std::move(slot(next)));
+         slot(next).~value_type();
+         m_hashes[hole] = m_hashes[next];
+         m_hashes[next] = 0;
+         hole = next;
+      }
+      return 1;
+   }
+
+private:
+   typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type Storage;
+
+   enum { kMinimumCapacity = 16 };
+   enum { kMaxLoadNumerator = 3, kMaxLoadDenominator = 4 };
+   enum { kHashBits = sizeof(size_type) * 8 };
+   static const size_type npos = static_cast<size_type>(-1);
+   // Set on every stored hash, so that zero can mean "empty".
+   static const size_type kOccupied = static_cast<size_type>(1) << (kHashBits - 1);
+
+   inline value_type& slot(size_type index) noexcept
+   {
+      return *reinterpret_cast<value_type*>(&m_slots[index]);
+   }
+
+   inline const value_type& slot(size_type index) const noexcept
+   {
+      return *reinterpret_cast<const value_type*>(&m_slots[index]);
+   }
+
+   template<typename K>
+   inline size_type hashOf(const K& key) const
+   {
+      return static_cast<size_type>(m_hasher(key)) | kOccupied;
+   }
+
+   // Fibonacci hashing: spreads CFHash values (which can be poorly mixed in the low
+   // bits) over the table by taking the top bits of a multiplication.
+   inline size_type homeOf(size_type hash) const noexcept
+   {
+      const UInt64 mixed = static_cast<UInt64>(hash) * 0x9E3779B97F4A7C15ULL;
+      return static_cast<size_type>(mixed >> (64 - m_capacityBits));
+   }
+
+   template<typename K>
+   inline size_type findIndex(const K& key, size_type hash) const
+   {
+      if (m_capacity == 0)
+         return npos;
+
+      const size_type mask = m_capacity - 1;
+      for (size_type i = homeOf(hash); m_hashes[i]; i = (i + 1) & mask)
+      {
+         if (m_hashes[i] == hash && m_equal(slot(i).first, key))
+            return i;
+      }
+      return npos;
+   }
+
+   // The first free slot on 'hash's probe run. The caller constructs the entry there,
+   // then calls occupy().
+   inline size_type findFree(size_type hash) const noexcept
+   {
+      const size_type mask = m_capacity - 1;
+      size_type i = homeOf(hash);
+      while (m_hashes[i])
+         i = (i + 1) & mask;
+      return i;
+   }
+
+   inline void occupy(size_type index, size_type hash) noexcept
+   {
+      m_hashes[index] = hash;
+      ++m_size;
+   }
+
+   inline void rehash(size_type capacity)
+   {
+      size_type* oldHashes = m_hashes;
+      Storage* oldSlots = m_slots;
+      const size_type oldCapacity = m_capacity;
+
+      m_hashes = new size_type[capacity]();
+      try
+      {
+         m_slots = new Storage[capacity];
+      }
+      catch (...)
+      {
+         delete[] m_hashes;
+         m_hashes = oldHashes;
+         throw;
+      }
+      m_capacity = capacity;
+      m_capacityBits = 0;
+      for (size_type c = capacity; c > 1; c >>= 1)
+         ++m_capacityBits;
+      m_size = 0;
+
+      for (size_type i = 0; i < oldCapacity; ++i)
+      {
+         if (oldHashes[i])
+         {
+            value_type& entry = *reinterpret_cast<value_type*>(&oldSlots[i]);
+            const size_type index = findFree(oldHashes[i]);
+            new (&slot(index)) value_type(std::move(entry));
+            occupy(index, oldHashes[i]);
+            entry.~value_type();
+         }
+      }
+      deallocate(oldHashes, oldSlots);
+   }
+
+   static inline void deallocate(size_type* hashes, Storage* slots) noexcept
+   {
+      delete[] hashes;
+      delete[] slots;
+   }
+
+   size_type* m_hashes;
+   Storage*   m_slots;
+   size_type  m_capacity;
+   size_type  m_capacityBits; // log2(m_capacity)
+   size_type  m_size;
+   Hash       m_hasher;
+   KeyEqual   m_equal;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_hash_h__
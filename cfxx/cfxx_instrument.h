@@ -0,0 +1,429 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_instrument_h__
+#define __cfxx_instrument_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <cstddef>
+
+// Instrumentation mode: build with CFXX_INSTRUMENT defined to have CFReference (and so
+// every wrapper) count the retain count traffic it generates, per CF type, and keep track
+// of which objects it created are still alive and where they were created. It must be
+// defined the same way in every translation unit of a program.
+//
+// Without CFXX_INSTRUMENT the hooks below are empty and compile away.
+
+#ifdef CFXX_INSTRUMENT
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <execinfo.h>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace CoreFoundation
+{
+namespace Instrumentation
+{
+
+enum class Event
+{
+   Create,    // A CFReference adopted a newly-created object.
+   Retain,
+   Release,
+   Copy,      // A CFReference was copied (which also counts as a Retain).
+   Move
+};
+
+#ifndef CFXX_INSTRUMENT
+
+inline void recordEvent(Event, CFTypeRef) noexcept { }
+inline void recordCreate(CFTypeRef) noexcept { }
+inline void recordRelease(CFTypeRef) noexcept { }
+
+#else
+
+enum { kEventCount = 5 };
+
+// Counters are kept per type ID up to this many; anything past it is lumped together
+// under kOtherTypes.
+enum { kTypeSlots = 256 };
+constexpr CFTypeID kOtherTypes = static_cast<CFTypeID>(-1);
+
+// How many return addresses are recorded for each live object.
+enum { kCallStackDepth = 8 };
+
+struct TypeCounters
+{
+   CFTypeID type_id;
+   uint64_t counts[kEventCount];
+
+   inline uint64_t operator[](Event event) const noexcept
+   {
+      return counts[static_cast<size_t>(event)];
+   }
+};
+
+struct Snapshot
+{
+   // Every type with any activity, in type ID order.
+   std::vector<TypeCounters> types;
+
+   inline uint64_t total(Event event) const noexcept
+   {
+      uint64_t sum = 0;
+      for (const TypeCounters& type : types)
+         sum += type[event];
+      return sum;
+   }
+
+   inline uint64_t count(CFTypeID type_id, Event event) const noexcept
+   {
+      for (const TypeCounters& type : types)
+      {
+         if (type.type_id == type_id)
+            return type[event];
+      }
+      return 0;
+   }
+};
+
+struct LiveObject
+{
+   CFTypeRef object;
+   CFTypeID type_id;
+   std::vector<void*> call_stack;   // Return addresses where it was created, innermost first.
+};
+
+namespace Detail
+{
+
+typedef uint64_t CounterTable[kTypeSlots][kEventCount];
+
+// One per thread. Only the owning thread writes to it, so updates are plain loads and
+// stores; they're atomic only so that snapshot() can read them from another thread.
+struct ThreadCounters
+{
+   inline ThreadCounters() noexcept
+   {
+      for (size_t slot = 0; slot < kTypeSlots; ++slot)
+      {
+         for (size_t event = 0; event < kEventCount; ++event)
+            counts[slot][event].store(0, std::memory_order_relaxed);
+      }
+   }
+
+   std::atomic<uint64_t> counts[kTypeSlots][kEventCount];
+};
+
+struct LiveRecord
+{
+   CFTypeID type_id;
+   int depth;
+   void* call_stack[kCallStackDepth];
+};
+
+struct Registry
+{
+   inline Registry() noexcept
+   {
+      std::fill(&retired[0][0], &retired[0][0] + kTypeSlots * kEventCount, 0);
+      std::fill(&baseline[0][0], &baseline[0][0] + kTypeSlots * kEventCount, 0);
+   }
+
+   std::mutex mutex;                          // Guards threads, retired and baseline.
+   std::vector<ThreadCounters*> threads;
+   CounterTable retired;                      // Totals from threads that have exited.
+   CounterTable baseline;                     // Totals as of the last reset().
+
+   std::mutex liveMutex;
+   std::unordered_map<CFTypeRef, LiveRecord> live;
+};
+
+// Never destroyed: other threads may still be releasing objects while the process exits.
+inline Registry& registry()
+{
+   static Registry* registry = new Registry();
+   return *registry;
+}
+
+struct ThreadCountersHolder
+{
+   inline ThreadCountersHolder() noexcept :
+      counters(nullptr)
+   { }
+
+   inline ~ThreadCountersHolder()
+   {
+      if (!counters)
+         return;
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      for (size_t slot = 0; slot < kTypeSlots; ++slot)
+      {
+         for (size_t event = 0; event < kEventCount; ++event)
+            r.retired[slot][event] += counters->counts[slot][event].load(std::memory_order_relaxed);
+      }
+      r.threads.erase(std::find(r.threads.begin(), r.threads.end(), counters));
+      delete counters;
+      counters = nullptr;
+      countersDestroyed() = true;
+   }
+
+   // Objects can still be retained and released after this thread's counters have been
+   // destroyed (from other thread_local destructors); this trivially-destructible flag
+   // says when that's the case.
+   static inline bool& countersDestroyed() noexcept
+   {
+      static thread_local bool destroyed = false;
+      return destroyed;
+   }
+
+   ThreadCounters* counters;
+};
+
+// Null once the thread's counters have been destroyed; see recordEvent().
+inline ThreadCounters* threadCounters()
+{
+   if (ThreadCountersHolder::countersDestroyed())
+      return nullptr;
+   static thread_local ThreadCountersHolder holder;
+   if (!holder.counters)
+   {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      holder.counters = new ThreadCounters();
+      r.threads.push_back(holder.counters);
+   }
+   return holder.counters;
+}
+
+inline size_t typeSlot(CFTypeID type_id) noexcept
+{
+   return type_id < kTypeSlots - 1 ? static_cast<size_t>(type_id) : kTypeSlots - 1;
+}
+
+inline CFTypeID slotType(size_t slot) noexcept
+{
+   return slot < kTypeSlots - 1 ? static_cast<CFTypeID>(slot) : kOtherTypes;
+}
+
+// Current totals across all threads, not counting reset().
+inline void collect(Registry& r, CounterTable& totals)
+{
+   std::copy(&r.retired[0][0], &r.retired[0][0] + kTypeSlots * kEventCount, &totals[0][0]);
+   for (const ThreadCounters* counters : r.threads)
+   {
+      for (size_t slot = 0; slot < kTypeSlots; ++slot)
+      {
+         for (size_t event = 0; event < kEventCount; ++event)
+            totals[slot][event] += counters->counts[slot][event].load(std::memory_order_relaxed);
+      }
+   }
+}
+
+inline void writeTypeName(std::ostream& out, CFTypeID type_id)
+{
+   char name[128] = "other";
+   if (type_id != kOtherTypes)
+   {
+      CFStringRef description = CFCopyTypeIDDescription(type_id);
+      if (!description || !CFStringGetCString(description, name, sizeof(name), kCFStringEncodingUTF8))
+         name[0] = '\0';
+      if (description)
+         CFRelease(description);
+   }
+   out << name << " (" << type_id << ")";
+}
+
+} // namespace Detail
+
+inline void recordEvent(Event event, CFTypeRef ref) noexcept
+{
+   if (!ref)
+      return;
+   const size_t slot = Detail::typeSlot(CFGetTypeID(ref));
+   Detail::ThreadCounters* counters;
+   try
+   {
+      counters = Detail::threadCounters();
+      if (!counters)
+      {
+         // Late in thread exit: count straight into the exited threads' totals.
+         Detail::Registry& r = Detail::registry();
+         std::lock_guard<std::mutex> lock(r.mutex);
+         ++r.retired[slot][static_cast<size_t>(event)];
+         return;
+      }
+   }
+   catch (...)
+   {
+      return;
+   }
+   std::atomic<uint64_t>* counter = &counters->counts[slot][static_cast<size_t>(event)];
+   counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline void recordCreate(CFTypeRef ref) noexcept
+{
+   if (!ref)
+      return;
+   recordEvent(Event::Create, ref);
+
+   Detail::LiveRecord record;
+   record.type_id = CFGetTypeID(ref);
+   void* frames[kCallStackDepth + 1];
+   const int depth = ::backtrace(frames, kCallStackDepth + 1);
+   // Leave out our own frame.
+   record.depth = depth > 0 ? depth - 1 : 0;
+   std::copy(frames + 1, frames + 1 + record.depth, record.call_stack);
+
+   Detail::Registry& r = Detail::registry();
+   try
+   {
+      std::lock_guard<std::mutex> lock(r.liveMutex);
+      r.live[ref] = record;
+   }
+   catch (...)
+   {
+   }
+}
+
+// Called before 'ref' is released. If it's the last reference, the object is about to
+// be destroyed, and stops being live.
+inline void recordRelease(CFTypeRef ref) noexcept
+{
+   if (!ref)
+      return;
+   recordEvent(Event::Release, ref);
+   if (CFGetRetainCount(ref) == 1)
+   {
+      Detail::Registry& r = Detail::registry();
+      std::lock_guard<std::mutex> lock(r.liveMutex);
+      r.live.erase(ref);
+   }
+}
+
+// Counts since the start of the process (or the last reset()).
+inline Snapshot snapshot()
+{
+   Detail::Registry& r = Detail::registry();
+   Detail::CounterTable totals;
+   Snapshot result;
+   std::lock_guard<std::mutex> lock(r.mutex);
+   Detail::collect(r, totals);
+   for (size_t slot = 0; slot < kTypeSlots; ++slot)
+   {
+      TypeCounters type;
+      type.type_id = Detail::slotType(slot);
+      bool any = false;
+      for (size_t event = 0; event < kEventCount; ++event)
+      {
+         type.counts[event] = totals[slot][event] - r.baseline[slot][event];
+         any = any || type.counts[event] != 0;
+      }
+      if (any)
+         result.types.push_back(type);
+   }
+   return result;
+}
+
+// Start counting from zero again. Live objects are unaffected.
+inline void reset()
+{
+   Detail::Registry& r = Detail::registry();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   Detail::collect(r, r.baseline);
+}
+
+// Objects created through a CFReference whose last release hasn't been seen. Objects
+// whose final release happens outside of cfxx (e.g. in a collection that was handed
+// the last reference) stay on this list.
+inline std::vector<LiveObject> live_objects()
+{
+   Detail::Registry& r = Detail::registry();
+   std::vector<LiveObject> result;
+   std::lock_guard<std::mutex> lock(r.liveMutex);
+   result.reserve(r.live.size());
+   for (const auto& entry : r.live)
+   {
+      LiveObject object;
+      object.object = entry.first;
+      object.type_id = entry.second.type_id;
+      object.call_stack.assign(entry.second.call_stack, entry.second.call_stack + entry.second.depth);
+      result.push_back(std::move(object));
+   }
+   return result;
+}
+
+// Write the counters and the live objects (with symbolized creation call stacks) to 'out'.
+inline void dump(std::ostream& out)
+{
+   static const char* const eventNames[kEventCount] = { "create", "retain", "release", "copy", "move" };
+
+   const Snapshot counters = snapshot();
+   out << "cfxx reference counting, by type:\n";
+   for (const TypeCounters& type : counters.types)
+   {
+      out << "  ";
+      Detail::writeTypeName(out, type.type_id);
+      out << ":";
+      for (size_t event = 0; event < kEventCount; ++event)
+         out << " " << eventNames[event] << "=" << type.counts[event];
+      out << "\n";
+   }
+
+   const std::vector<LiveObject> live = live_objects();
+   out << "cfxx live objects: " << live.size() << "\n";
+   for (const LiveObject& object : live)
+   {
+      out << "  " << object.object << " ";
+      Detail::writeTypeName(out, object.type_id);
+      out << ", created at:\n";
+      char** symbols = ::backtrace_symbols(object.call_stack.data(), static_cast<int>(object.call_stack.size()));
+      for (size_t i = 0; i < object.call_stack.size(); ++i)
+      {
+         out << "    ";
+         if (symbols)
+            out << symbols[i];
+         else
+            out << object.call_stack[i];
+         out << "\n";
+      }
+      std::free(symbols);
+   }
+}
+
+#endif // CFXX_INSTRUMENT
+
+} // namespace Instrumentation
+} // namespace CoreFoundation
+
+#endif // __cfxx_instrument_h__
@@ -0,0 +1,219 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_intern_h__
+#define __cfxx_intern_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CoreFoundation
+{
+
+// Hands out one canonical String per distinct content, so that code that sees the same
+// identifiers over and over (header names, field keys) shares a single CF object for
+// each of them, and comparisons between interned Strings come down to comparing
+// pointers (see the String comparison operators).
+//
+// Lookups go by UTF-8 bytes, so interning straight from a parse buffer doesn't create
+// any CF objects unless the content is new. The table is split into independently
+// locked shards so that concurrent callers rarely contend.
+class StringInternPool
+{
+public:
+   enum { kDefaultShardCount = 16 };
+
+   inline explicit StringInternPool(size_t shardCount = kDefaultShardCount) :
+      m_shards(shardCount ? shardCount : 1)
+   { }
+
+   StringInternPool(const StringInternPool&) = delete;
+   StringInternPool& operator=(const StringInternPool&) = delete;
+
+   // The canonical String for these UTF-8 bytes.
+   inline String intern(const char* bytes, size_t length)
+   {
+      const Key key(bytes, length);
+      const size_t hash = hashBytes(bytes, length);
+      Shard& shard = shardFor(hash);
+
+      std::lock_guard<std::mutex> lock(shard.m_mutex);
+      auto found = shard.m_entries.find(key);
+      if (found != shard.m_entries.end())
+         return found->second->m_string;
+
+      std::unique_ptr<Entry> entry(new Entry(bytes, length));
+      const Key storedKey(entry->m_bytes.data(), entry->m_bytes.size());
+      String result = entry->m_string;
+      shard.m_entries.emplace(storedKey, std::move(entry));
+      return result;
+   }
+
+   inline String intern(const std::string& s)
+   {
+      return intern(s.data(), s.size());
+   }
+
+   inline String intern(const char* s)
+   {
+      return intern(s, std::strlen(s));
+   }
+
+   // Keyed on the whole content, embedded NULs included, so this goes by the string's
+   // length rather than strlen(). CF only hands out a UTF-8 C string pointer for ASCII
+   // content, which has one byte per character.
+   inline String intern(const String& s)
+   {
+      const char* bytes = CFStringGetCStringPtr(s, kCFStringEncodingUTF8);
+      if (bytes)
+         return intern(bytes, static_cast<size_t>(CFStringGetLength(s)));
+      return intern(s.to_string());
+   }
+
+   // Drop every entry that nobody outside the pool holds on to any more. Returns the
+   // number of entries removed. Interning the same content again later simply makes a
+   // new canonical String.
+   //
+   // This goes by CFGetRetainCount(), which never comes down to 1 for CFStrings that CF
+   // doesn't reference count: tagged pointers (which CF may use for short content) and
+   // constant strings. Their entries are never evicted. They hold no CF memory, only the
+   // pool's copy of their bytes.
+   inline size_t evict_unused()
+   {
+      size_t evicted = 0;
+      for (size_t i = 0; i < m_shards.size(); ++i)
+      {
+         Shard& shard = m_shards[i];
+         std::lock_guard<std::mutex> lock(shard.m_mutex);
+         for (auto it = shard.m_entries.begin(); it != shard.m_entries.end(); )
+         {
+            // Copies are only ever made under this lock, so once the pool's reference is
+            // the only one left, it stays that way until we let go of the lock.
+            if (CFGetRetainCount(it->second->m_string) == 1)
+            {
+               it = shard.m_entries.erase(it);
+               ++evicted;
+            }
+            else
+            {
+               ++it;
+            }
+         }
+      }
+      return evicted;
+   }
+
+   inline size_t size() const
+   {
+      size_t total = 0;
+      for (size_t i = 0; i < m_shards.size(); ++i)
+      {
+         std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+         total += m_shards[i].m_entries.size();
+      }
+      return total;
+   }
+
+   inline void clear()
+   {
+      for (size_t i = 0; i < m_shards.size(); ++i)
+      {
+         std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+         m_shards[i].m_entries.clear();
+      }
+   }
+
+private:
+   // Points into either the caller's bytes (for lookups) or an Entry's (once stored).
+   struct Key
+   {
+      inline Key(const char* bytes, size_t length) noexcept :
+         m_bytes(bytes),
+         m_length(length)
+      { }
+
+      inline bool operator==(const Key& other) const noexcept
+      {
+         return m_length == other.m_length && std::memcmp(m_bytes, other.m_bytes, m_length) == 0;
+      }
+
+      const char* m_bytes;
+      size_t      m_length;
+   };
+
+   struct KeyHash
+   {
+      inline size_t operator()(const Key& key) const noexcept
+      {
+         return hashBytes(key.m_bytes, key.m_length);
+      }
+   };
+
+   struct Entry
+   {
+      inline Entry(const char* bytes, size_t length) :
+         m_bytes(bytes, length),
+         m_string(m_bytes)
+      { }
+
+      std::string m_bytes;
+      String      m_string;
+   };
+
+   struct Shard
+   {
+      mutable std::mutex                                           m_mutex;
+      std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash>     m_entries;
+   };
+
+   // FNV-1a; identifiers are short, so this is hard to beat.
+   static inline size_t hashBytes(const char* bytes, size_t length) noexcept
+   {
+      UInt64 hash = 14695981039346656037ULL;
+      for (size_t i = 0; i < length; ++i)
+      {
+         hash ^= static_cast<UInt8>(bytes[i]);
+         hash *= 1099511628211ULL;
+      }
+      return static_cast<size_t>(hash);
+   }
+
+   inline Shard& shardFor(size_t hash) noexcept
+   {
+      // The low bits pick the bucket within a shard, so use the high ones here.
+      return m_shards[(hash >> (sizeof(size_t) * 4)) % m_shards.size()];
+   }
+
+   std::vector<Shard> m_shards;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_intern_h__
@@ -0,0 +1,250 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_loader_h__
+#define __cfxx_loader_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cfxx_data.h"
+
+namespace CoreFoundation
+{
+
+struct DataLoaderOptions
+{
+   inline DataLoaderOptions() noexcept :
+      thread_count(0),
+      max_file_size(64 << 20),
+      allocator(kCFAllocatorDefault)
+   { }
+
+   // Worker threads; 0 means one per core. Loading lots of small files spends most of its
+   // time waiting on the disk, so more threads than cores can still help.
+   size_t thread_count;
+
+   // Larger files fail to load, with a std::system_error carrying EFBIG.
+   size_t max_file_size;
+
+   // What each file's bytes and CFData are allocated with. Must outlive the DataLoader.
+   CFAllocatorRef allocator;
+};
+
+// Loads files into Data on a fixed pool of worker threads, for reading many files at once
+// (e.g. at startup) instead of one after the other. Each file is read with
+// Data::read_file(), straight into the buffer that its CFData takes over.
+//
+// Loads are started in the order they're asked for. Destroying the DataLoader waits for
+// every load that has been asked for to finish.
+class DataLoader
+{
+public:
+   // Called on a worker thread once the file has been read: with the data, or with a null
+   // Data and the exception that Data::read_file() threw. Must not throw.
+   typedef std::function<void(const std::string& path, Data data, std::exception_ptr error)> Callback;
+
+   inline explicit DataLoader(const DataLoaderOptions& options = DataLoaderOptions()) :
+      m_options(options),
+      m_stopping(false)
+   {
+      size_t count = m_options.thread_count;
+      if (count == 0)
+         count = std::max(1u, std::thread::hardware_concurrency());
+      m_threads.reserve(count);
+      try
+      {
+         for (size_t i = 0; i < count; ++i)
+            m_threads.push_back(std::thread(&DataLoader::work, this));
+      }
+      catch (...)
+      {
+         stop();
+         throw;
+      }
+   }
+
+   DataLoader(const DataLoader&) = delete;
+   DataLoader& operator=(const DataLoader&) = delete;
+
+   inline ~DataLoader()
+   {
+      stop();
+   }
+
+   inline size_t thread_count() const noexcept
+   {
+      return m_threads.size();
+   }
+
+   // get() on the future returns the data, or rethrows what Data::read_file() threw.
+   inline std::future<Data> load(const std::string& path)
+   {
+      Request request(path);
+      std::future<Data> result = request.promise->get_future();
+      submit(&request, &request + 1);
+      return result;
+   }
+
+   inline std::vector<std::future<Data>> load(const std::vector<std::string>& paths)
+   {
+      std::vector<Request> requests;
+      std::vector<std::future<Data>> results;
+      requests.reserve(paths.size());
+      results.reserve(paths.size());
+      for (const std::string& path : paths)
+      {
+         requests.push_back(Request(path));
+         results.push_back(requests.back().promise->get_future());
+      }
+      submit(requests.data(), requests.data() + requests.size());
+      return results;
+   }
+
+   inline void load(const std::string& path, Callback callback)
+   {
+      Request request(path, std::move(callback));
+      submit(&request, &request + 1);
+   }
+
+   // 'callback' is called once per file, possibly on several threads at once.
+   inline void load(const std::vector<std::string>& paths, const Callback& callback)
+   {
+      std::vector<Request> requests;
+      requests.reserve(paths.size());
+      for (const std::string& path : paths)
+         requests.push_back(Request(path, callback));
+      submit(requests.data(), requests.data() + requests.size());
+   }
+
+private:
+   // One file to load; it either fulfils a promise or calls a callback.
+   struct Request
+   {
+      inline explicit Request(const std::string& path) :
+         path(path),
+         promise(std::make_shared<std::promise<Data>>())
+      { }
+
+      inline Request(const std::string& path, Callback callback) :
+         path(path),
+         callback(std::move(callback))
+      { }
+
+      std::string path;
+      // Shared, so that a Request stays copyable for std::deque.
+      std::shared_ptr<std::promise<Data>> promise;
+      Callback callback;
+   };
+
+   // Queues a batch under a single lock.
+   inline void submit(Request* first, Request* last)
+   {
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         for (Request* request = first; request != last; ++request)
+            m_queue.push_back(std::move(*request));
+      }
+      if (last - first == 1)
+         m_wake.notify_one();
+      else
+         m_wake.notify_all();
+   }
+
+   // Lets the workers finish what's queued, then waits for them to exit.
+   inline void stop() noexcept
+   {
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_stopping = true;
+      }
+      m_wake.notify_all();
+      for (std::thread& thread : m_threads)
+         thread.join();
+   }
+
+   inline void work()
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (;;)
+      {
+         m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+         if (m_queue.empty())
+            return;
+
+         Request request = std::move(m_queue.front());
+         m_queue.pop_front();
+         lock.unlock();
+         process(request);
+         lock.lock();
+      }
+   }
+
+   inline void process(Request& request) noexcept
+   {
+      Data data;
+      std::exception_ptr error;
+      try
+      {
+         data = Data::read_file(request.path, m_options.max_file_size, m_options.allocator);
+      }
+      catch (...)
+      {
+         error = std::current_exception();
+      }
+
+      if (request.promise)
+      {
+         if (error)
+            request.promise->set_exception(error);
+         else
+            request.promise->set_value(std::move(data));
+      }
+      else
+      {
+         request.callback(request.path, std::move(data), error);
+      }
+   }
+
+   DataLoaderOptions m_options;
+   std::mutex m_mutex;
+   std::condition_variable m_wake;
+   std::deque<Request> m_queue;
+   bool m_stopping;
+   std::vector<std::thread> m_threads;
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_loader_h__
@@ -0,0 +1,401 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_release_h__
+#define __cfxx_release_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cfxx_base.h"
+
+namespace CoreFoundation
+{
+
+// What a thread does when its deferred release queue is full.
+enum class ReleaseBackpressure
+{
+   ReleaseInline,   // Release the object right away, on the calling thread.
+   Wait             // Wake the reclaimer and wait for room (inline if there's no reclaimer).
+};
+
+struct DeferredReleaseOptions
+{
+   inline DeferredReleaseOptions() noexcept :
+      queue_capacity(4096),
+      batch_size(256),
+      backpressure(ReleaseBackpressure::ReleaseInline),
+      background_thread(true),
+      interval(std::chrono::milliseconds(10))
+   { }
+
+   // Slots in each thread's queue; rounded up to a power of two. Only applies to queues
+   // created after enable().
+   size_t queue_capacity;
+
+   // Most objects the reclaimer releases from one queue before moving on to the next; a
+   // queue reaching this many entries also wakes the reclaimer early.
+   size_t batch_size;
+
+   ReleaseBackpressure backpressure;
+
+   // Run a reclaimer thread. Without one, queued objects are only released by drain().
+   bool background_thread;
+
+   // How often the reclaimer wakes up on its own.
+   std::chrono::milliseconds interval;
+};
+
+struct DeferredReleaseStats
+{
+   uint64_t deferred;          // Releases that were queued.
+   uint64_t released;          // Queued releases that have been carried out.
+   uint64_t released_inline;   // Releases done on the calling thread because its queue was full.
+   uint64_t batches;           // Non-empty batches released.
+
+   inline uint64_t pending() const noexcept
+   {
+      return deferred - released;
+   }
+};
+
+// DeferredRelease is an opt-in mode in which dropping the last reference to an object
+// (from a CFReference, and so from any of the wrappers) doesn't free it on the spot.
+// Instead the reference goes into a lock-free queue belonging to the calling thread, and
+// a background reclaimer (or an explicit drain() at some quiescent point) releases queued
+// objects in batches. That keeps large frees off latency-sensitive threads.
+//
+// References that aren't the last one are still released inline: that's just a
+// decrement, and there's nothing to gain by queueing it. (Retain counts can be stale
+// when other threads are releasing the same object; the worst case is an occasional
+// inline free.)
+//
+// Releases done by the reclaimer or drain(), including any that happen as a side
+// effect of destroying the queued objects, always happen inline.
+class DeferredRelease
+{
+public:
+   // Start deferring releases, or change the options if already enabled.
+   inline static void enable(const DeferredReleaseOptions& options = DeferredReleaseOptions())
+   {
+      Shared& shared = sharedState();
+      std::lock_guard<std::mutex> control(shared.controlMutex);
+      stopReclaimer(shared);
+      {
+         std::lock_guard<std::mutex> lock(shared.mutex);
+         shared.options = options;
+         shared.options.batch_size = std::max<size_t>(options.batch_size, 1);
+         shared.batchSize.store(shared.options.batch_size, std::memory_order_relaxed);
+         shared.waitWhenFull.store(
+            options.backpressure == ReleaseBackpressure::Wait && options.background_thread,
+            std::memory_order_relaxed);
+      }
+      if (options.background_thread)
+      {
+         shared.stopping = false;
+         shared.reclaimer = std::thread(&DeferredRelease::reclaim);
+      }
+      ReleaseHookStorage<>::hook.store(&DeferredRelease::deferRelease);
+   }
+
+   // Stop deferring releases, and release everything that was queued.
+   inline static void disable()
+   {
+      Shared& shared = sharedState();
+      std::lock_guard<std::mutex> control(shared.controlMutex);
+      ReleaseHookStorage<>::hook.store(nullptr);
+      stopReclaimer(shared);
+      drain();
+   }
+
+   inline static bool enabled() noexcept
+   {
+      return ReleaseHookStorage<>::hook.load() == &DeferredRelease::deferRelease;
+   }
+
+   // Release everything queued so far by any thread. Returns the number released.
+   inline static size_t drain()
+   {
+      Shared& shared = sharedState();
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      size_t released = 0;
+      for (Queue* queue : shared.queues)
+         released += releaseFrom(shared, *queue, SIZE_MAX);
+      return released;
+   }
+
+   inline static DeferredReleaseStats stats()
+   {
+      Shared& shared = sharedState();
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      DeferredReleaseStats stats = shared.retired;
+      stats.released = shared.released;
+      stats.batches = shared.batches;
+      for (const Queue* queue : shared.queues)
+      {
+         stats.deferred += queue->deferred.load(std::memory_order_relaxed);
+         stats.released_inline += queue->releasedInline.load(std::memory_order_relaxed);
+      }
+      return stats;
+   }
+
+private:
+   // A single-producer (the owning thread), single-consumer (whoever holds Shared::mutex)
+   // ring of objects waiting to be released.
+   struct Queue
+   {
+      inline explicit Queue(size_t capacity) :
+         slots(new CFTypeRef[capacity]),
+         mask(capacity - 1),
+         head(0),
+         tail(0),
+         deferred(0),
+         releasedInline(0)
+      { }
+
+      std::unique_ptr<CFTypeRef[]> slots;
+      const size_t mask;
+      std::atomic<size_t> head;   // Next slot to release; written by the consumer.
+      std::atomic<size_t> tail;   // Next slot to fill; written by the producer.
+
+      // Written only by the producer.
+      std::atomic<uint64_t> deferred;
+      std::atomic<uint64_t> releasedInline;
+   };
+
+   struct Shared
+   {
+      inline Shared() :
+         stopping(false),
+         batchSize(DeferredReleaseOptions().batch_size),
+         waitWhenFull(false),
+         released(0),
+         batches(0)
+      {
+         retired.deferred = 0;
+         retired.released = 0;
+         retired.released_inline = 0;
+         retired.batches = 0;
+      }
+
+      inline ~Shared()
+      {
+         ReleaseHookStorage<>::hook.store(nullptr);
+         stopReclaimer(*this);
+      }
+
+      std::mutex controlMutex;          // Serializes enable() and disable().
+      std::mutex mutex;                 // Guards everything below, and consuming from queues.
+      std::condition_variable wakeup;
+      bool stopping;
+      std::thread reclaimer;
+      DeferredReleaseOptions options;
+      // Copies of options for the producers, which don't take the mutex.
+      std::atomic<size_t> batchSize;
+      std::atomic<bool> waitWhenFull;
+      std::vector<Queue*> queues;
+      uint64_t released;
+      uint64_t batches;
+      DeferredReleaseStats retired;     // Counts from queues whose threads have exited.
+   };
+
+   // The calling thread's queue. Created on first use; on thread exit, whatever is left
+   // in it is released and it's unregistered.
+   struct ThreadQueue
+   {
+      inline ThreadQueue() noexcept :
+         queue(nullptr)
+      { }
+
+      inline ~ThreadQueue()
+      {
+         if (!queue)
+            return;
+         Shared& shared = sharedState();
+         std::lock_guard<std::mutex> lock(shared.mutex);
+         releaseFrom(shared, *queue, SIZE_MAX);
+         shared.retired.deferred += queue->deferred.load(std::memory_order_relaxed);
+         shared.retired.released_inline += queue->releasedInline.load(std::memory_order_relaxed);
+         shared.queues.erase(std::find(shared.queues.begin(), shared.queues.end(), queue));
+         delete queue;
+         queue = nullptr;
+         queueDestroyed() = true;
+      }
+
+      Queue* queue;
+   };
+
+   inline static Shared& sharedState()
+   {
+      static Shared shared;
+      return shared;
+   }
+
+   // Set while this thread is releasing queued objects, so that anything they release in
+   // turn is released inline rather than queued behind them.
+   inline static bool& releasingOnThisThread() noexcept
+   {
+      static thread_local bool releasing = false;
+      return releasing;
+   }
+
+   // Objects can still be released after this thread's queue has been destroyed (from
+   // other thread_local destructors); this trivially-destructible flag says when that's the
+   // case, so that they're released inline instead of making a new queue.
+   inline static bool& queueDestroyed() noexcept
+   {
+      static thread_local bool destroyed = false;
+      return destroyed;
+   }
+
+   // Null once the thread's queue has been destroyed.
+   inline static Queue* queueForThisThread()
+   {
+      if (queueDestroyed())
+         return nullptr;
+      static thread_local ThreadQueue threadQueue;
+      if (!threadQueue.queue)
+      {
+         Shared& shared = sharedState();
+         std::lock_guard<std::mutex> lock(shared.mutex);
+         size_t capacity = 1;
+         while (capacity < shared.options.queue_capacity)
+            capacity <<= 1;
+         std::unique_ptr<Queue> queue(new Queue(capacity));
+         shared.queues.push_back(queue.get());
+         threadQueue.queue = queue.release();
+      }
+      return threadQueue.queue;
+   }
+
+   // The release hook installed while enabled.
+   inline static void deferRelease(CFTypeRef ref) noexcept
+   {
+      if (CFGetRetainCount(ref) > 1 || releasingOnThisThread())
+      {
+         CFRelease(ref);
+         return;
+      }
+
+      Queue* queue;
+      try
+      {
+         queue = queueForThisThread();
+      }
+      catch (...)
+      {
+         queue = nullptr;
+      }
+      if (!queue)
+      {
+         CFRelease(ref);
+         return;
+      }
+
+      const size_t tail = queue->tail.load(std::memory_order_relaxed);
+      size_t head = queue->head.load(std::memory_order_acquire);
+      while (tail - head > queue->mask)
+      {
+         if (!sharedState().waitWhenFull.load(std::memory_order_relaxed))
+         {
+            queue->releasedInline.store(
+               queue->releasedInline.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+            CFRelease(ref);
+            return;
+         }
+         sharedState().wakeup.notify_one();
+         std::this_thread::yield();
+         head = queue->head.load(std::memory_order_acquire);
+      }
+
+      queue->slots[tail & queue->mask] = ref;
+      queue->tail.store(tail + 1, std::memory_order_release);
+      queue->deferred.store(
+         queue->deferred.load(std::memory_order_relaxed) + 1,
+         std::memory_order_relaxed);
+
+      if (tail + 1 - head == sharedState().batchSize.load(std::memory_order_relaxed))
+         sharedState().wakeup.notify_one();
+   }
+
+   // Release up to 'limit' objects from 'queue'. Called with shared.mutex held.
+   inline static size_t releaseFrom(Shared& shared, Queue& queue, size_t limit) noexcept
+   {
+      const size_t head = queue.head.load(std::memory_order_relaxed);
+      const size_t tail = queue.tail.load(std::memory_order_acquire);
+      const size_t count = std::min(tail - head, limit);
+      if (count == 0)
+         return 0;
+
+      bool& releasing = releasingOnThisThread();
+      const bool wasReleasing = releasing;
+      releasing = true;
+      for (size_t i = 0; i < count; ++i)
+         CFRelease(queue.slots[(head + i) & queue.mask]);
+      releasing = wasReleasing;
+
+      queue.head.store(head + count, std::memory_order_release);
+      shared.released += count;
+      ++shared.batches;
+      return count;
+   }
+
+   // Body of the reclaimer thread.
+   inline static void reclaim()
+   {
+      Shared& shared = sharedState();
+      std::unique_lock<std::mutex> lock(shared.mutex);
+      while (!shared.stopping)
+      {
+         shared.wakeup.wait_for(lock, shared.options.interval);
+         for (Queue* queue : shared.queues)
+            releaseFrom(shared, *queue, shared.options.batch_size);
+      }
+   }
+
+   inline static void stopReclaimer(Shared& shared)
+   {
+      if (!shared.reclaimer.joinable())
+         return;
+      {
+         std::lock_guard<std::mutex> lock(shared.mutex);
+         shared.stopping = true;
+      }
+      shared.wakeup.notify_one();
+      shared.reclaimer.join();
+   }
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_release_h__
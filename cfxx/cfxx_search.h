@@ -0,0 +1,668 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef __cfxx_search_h__
+#define __cfxx_search_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "cfxx_data.h"
+
+// As in cfxx_unicode.h, the vector kernels are used when the compiler is targeting an
+// instruction set that has them. Define CFXX_NO_SIMD to force the scalar code paths.
+#if !defined(CFXX_NO_SIMD)
+   #if defined(__AVX2__)
+      #define CFXX_HAS_AVX2 1
+      #include <immintrin.h>
+   #endif
+   #if defined(__SSE2__)
+      #define CFXX_HAS_SSE2 1
+      #include <emmintrin.h>
+   #endif
+   #if defined(__ARM_NEON) && defined(__aarch64__)
+      #define CFXX_HAS_NEON 1
+      #include <arm_neon.h>
+   #endif
+#endif
+
+namespace CoreFoundation
+{
+
+// Searching the bytes of a DataView (or Data) for bytes, patterns and sets of bytes, and
+// splitting them up at delimiters without copying anything.
+//
+// Single bytes are found with memchr(), which the C library already vectorizes; the
+// rest have vector loops of their own. Patterns are found by checking their first and
+// last bytes at every position of a block at once and only comparing the whole pattern
+// where both match, which rules out nearly every position for the cost of two compares
+// per block. Without vectors, long patterns use Horspool's algorithm instead, which
+// can skip ahead by up to the length of the pattern at a time.
+
+namespace Detail
+{
+
+// Without vectors, patterns at least this long are searched for with Horspool's algorithm.
+enum { kHorspoolMinLength = 32 };
+
+// Sets of at most this many bytes are compared against a block at a time; bigger sets
+// are looked up byte by byte in a ByteSet.
+enum { kVectorSetMaxSize = 4 };
+
+// A set of bytes, as a bitmap.
+class ByteSet
+{
+public:
+   inline explicit ByteSet(DataView bytes) noexcept :
+      m_bits()
+   {
+      for (UInt8 b : bytes)
+         m_bits[b >> 5] |= 1u << (b & 31);
+   }
+
+   inline bool contains(UInt8 b) const noexcept
+   {
+      return (m_bits[b >> 5] >> (b & 31)) & 1;
+   }
+
+private:
+   uint32_t m_bits[8];
+};
+
+inline const UInt8* findByte(const UInt8* p, size_t n, UInt8 value) noexcept
+{
+   return n ? static_cast<const UInt8*>(std::memchr(p, value, n)) : nullptr;
+}
+
+// memrchr() isn't portable, so the last occurrence has a loop of its own.
+inline const UInt8* findLastByte(const UInt8* p, size_t n, UInt8 value) noexcept
+{
+   size_t i = n;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i needle256 = _mm256_set1_epi8(static_cast<char>(value));
+   for (; i >= 32; i -= 32)
+   {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i - 32));
+      const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle256)));
+      if (mask)
+         return p + i - 32 + (31 - __builtin_clz(mask));
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+   for (; i >= 16; i -= 16)
+   {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i - 16));
+      const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+      if (mask)
+         return p + i - 16 + (31 - __builtin_clz(mask));
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint8x16_t needle = vdupq_n_u8(value);
+   for (; i >= 16; i -= 16)
+   {
+      if (vmaxvq_u8(vceqq_u8(vld1q_u8(p + i - 16), needle)) != 0)
+         break;
+   }
+#endif
+
+   while (i > 0)
+   {
+      if (p[--i] == value)
+         return p + i;
+   }
+   return nullptr;
+}
+
+// The first byte that is in 'set', which has 'setSize' bytes (repeats allowed) that are
+// also in 'bits'.
+inline const UInt8* findAnyOf(const UInt8* p, size_t n, const UInt8* set, size_t setSize,
+   const ByteSet& bits) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_SSE2)
+   if (setSize != 0 && setSize <= kVectorSetMaxSize)
+   {
+      // Smaller sets repeat their first byte to fill out the four.
+      const __m128i n0 = _mm_set1_epi8(static_cast<char>(set[0]));
+      const __m128i n1 = _mm_set1_epi8(static_cast<char>(set[setSize > 1 ? 1 : 0]));
+      const __m128i n2 = _mm_set1_epi8(static_cast<char>(set[setSize > 2 ? 2 : 0]));
+      const __m128i n3 = _mm_set1_epi8(static_cast<char>(set[setSize > 3 ? 3 : 0]));
+      for (; i + 16 <= n; i += 16)
+      {
+         const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+         const __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, n0), _mm_cmpeq_epi8(v, n1)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, n2), _mm_cmpeq_epi8(v, n3)));
+         const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+         if (mask)
+            return p + i + __builtin_ctz(mask);
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   if (setSize != 0 && setSize <= kVectorSetMaxSize)
+   {
+      const uint8x16_t n0 = vdupq_n_u8(set[0]);
+      const uint8x16_t n1 = vdupq_n_u8(set[setSize > 1 ? 1 : 0]);
+      const uint8x16_t n2 = vdupq_n_u8(set[setSize > 2 ? 2 : 0]);
+      const uint8x16_t n3 = vdupq_n_u8(set[setSize > 3 ? 3 : 0]);
+      for (; i + 16 <= n; i += 16)
+      {
+         const uint8x16_t v = vld1q_u8(p + i);
+         const uint8x16_t eq = vorrq_u8(
+            vorrq_u8(vceqq_u8(v, n0), vceqq_u8(v, n1)),
+            vorrq_u8(vceqq_u8(v, n2), vceqq_u8(v, n3)));
+         if (vmaxvq_u8(eq) != 0)
+            break;
+      }
+   }
+#endif
+
+   for (; i < n; ++i)
+   {
+      if (bits.contains(p[i]))
+         return p + i;
+   }
+   return nullptr;
+}
+
+inline const UInt8* findNotOf(const UInt8* p, size_t n, const ByteSet& bits) noexcept
+{
+   for (size_t i = 0; i < n; ++i)
+   {
+      if (!bits.contains(p[i]))
+         return p + i;
+   }
+   return nullptr;
+}
+
+// Horspool's algorithm: line the pattern up, compare its last byte, and on a mismatch
+// move it along so that the last occurrence of the byte under its end lines up with
+// that byte. 'm' is at least 2, and no more than 'n'.
+inline const UInt8* findPatternHorspool(const UInt8* p, size_t n, const UInt8* pattern, size_t m) noexcept
+{
+   size_t skip[256];
+   std::fill(skip, skip + 256, m);
+   for (size_t j = 0; j + 1 < m; ++j)
+      skip[pattern[j]] = m - 1 - j;
+
+   const UInt8 last = pattern[m - 1];
+   for (size_t i = 0; i + m <= n; )
+   {
+      const UInt8 c = p[i + m - 1];
+      if (c == last && std::memcmp(p + i, pattern, m - 1) == 0)
+         return p + i;
+      i += skip[c];
+   }
+   return nullptr;
+}
+
+// The first occurrence of a pattern of 'm' bytes, where 'm' is at least 2 and no more
+// than 'n'.
+inline const UInt8* findPattern(const UInt8* p, size_t n, const UInt8* pattern, size_t m) noexcept
+{
+#if !defined(CFXX_HAS_SSE2) && !defined(CFXX_HAS_NEON)
+   if (m >= kHorspoolMinLength)
+      return findPatternHorspool(p, n, pattern, m);
+#endif
+
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i first256 = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+   const __m256i last256 = _mm256_set1_epi8(static_cast<char>(pattern[m - 1]));
+   for (; i + m - 1 + 32 <= n; i += 32)
+   {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+         _mm256_and_si256(_mm256_cmpeq_epi8(a, first256), _mm256_cmpeq_epi8(b, last256))));
+      for (; mask != 0; mask &= mask - 1)
+      {
+         const size_t at = i + __builtin_ctz(mask);
+         if (std::memcmp(p + at + 1, pattern + 1, m - 2) == 0)
+            return p + at;
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+   const __m128i last = _mm_set1_epi8(static_cast<char>(pattern[m - 1]));
+   for (; i + m - 1 + 16 <= n; i += 16)
+   {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+         _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+      for (; mask != 0; mask &= mask - 1)
+      {
+         const size_t at = i + __builtin_ctz(mask);
+         if (std::memcmp(p + at + 1, pattern + 1, m - 2) == 0)
+            return p + at;
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint8x16_t first = vdupq_n_u8(pattern[0]);
+   const uint8x16_t last = vdupq_n_u8(pattern[m - 1]);
+   for (; i + m - 1 + 16 <= n; i += 16)
+   {
+      const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(p + i), first), vceqq_u8(vld1q_u8(p + i + m - 1), last));
+      // Narrow to four bits per byte, as there's no movemask.
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+      while (mask != 0)
+      {
+         const size_t index = static_cast<size_t>(__builtin_ctzll(mask)) >> 2;
+         if (std::memcmp(p + i + index + 1, pattern + 1, m - 2) == 0)
+            return p + i + index;
+         mask &= ~(UINT64_C(0xF) << (index * 4));
+      }
+   }
+#endif
+
+   const UInt8 firstByte = pattern[0];
+   const UInt8 lastByte = pattern[m - 1];
+   for (; i + m <= n; ++i)
+   {
+      if (p[i] == firstByte && p[i + m - 1] == lastByte &&
+          std::memcmp(p + i + 1, pattern + 1, m - 2) == 0)
+         return p + i;
+   }
+   return nullptr;
+}
+
+// Horspool's algorithm again, from the other end: the pattern moves back so that the
+// first occurrence of the byte under its start lines up with that byte.
+inline const UInt8* findLastPatternHorspool(const UInt8* p, size_t n, const UInt8* pattern, size_t m) noexcept
+{
+   size_t skip[256];
+   std::fill(skip, skip + 256, m);
+   for (size_t j = m - 1; j > 0; --j)
+      skip[pattern[j]] = j;
+
+   const UInt8 first = pattern[0];
+   for (size_t i = n - m; ; )
+   {
+      const UInt8 c = p[i];
+      if (c == first && std::memcmp(p + i + 1, pattern + 1, m - 1) == 0)
+         return p + i;
+      if (i < skip[c])
+         return nullptr;
+      i -= skip[c];
+   }
+}
+
+// The last occurrence of a pattern of 'm' bytes, where 'm' is at least 2 and no more
+// than 'n'. The same as findPattern(), working back from the end a block at a time.
+inline const UInt8* findLastPattern(const UInt8* p, size_t n, const UInt8* pattern, size_t m) noexcept
+{
+#if !defined(CFXX_HAS_SSE2) && !defined(CFXX_HAS_NEON)
+   if (m >= kHorspoolMinLength)
+      return findLastPatternHorspool(p, n, pattern, m);
+#endif
+
+   // Every start before 'i' is yet to be checked.
+   size_t i = n - m + 1;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i first256 = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+   const __m256i last256 = _mm256_set1_epi8(static_cast<char>(pattern[m - 1]));
+   for (; i >= 32; i -= 32)
+   {
+      const UInt8* block = p + i - 32;
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+         _mm256_and_si256(_mm256_cmpeq_epi8(a, first256), _mm256_cmpeq_epi8(b, last256))));
+      while (mask != 0)
+      {
+         const unsigned index = 31 - __builtin_clz(mask);
+         if (std::memcmp(block + index + 1, pattern + 1, m - 2) == 0)
+            return block + index;
+         mask &= ~(1u << index);
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+   const __m128i last = _mm_set1_epi8(static_cast<char>(pattern[m - 1]));
+   for (; i >= 16; i -= 16)
+   {
+      const UInt8* block = p + i - 16;
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+         _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+      while (mask != 0)
+      {
+         const unsigned index = 31 - __builtin_clz(mask);
+         if (std::memcmp(block + index + 1, pattern + 1, m - 2) == 0)
+            return block + index;
+         mask &= ~(1u << index);
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint8x16_t first = vdupq_n_u8(pattern[0]);
+   const uint8x16_t last = vdupq_n_u8(pattern[m - 1]);
+   for (; i >= 16; i -= 16)
+   {
+      const UInt8* block = p + i - 16;
+      const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(block), first), vceqq_u8(vld1q_u8(block + m - 1), last));
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+      while (mask != 0)
+      {
+         const size_t index = static_cast<size_t>(63 - __builtin_clzll(mask)) >> 2;
+         if (std::memcmp(block + index + 1, pattern + 1, m - 2) == 0)
+            return block + index;
+         mask &= ~(UINT64_C(0xF) << (index * 4));
+      }
+   }
+#endif
+
+   const UInt8 firstByte = pattern[0];
+   const UInt8 lastByte = pattern[m - 1];
+   while (i > 0)
+   {
+      --i;
+      if (p[i] == firstByte && p[i + m - 1] == lastByte &&
+          std::memcmp(p + i + 1, pattern + 1, m - 2) == 0)
+         return p + i;
+   }
+   return nullptr;
+}
+
+} // namespace Detail
+
+// A lazily evaluated range over the fields of a DataView, as made by DataView::split()
+// and DataView::tokenize(). It doesn't own the bytes it's splitting, and its iterators
+// refer back to it, so it has to outlive them (as it does in a range-based for loop).
+class DataSplit
+{
+public:
+   class const_iterator
+   {
+   public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef DataView                  value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef const DataView*           pointer;
+      typedef const DataView&           reference;
+
+      inline const_iterator() noexcept :
+         m_split(nullptr),
+         m_field(),
+         m_done(true)
+      { }
+
+      inline reference operator*() const noexcept
+      {
+         return m_field;
+      }
+
+      inline pointer operator->() const noexcept
+      {
+         return &m_field;
+      }
+
+      inline const_iterator& operator++() noexcept
+      {
+         m_split->next(*this);
+         return *this;
+      }
+
+      inline const_iterator operator++(int) noexcept
+      {
+         const_iterator old(*this);
+         ++*this;
+         return old;
+      }
+
+      inline bool operator==(const const_iterator& other) const noexcept
+      {
+         return m_done == other.m_done && (m_done || m_field.data() == other.m_field.data());
+      }
+
+      inline bool operator!=(const const_iterator& other) const noexcept
+      {
+         return !(*this == other);
+      }
+
+   private:
+      friend class DataSplit;
+
+      const DataSplit* m_split;
+      DataView m_field;
+      bool m_done;
+   };
+
+   typedef const_iterator iterator;
+
+   inline const_iterator begin() const noexcept
+   {
+      const_iterator it;
+      it.m_split = this;
+      it.m_done = false;
+      if (m_mode == Mode::Tokens)
+         nextToken(it, m_data.data());
+      else
+         nextField(it, m_data.data());
+      return it;
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return const_iterator();
+   }
+
+private:
+   friend class DataView;
+
+   enum class Mode
+   {
+      Byte,
+      Pattern,
+      Tokens
+   };
+
+   inline DataSplit(DataView data, Mode mode, UInt8 byte, DataView delimiter) noexcept :
+      m_data(data),
+      m_delimiter(delimiter),
+      m_byte(byte),
+      m_mode(mode),
+      m_set(mode == Mode::Tokens ? delimiter : DataView())
+   { }
+
+   inline void next(const_iterator& it) const noexcept
+   {
+      const UInt8* end = m_data.end();
+      const UInt8* after = it.m_field.end();
+      if (m_mode == Mode::Tokens)
+      {
+         nextToken(it, after);
+      }
+      else if (after == end)
+      {
+         it.m_done = true;
+      }
+      else
+      {
+         nextField(it, after + (m_mode == Mode::Byte ? 1 : m_delimiter.size()));
+      }
+   }
+
+   // The field starting at 'start' runs up to the next delimiter, or the end.
+   inline void nextField(const_iterator& it, const UInt8* start) const noexcept
+   {
+      const size_t remaining = static_cast<size_t>(m_data.end() - start);
+      const UInt8* found;
+      if (m_mode == Mode::Byte)
+         found = Detail::findByte(start, remaining, m_byte);
+      else if (static_cast<size_t>(m_delimiter.size()) > remaining)
+         found = nullptr;
+      else if (m_delimiter.size() == 1)
+         found = Detail::findByte(start, remaining, m_delimiter[0]);
+      else
+         found = Detail::findPattern(start, remaining, m_delimiter.data(), static_cast<size_t>(m_delimiter.size()));
+      it.m_field = DataView(start, (found ? found : m_data.end()) - start);
+   }
+
+   // Skip any delimiters from 'start' on, then take everything up to the next one.
+   inline void nextToken(const_iterator& it, const UInt8* start) const noexcept
+   {
+      const UInt8* end = m_data.end();
+      start = Detail::findNotOf(start, static_cast<size_t>(end - start), m_set);
+      if (!start)
+      {
+         it.m_done = true;
+         return;
+      }
+      const UInt8* found = Detail::findAnyOf(start, static_cast<size_t>(end - start),
+         m_delimiter.data(), static_cast<size_t>(m_delimiter.size()), m_set);
+      it.m_field = DataView(start, (found ? found : end) - start);
+   }
+
+   DataView m_data;
+   DataView m_delimiter;
+   UInt8 m_byte;
+   Mode m_mode;
+   Detail::ByteSet m_set;
+};
+
+inline DataView::size_type DataView::find(UInt8 value, size_type from) const noexcept
+{
+   from = std::max<size_type>(from, 0);
+   if (from >= m_size)
+      return kCFNotFound;
+   const UInt8* found = Detail::findByte(m_data + from, static_cast<size_t>(m_size - from), value);
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataView::size_type DataView::find(DataView pattern, size_type from) const noexcept
+{
+   from = std::max<size_type>(from, 0);
+   if (from > m_size || pattern.size() > m_size - from)
+      return kCFNotFound;
+   if (pattern.size() <= 1)
+      return pattern.empty() ? from : find(pattern[0], from);
+
+   const UInt8* found = Detail::findPattern(m_data + from, static_cast<size_t>(m_size - from),
+      pattern.data(), static_cast<size_t>(pattern.size()));
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataView::size_type DataView::rfind(UInt8 value, size_type from) const noexcept
+{
+   const size_type limit = (from < 0 || from >= m_size) ? m_size : from + 1;
+   const UInt8* found = Detail::findLastByte(m_data, static_cast<size_t>(limit), value);
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataView::size_type DataView::rfind(DataView pattern, size_type from) const noexcept
+{
+   if (pattern.size() > m_size)
+      return kCFNotFound;
+   const size_type lastStart = m_size - pattern.size();
+   const size_type start = (from < 0 || from > lastStart) ? lastStart : from;
+   if (pattern.size() <= 1)
+      return pattern.empty() ? start : rfind(pattern[0], start);
+
+   const UInt8* found = Detail::findLastPattern(m_data, static_cast<size_t>(start + pattern.size()),
+      pattern.data(), static_cast<size_t>(pattern.size()));
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataView::size_type DataView::find_first_of(DataView set, size_type from) const noexcept
+{
+   from = std::max<size_type>(from, 0);
+   if (from >= m_size || set.empty())
+      return kCFNotFound;
+   if (set.size() == 1)
+      return find(set[0], from);
+
+   const UInt8* found = Detail::findAnyOf(m_data + from, static_cast<size_t>(m_size - from),
+      set.data(), static_cast<size_t>(set.size()), Detail::ByteSet(set));
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataView::size_type DataView::find_first_not_of(DataView set, size_type from) const noexcept
+{
+   from = std::max<size_type>(from, 0);
+   if (from >= m_size)
+      return kCFNotFound;
+
+   const UInt8* found = Detail::findNotOf(m_data + from, static_cast<size_t>(m_size - from), Detail::ByteSet(set));
+   return found ? found - m_data : kCFNotFound;
+}
+
+inline DataSplit DataView::split(UInt8 delimiter) const noexcept
+{
+   return DataSplit(*this, DataSplit::Mode::Byte, delimiter, DataView());
+}
+
+inline DataSplit DataView::split(DataView delimiter) const
+{
+   if (delimiter.empty())
+      throw std::invalid_argument("DataView::split");
+   return DataSplit(*this, DataSplit::Mode::Pattern, 0, delimiter);
+}
+
+inline DataSplit DataView::tokenize(DataView delimiters) const noexcept
+{
+   return DataSplit(*this, DataSplit::Mode::Tokens, 0, delimiters);
+}
+
+inline DataSplit Data::split(UInt8 delimiter) const noexcept
+{
+   return view().split(delimiter);
+}
+
+inline DataSplit Data::split(DataView delimiter) const
+{
+   return view().split(delimiter);
+}
+
+inline DataSplit Data::tokenize(DataView delimiters) const noexcept
+{
+   return view().tokenize(delimiters);
+}
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_search_h__
@@ -0,0 +1,472 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef __cfxx_split_h__
+#define __cfxx_split_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cfxx_string.h"
+
+namespace CoreFoundation
+{
+
+// A run of characters within a String, as an offset and a length: what String::split()
+// and String::tokenize() yield. It doesn't retain the String, so it's only good for as
+// long as that is. Turning it into a String or std::string of its own is up to the
+// caller, and only then is anything allocated.
+class StringView
+{
+public:
+   typedef CFIndex size_type;
+
+   inline StringView() noexcept :
+      m_string(nullptr),
+      m_offset(0),
+      m_length(0)
+   { }
+
+   inline StringView(const String& string, size_type offset, size_type length) noexcept :
+      m_string(&string),
+      m_offset(offset),
+      m_length(length)
+   { }
+
+   // Where the characters start in the String.
+   inline size_type offset() const noexcept
+   {
+      return m_offset;
+   }
+
+   inline size_type size() const noexcept
+   {
+      return m_length;
+   }
+
+   inline size_type length() const noexcept
+   {
+      return m_length;
+   }
+
+   inline bool empty() const noexcept
+   {
+      return m_length == 0;
+   }
+
+   inline UniChar operator[](size_type index) const noexcept
+   {
+      return (*m_string)[m_offset + index];
+   }
+
+   // The characters as a String of their own, made with String::substr(), so CF can
+   // share the storage where it's able to.
+   inline String str(CFAllocatorRef allocator = kCFAllocatorDefault) const
+   {
+      return m_string ? m_string->substr(m_offset, m_length, allocator) : String();
+   }
+
+   inline std::string to_string(CFStringEncoding encoding = kCFStringEncodingUTF8) const
+   {
+      if (m_length == 0)
+         return std::string();
+
+      const CFRange range = CFRangeMake(m_offset, m_length);
+      CFIndex required = 0;
+      CFStringGetBytes(*m_string, range, encoding, 0, false, nullptr, 0, &required);
+      std::string result(static_cast<size_t>(required), '\0');
+      CFStringGetBytes(*m_string, range, encoding, 0, false,
+         reinterpret_cast<UInt8*>(&result[0]), required, nullptr);
+      return result;
+   }
+
+private:
+   const String* m_string;
+   size_type m_offset;
+   size_type m_length;
+};
+
+namespace Detail
+{
+
+// Reads the characters of a String for the split and tokenize ranges: straight out of
+// CF's own storage if it will hand that out, and otherwise copied out a block at a time
+// into a buffer, which is kept for as long as it covers the characters being asked for.
+// The String mustn't change while it's being read.
+class StringScanner
+{
+public:
+   enum { kBufferSize = String::kDefaultChunkSize };
+
+   inline explicit StringScanner(const String& s) noexcept :
+      m_ref(s),
+      m_length(s.length()),
+      m_wide(CFStringGetCharactersPtr(s)),
+      m_narrow(m_wide ? nullptr : reinterpret_cast<const UInt8*>(CFStringGetCStringPtr(s, kCFStringEncodingASCII))),
+      m_bufferStart(0),
+      m_bufferLength(0)
+   { }
+
+   inline CFIndex length() const noexcept
+   {
+      return m_length;
+   }
+
+   inline bool isDirect() const noexcept
+   {
+      return m_wide || m_narrow;
+   }
+
+   // The first position at or after 'from' whose character satisfies 'predicate', or the
+   // length if there isn't one.
+   template<typename Predicate>
+   inline CFIndex findIf(CFIndex from, Predicate& predicate) const
+   {
+      if (m_wide)
+      {
+         for (; from < m_length && !predicate(m_wide[from]); ++from)
+            ;
+         return from;
+      }
+      if (m_narrow)
+      {
+         for (; from < m_length && !predicate(static_cast<UniChar>(m_narrow[from])); ++from)
+            ;
+         return from;
+      }
+
+      while (from < m_length)
+      {
+         const UniChar* characters = window(from, 1);
+         const CFIndex available = m_bufferStart + m_bufferLength - from;
+         for (CFIndex i = 0; i < available; ++i)
+         {
+            if (predicate(characters[i]))
+               return from + i;
+         }
+         from += available;
+      }
+      return m_length;
+   }
+
+   // The first occurrence at or after 'from' of a pattern of 'm' characters, or the length
+   // if there isn't one. 'narrowPattern' is the pattern as bytes, or null if it isn't
+   // ASCII. Without direct access, 'm' can't be more than kBufferSize.
+   inline CFIndex find(CFIndex from, const UniChar* pattern, const UInt8* narrowPattern, size_t m) const noexcept
+   {
+      const CFIndex patternLength = static_cast<CFIndex>(m);
+      if (from + patternLength > m_length)
+         return m_length;
+
+      const size_t count = static_cast<size_t>(m_length - from);
+      if (m_wide)
+      {
+         const UniChar* found = m == 1 ?
+            findCharacter(m_wide + from, count, pattern[0]) :
+            findCharacters(m_wide + from, count, pattern, m);
+         return found ? found - m_wide : m_length;
+      }
+      if (m_narrow)
+      {
+         if (!narrowPattern)
+            return m_length;
+         const UInt8* found = m == 1 ?
+            findByte(m_narrow + from, count, narrowPattern[0]) :
+            findPattern(m_narrow + from, count, narrowPattern, m);
+         return found ? found - m_narrow : m_length;
+      }
+
+      // A match can straddle two blocks, so each one after the first starts m - 1
+      // characters before the end of the last.
+      while (from + patternLength <= m_length)
+      {
+         const UniChar* characters = window(from, patternLength);
+         const size_t available = static_cast<size_t>(m_bufferStart + m_bufferLength - from);
+         const UniChar* found = m == 1 ?
+            findCharacter(characters, available, pattern[0]) :
+            findCharacters(characters, available, pattern, m);
+         if (found)
+            return from + (found - characters);
+         if (m_bufferStart + m_bufferLength == m_length)
+            break;
+         from += static_cast<CFIndex>(available - (m - 1));
+      }
+      return m_length;
+   }
+
+private:
+   // The characters from 'from' on, with at least 'minimum' of them in the buffer.
+   inline const UniChar* window(CFIndex from, CFIndex minimum) const noexcept
+   {
+      if (from < m_bufferStart || from + minimum > m_bufferStart + m_bufferLength)
+      {
+         m_bufferStart = from;
+         m_bufferLength = std::min<CFIndex>(kBufferSize, m_length - from);
+         CFStringGetCharacters(m_ref, CFRangeMake(m_bufferStart, m_bufferLength), m_buffer);
+      }
+      return m_buffer + (from - m_bufferStart);
+   }
+
+   CFStringRef m_ref;
+   CFIndex m_length;
+   const UniChar* m_wide;
+   const UInt8* m_narrow; // ASCII only
+
+   mutable CFIndex m_bufferStart;
+   mutable CFIndex m_bufferLength;
+   mutable UniChar m_buffer[kBufferSize];
+};
+
+// The iterator for StringSplit and StringTokens, which do the actual work of finding
+// each field in their first() and next().
+template<typename Range>
+class StringFieldIterator
+{
+public:
+   typedef std::forward_iterator_tag iterator_category;
+   typedef StringView                value_type;
+   typedef std::ptrdiff_t            difference_type;
+   typedef const StringView*         pointer;
+   typedef const StringView&         reference;
+
+   inline StringFieldIterator() noexcept :
+      m_range(nullptr),
+      m_field(),
+      m_done(true)
+   { }
+
+   inline reference operator*() const noexcept
+   {
+      return m_field;
+   }
+
+   inline pointer operator->() const noexcept
+   {
+      return &m_field;
+   }
+
+   inline StringFieldIterator& operator++()
+   {
+      m_range->next(*this);
+      return *this;
+   }
+
+   inline StringFieldIterator operator++(int)
+   {
+      StringFieldIterator old(*this);
+      ++*this;
+      return old;
+   }
+
+   inline bool operator==(const StringFieldIterator& other) const noexcept
+   {
+      return m_done == other.m_done && (m_done || m_field.offset() == other.m_field.offset());
+   }
+
+   inline bool operator!=(const StringFieldIterator& other) const noexcept
+   {
+      return !(*this == other);
+   }
+
+private:
+   friend Range;
+
+   const Range* m_range;
+   StringView m_field;
+   bool m_done;
+};
+
+} // namespace Detail
+
+// A lazily evaluated range over the fields of a String between occurrences of a
+// delimiter, as made by String::split(). It refers to the String rather than retaining
+// it, and its iterators refer back to it, so both have to outlive the iterators (as they
+// do in a range-based for loop). Iterating over the same range from two threads at once
+// isn't safe, since they share its buffer.
+class StringSplit
+{
+public:
+   typedef Detail::StringFieldIterator<StringSplit> const_iterator;
+   typedef const_iterator                           iterator;
+
+   inline const_iterator begin() const
+   {
+      const_iterator it;
+      it.m_range = this;
+      it.m_done = false;
+      nextField(it, 0);
+      return it;
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return const_iterator();
+   }
+
+private:
+   friend class String;
+   friend class Detail::StringFieldIterator<StringSplit>;
+
+   inline StringSplit(const String& s, const String& delimiter) :
+      m_string(&s),
+      m_delimiter(delimiter),
+      m_scanner(s)
+   {
+      if (delimiter.empty())
+         throw std::invalid_argument("String::split");
+
+      // Copied out once here, rather than for every search.
+      m_characters.resize(static_cast<size_t>(delimiter.length()));
+      CFStringGetCharacters(delimiter, CFRangeMake(0, delimiter.length()), m_characters.data());
+      if (std::all_of(m_characters.begin(), m_characters.end(), [](UniChar c) { return c < 0x80; }))
+         m_narrowCharacters.assign(m_characters.begin(), m_characters.end());
+   }
+
+   inline void next(const_iterator& it) const
+   {
+      const CFIndex after = it.m_field.offset() + it.m_field.length();
+      if (after == m_scanner.length())
+         it.m_done = true;
+      else
+         nextField(it, after + m_delimiter.length());
+   }
+
+   // The field starting at 'start' runs up to the next delimiter, or the end.
+   inline void nextField(const_iterator& it, CFIndex start) const
+   {
+      CFIndex end;
+      if (!m_scanner.isDirect() && m_characters.size() > Detail::StringScanner::kBufferSize)
+      {
+         // Too long to search for a block at a time; this is CF's job.
+         const CFIndex found = m_string->find(m_delimiter, start);
+         end = found == String::npos ? m_scanner.length() : found;
+      }
+      else
+      {
+         end = m_scanner.find(start, m_characters.data(),
+            m_narrowCharacters.empty() ? nullptr : m_narrowCharacters.data(), m_characters.size());
+      }
+      it.m_field = StringView(*m_string, start, end - start);
+   }
+
+   const String* m_string;
+   String m_delimiter;
+   std::vector<UniChar> m_characters;
+   std::vector<UInt8> m_narrowCharacters;
+   Detail::StringScanner m_scanner;
+};
+
+// A lazily evaluated range over the non-empty runs of characters in a String for which a
+// predicate returns false, as made by String::tokenize(). As with StringSplit, the
+// String and the range have to outlive the iterators.
+template<typename Predicate>
+class StringTokens
+{
+public:
+   typedef Detail::StringFieldIterator<StringTokens> const_iterator;
+   typedef const_iterator                            iterator;
+
+   inline const_iterator begin() const
+   {
+      const_iterator it;
+      it.m_range = this;
+      it.m_done = false;
+      nextToken(it, 0);
+      return it;
+   }
+
+   inline const_iterator end() const noexcept
+   {
+      return const_iterator();
+   }
+
+private:
+   friend class String;
+   friend class Detail::StringFieldIterator<StringTokens>;
+
+   // Finds the first character that isn't a delimiter.
+   class NotDelimiter
+   {
+   public:
+      inline explicit NotDelimiter(Predicate& isDelimiter) noexcept :
+         m_isDelimiter(isDelimiter)
+      { }
+
+      inline bool operator()(UniChar c)
+      {
+         return !m_isDelimiter(c);
+      }
+
+   private:
+      Predicate& m_isDelimiter;
+   };
+
+   inline StringTokens(const String& s, Predicate isDelimiter) :
+      m_string(&s),
+      m_isDelimiter(std::move(isDelimiter)),
+      m_scanner(s)
+   { }
+
+   inline void next(const_iterator& it) const
+   {
+      nextToken(it, it.m_field.offset() + it.m_field.length());
+   }
+
+   // Skip any delimiters from 'start' on, then take everything up to the next one.
+   inline void nextToken(const_iterator& it, CFIndex start) const
+   {
+      NotDelimiter notDelimiter(m_isDelimiter);
+      start = m_scanner.findIf(start, notDelimiter);
+      if (start == m_scanner.length())
+      {
+         it.m_done = true;
+         return;
+      }
+      const CFIndex end = m_scanner.findIf(start + 1, m_isDelimiter);
+      it.m_field = StringView(*m_string, start, end - start);
+   }
+
+   const String* m_string;
+   mutable Predicate m_isDelimiter;
+   Detail::StringScanner m_scanner;
+};
+
+inline StringSplit String::split(const String& delimiter) const
+{
+   return StringSplit(*this, delimiter);
+}
+
+template<typename Predicate>
+inline StringTokens<Predicate> String::tokenize(Predicate isDelimiter) const
+{
+   return StringTokens<Predicate>(*this, std::move(isDelimiter));
+}
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_split_h__
@@ -0,0 +1,513 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_stream_h__
+#define __cfxx_stream_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <streambuf>
+#include <type_traits>
+#include "cfxx_data.h"
+
+namespace CoreFoundation
+{
+
+// Longest LEB128 encoding of a 64-bit value.
+enum { kMaxVarintLength = 10 };
+
+namespace Detail
+{
+
+template<size_t Size> struct UnsignedOfSize;
+template<> struct UnsignedOfSize<1> { typedef uint8_t type; };
+template<> struct UnsignedOfSize<2> { typedef uint16_t type; };
+template<> struct UnsignedOfSize<4> { typedef uint32_t type; };
+template<> struct UnsignedOfSize<8> { typedef uint64_t type; };
+
+// The bits of an integer or floating point value, as an unsigned integer of the same size.
+template<typename T>
+inline typename UnsignedOfSize<sizeof(T)>::type bitsOf(T value) noexcept
+{
+   static_assert(std::is_arithmetic<T>::value, "only integers and floating point values can be serialized");
+   typename UnsignedOfSize<sizeof(T)>::type bits;
+   std::memcpy(&bits, &value, sizeof(T));
+   return bits;
+}
+
+template<typename T>
+inline T fromBits(typename UnsignedOfSize<sizeof(T)>::type bits) noexcept
+{
+   static_assert(std::is_arithmetic<T>::value, "only integers and floating point values can be serialized");
+   T value;
+   std::memcpy(&value, &bits, sizeof(T));
+   return value;
+}
+
+// Byte-at-a-time, so that it's independent of the host byte order; compilers turn these
+// into a single (byte-swapping, if need be) load or store.
+template<typename U>
+inline void storeLittleEndian(UInt8* p, U value) noexcept
+{
+   for (size_t i = 0; i < sizeof(U); ++i)
+      p[i] = static_cast<UInt8>(value >> (8 * i));
+}
+
+template<typename U>
+inline void storeBigEndian(UInt8* p, U value) noexcept
+{
+   for (size_t i = 0; i < sizeof(U); ++i)
+      p[i] = static_cast<UInt8>(value >> (8 * (sizeof(U) - 1 - i)));
+}
+
+template<typename U>
+inline U loadLittleEndian(const UInt8* p) noexcept
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   // GCC doesn't always spot the loop below as a load when it's in a loop itself (as in
+   // the checksums), so say so directly where we can.
+   U value;
+   std::memcpy(&value, p, sizeof(U));
+   return value;
+#else
+   U value = 0;
+   for (size_t i = 0; i < sizeof(U); ++i)
+      value |= static_cast<U>(static_cast<U>(p[i]) << (8 * i));
+   return value;
+#endif
+}
+
+template<typename U>
+inline U loadBigEndian(const UInt8* p) noexcept
+{
+   U value = 0;
+   for (size_t i = 0; i < sizeof(U); ++i)
+      value |= static_cast<U>(static_cast<U>(p[i]) << (8 * (sizeof(U) - 1 - i)));
+   return value;
+}
+
+} // namespace Detail
+
+// DataWriter appends binary fields (varints, fixed-width integers and floats in either
+// byte order, and length-prefixed byte runs) to the end of a MutableData.
+//
+// Fields are encoded straight into the MutableData's storage: the writer grows the data
+// to its full capacity and writes into the spare bytes at the end, so that most fields
+// cost a bounds check and a store, with no CF calls or temporary buffers. While the
+// writer is active the data is longer than what's been written; finish() (or destroying
+// the writer) trims it back. Don't use the MutableData in between.
+class DataWriter
+{
+public:
+   inline explicit DataWriter(MutableData& data) noexcept :
+      m_data(data),
+      m_begin(nullptr),
+      m_cursor(nullptr),
+      m_end(nullptr)
+   { }
+
+   DataWriter(const DataWriter&) = delete;
+   DataWriter& operator=(const DataWriter&) = delete;
+
+   inline ~DataWriter()
+   {
+      finish();
+   }
+
+   // Trim the data to the bytes written so far. Writing can carry on afterwards.
+   inline void finish() noexcept
+   {
+      if (m_begin)
+      {
+         m_data.resize(static_cast<MutableData::size_type>(m_cursor - m_begin));
+         m_begin = m_cursor = m_end = nullptr;
+      }
+   }
+
+   // Size of the data, counting everything written so far.
+   inline size_t position() const noexcept
+   {
+      return m_begin ? static_cast<size_t>(m_cursor - m_begin) : static_cast<size_t>(m_data.size());
+   }
+
+   // Make room for 'n' more bytes up front.
+   inline void reserve(size_t n) noexcept
+   {
+      room(n);
+   }
+
+   inline DataWriter& write_byte(UInt8 value) noexcept
+   {
+      *room(1) = value;
+      ++m_cursor;
+      return *this;
+   }
+
+   inline DataWriter& write_bytes(const void* bytes, size_t n) noexcept
+   {
+      if (n)
+         std::memcpy(room(n), bytes, n);
+      m_cursor += n;
+      return *this;
+   }
+
+   inline DataWriter& write_bytes(DataView data) noexcept
+   {
+      return write_bytes(data.data(), static_cast<size_t>(data.size()));
+   }
+
+   // Integers and floating point values, least significant byte first.
+   template<typename T>
+   inline DataWriter& write_le(T value) noexcept
+   {
+      Detail::storeLittleEndian(room(sizeof(T)), Detail::bitsOf(value));
+      m_cursor += sizeof(T);
+      return *this;
+   }
+
+   // Integers and floating point values, most significant byte first.
+   template<typename T>
+   inline DataWriter& write_be(T value) noexcept
+   {
+      Detail::storeBigEndian(room(sizeof(T)), Detail::bitsOf(value));
+      m_cursor += sizeof(T);
+      return *this;
+   }
+
+   // Unsigned LEB128: 7 bits per byte, low bits first.
+   inline DataWriter& write_varint(uint64_t value) noexcept
+   {
+      UInt8* p = room(kMaxVarintLength);
+      while (value >= 0x80)
+      {
+         *p++ = static_cast<UInt8>(value) | 0x80;
+         value >>= 7;
+      }
+      *p++ = static_cast<UInt8>(value);
+      m_cursor = p;
+      return *this;
+   }
+
+   // Signed values as zigzag-encoded varints, so that small negative numbers stay short.
+   inline DataWriter& write_zigzag(int64_t value) noexcept
+   {
+      return write_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+   }
+
+   // A varint length followed by the bytes.
+   inline DataWriter& write_length_prefixed(const void* bytes, size_t n) noexcept
+   {
+      room(kMaxVarintLength + n);
+      write_varint(n);
+      return write_bytes(bytes, n);
+   }
+
+   inline DataWriter& write_length_prefixed(DataView data) noexcept
+   {
+      return write_length_prefixed(data.data(), static_cast<size_t>(data.size()));
+   }
+
+private:
+   // Make sure there are at least 'n' spare bytes after the cursor, and return the cursor.
+   inline UInt8* room(size_t n) noexcept
+   {
+      if (static_cast<size_t>(m_end - m_cursor) < n)
+         grow(n);
+      return m_cursor;
+   }
+
+   inline void grow(size_t n) noexcept
+   {
+      // Let MutableData's growth policy pick the new capacity, then use all of it.
+      const MutableData::size_type written = static_cast<MutableData::size_type>(position());
+      m_data.growToCapacity(written + static_cast<MutableData::size_type>(n));
+      m_begin = m_data.data();
+      m_cursor = m_begin + written;
+      m_end = m_begin + m_data.size();
+   }
+
+   MutableData& m_data;
+   UInt8* m_begin;    // Start of the data's storage while writing; null otherwise.
+   UInt8* m_cursor;
+   UInt8* m_end;
+};
+
+// DataReader decodes what DataWriter writes, from a Data (or any run of bytes) that has to
+// outlive it. Reads that run off the end throw std::out_of_range.
+//
+// Bounds are checked once per field rather than once per byte; varints are decoded
+// without any checks at all whenever there are enough bytes left for the longest one.
+// Byte runs are returned as DataViews pointing into the data, without copying.
+class DataReader
+{
+public:
+   inline explicit DataReader(DataView data) noexcept :
+      DataReader(data.data(), static_cast<size_t>(data.size()))
+   { }
+
+   inline DataReader(const UInt8* bytes, size_t n) noexcept :
+      m_begin(bytes),
+      m_cursor(bytes),
+      m_end(bytes + n)
+   { }
+
+   inline size_t position() const noexcept
+   {
+      return static_cast<size_t>(m_cursor - m_begin);
+   }
+
+   inline size_t remaining() const noexcept
+   {
+      return static_cast<size_t>(m_end - m_cursor);
+   }
+
+   inline bool at_end() const noexcept
+   {
+      return m_cursor == m_end;
+   }
+
+   inline UInt8 read_byte()
+   {
+      require(1);
+      return *m_cursor++;
+   }
+
+   inline DataView read_bytes(size_t n)
+   {
+      require(n);
+      const DataView view(m_cursor, static_cast<DataView::size_type>(n));
+      m_cursor += n;
+      return view;
+   }
+
+   inline void skip(size_t n)
+   {
+      require(n);
+      m_cursor += n;
+   }
+
+   template<typename T>
+   inline T read_le()
+   {
+      typedef typename Detail::UnsignedOfSize<sizeof(T)>::type Bits;
+      require(sizeof(T));
+      const T value = Detail::fromBits<T>(Detail::loadLittleEndian<Bits>(m_cursor));
+      m_cursor += sizeof(T);
+      return value;
+   }
+
+   template<typename T>
+   inline T read_be()
+   {
+      typedef typename Detail::UnsignedOfSize<sizeof(T)>::type Bits;
+      require(sizeof(T));
+      const T value = Detail::fromBits<T>(Detail::loadBigEndian<Bits>(m_cursor));
+      m_cursor += sizeof(T);
+      return value;
+   }
+
+   // Throws std::overflow_error if the varint is longer than any 64-bit value's.
+   inline uint64_t read_varint()
+   {
+      const UInt8* p = m_cursor;
+      uint64_t value = 0;
+      if (remaining() >= kMaxVarintLength)
+      {
+         for (unsigned shift = 0; shift < 64; shift += 7)
+         {
+            const UInt8 byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+               m_cursor = p;
+               return value;
+            }
+         }
+      }
+      else
+      {
+         for (unsigned shift = 0; shift < 64; shift += 7)
+         {
+            if (p == m_end)
+               throw std::out_of_range("DataReader");
+            const UInt8 byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+               m_cursor = p;
+               return value;
+            }
+         }
+      }
+      throw std::overflow_error("DataReader");
+   }
+
+   inline int64_t read_zigzag()
+   {
+      const uint64_t value = read_varint();
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+   }
+
+   inline DataView read_length_prefixed()
+   {
+      const uint64_t n = read_varint();
+      if (n > remaining())
+         throw std::out_of_range("DataReader");
+      return read_bytes(static_cast<size_t>(n));
+   }
+
+   // Throws std::out_of_range unless there are at least 'n' bytes left.
+   inline void require(size_t n) const
+   {
+      if (n > remaining())
+         throw std::out_of_range("DataReader");
+   }
+
+private:
+   const UInt8* m_begin;
+   const UInt8* m_cursor;
+   const UInt8* m_end;
+};
+
+// A std::streambuf that appends to a MutableData, for code that writes to a std::ostream.
+// Like DataWriter, it writes straight into the data's spare capacity, and the data has
+// extra bytes on the end until finish() is called or the streambuf is destroyed.
+class MutableDataStreamBuf : public std::streambuf
+{
+public:
+   inline explicit MutableDataStreamBuf(MutableData& data) noexcept :
+      m_data(data)
+   { }
+
+   MutableDataStreamBuf(const MutableDataStreamBuf&) = delete;
+   MutableDataStreamBuf& operator=(const MutableDataStreamBuf&) = delete;
+
+   inline ~MutableDataStreamBuf()
+   {
+      finish();
+   }
+
+   inline void finish() noexcept
+   {
+      if (pptr())
+      {
+         m_data.resize(static_cast<MutableData::size_type>(position()));
+         setp(nullptr, nullptr);
+      }
+   }
+
+protected:
+   inline int_type overflow(int_type ch) override
+   {
+      grow(1);
+      if (!traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+         *pptr() = traits_type::to_char_type(ch);
+         pbump(1);
+      }
+      return traits_type::not_eof(ch);
+   }
+
+   inline std::streamsize xsputn(const char* s, std::streamsize n) override
+   {
+      if (epptr() - pptr() < n)
+         grow(static_cast<size_t>(n));
+      std::memcpy(pptr(), s, static_cast<size_t>(n));
+      // pbump() only takes an int; this works for any length.
+      setp(pptr() + n, epptr());
+      return n;
+   }
+
+   inline pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+   {
+      // Only telling the position is supported.
+      if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out))
+         return pos_type(off_type(-1));
+      return pos_type(static_cast<off_type>(position()));
+   }
+
+private:
+   inline size_t position() const noexcept
+   {
+      if (!pptr())
+         return static_cast<size_t>(m_data.size());
+      return static_cast<size_t>(reinterpret_cast<const UInt8*>(pptr()) - m_data.Data::data());
+   }
+
+   inline void grow(size_t n) noexcept
+   {
+      const MutableData::size_type written = static_cast<MutableData::size_type>(position());
+      m_data.growToCapacity(written + static_cast<MutableData::size_type>(n));
+      char* base = reinterpret_cast<char*>(m_data.data());
+      setp(base + written, base + m_data.size());
+   }
+
+   MutableData& m_data;
+};
+
+// A std::streambuf that reads from a Data (which has to outlive it), for code that reads
+// from a std::istream. The get area is the data itself, so nothing is copied.
+class DataStreamBuf : public std::streambuf
+{
+public:
+   inline explicit DataStreamBuf(const Data& data) noexcept
+   {
+      char* begin = const_cast<char*>(reinterpret_cast<const char*>(data.data()));
+      setg(begin, begin, begin + data.size());
+   }
+
+protected:
+   inline pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+   {
+      if (!(which & std::ios_base::in))
+         return pos_type(off_type(-1));
+      off_type base = 0;
+      if (dir == std::ios_base::cur)
+         base = gptr() - eback();
+      else if (dir == std::ios_base::end)
+         base = egptr() - eback();
+      return seekpos(pos_type(base + off), which);
+   }
+
+   inline pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+   {
+      const off_type offset = off_type(pos);
+      if (!(which & std::ios_base::in) || offset < 0 || offset > egptr() - eback())
+         return pos_type(off_type(-1));
+      setg(eback(), eback() + offset, egptr());
+      return pos;
+   }
+
+   inline std::streamsize showmanyc() override
+   {
+      return egptr() - gptr();
+   }
+};
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_stream_h__
@@ -29,7 +29,11 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreFoundation/CFString.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace CoreFoundation
@@ -37,6 +41,8 @@ namespace CoreFoundation
 
 class String;
 class MutableString;
+class StringSplit;
+template<typename Predicate> class StringTokens;
 
 template<>
 struct IsParentCFType<CFTypeRef, CFStringRef> : public std::integral_constant<bool, true> {};
@@ -68,46 +74,67 @@ public:
    typedef const UniChar* const_pointer;
    typedef CFIndex size_type;
 
+   // The on-stack buffer used by for_each_chunk when the caller doesn't supply one.
+   enum { kDefaultChunkSize = 1024 };
+
    // This serves essentially the same function as CFStringInlineBuffer, but
    // doesn't have the macro weirdness that CFString.h has going on with it.
+   //
+   // The window buffer lives inside the accessor, and nothing at all is set up until
+   // the first indexed access, so constructing or copying one never touches the heap
+   // (or even CoreFoundation). Strings that are only ever passed around don't pay for it.
    class BufferingStringAccessor
    {
    public:
-      inline BufferingStringAccessor(const CFStringRef& stringRef)
-      {
+      enum { kBufferSize = 64 };
+
+      inline BufferingStringAccessor(const CFStringRef& stringRef) noexcept :
          // Merely copy the reference; we don't increment the reference count. This
          // object has undefined behavior if it has a lifetime exceeding the parent
          // String object.
-         m_stringRef = stringRef;
-         // The string is ostensibly immutable, so the length should not change.
-         m_stringLength = CFStringGetLength(stringRef);
+         m_stringRef(stringRef),
+         m_directPtr(nullptr),
+         m_stringLength(0),
+         m_bufferBeginPosition(0),
+         m_bufferEndPosition(0),
+         m_initialized(false)
+      { }
 
-         // This will either return the pointer, or NULL. If non-NULL, no buffering!
-         m_directPtr = CFStringGetCharactersPtr(stringRef);
-         if (m_directPtr == nullptr)
-         {
-            // Alas. Initialize some space.
-            m_buffer.resize(std::min<size_t>(64, m_stringLength));
-         }
+      // The window contents aren't copied; the copy will refill its own on demand.
+      inline BufferingStringAccessor(const BufferingStringAccessor& other) noexcept :
+         m_stringRef(other.m_stringRef),
+         m_directPtr(nullptr),
+         m_stringLength(0),
+         m_bufferBeginPosition(0),
+         m_bufferEndPosition(0),
+         m_initialized(false)
+      { }
 
-         m_bufferBeginPosition = m_bufferEndPosition = 0;
+      inline BufferingStringAccessor& operator=(const BufferingStringAccessor& other) noexcept
+      {
+         reset(other.m_stringRef);
+         return *this;
       }
 
-      inline BufferingStringAccessor(const BufferingStringAccessor& other) :
-         m_stringRef(other.m_stringRef),
-         m_directPtr(other.m_directPtr),
-         m_stringLength(other.m_stringLength),
-         m_bufferBeginPosition(0),
-         m_bufferEndPosition(0)
+      // Point at a (possibly) different string, and forget everything we knew.
+      inline void reset(CFStringRef stringRef) noexcept
       {
-         if (m_directPtr == nullptr)
-         {
-            m_buffer.resize(std::min<size_t>(64, m_stringLength));
-         }
+         m_stringRef = stringRef;
+         invalidate();
+      }
+
+      // Forget the cached length, pointer and window; used when the string has been mutated.
+      inline void invalidate() noexcept
+      {
+         m_initialized = false;
+         m_bufferBeginPosition = m_bufferEndPosition = 0;
       }
 
       inline const UniChar& get(CFIndex index) const noexcept
       {
+         if (!m_initialized)
+            initialize();
+
          if (m_directPtr)
          {
             return m_directPtr[index];
@@ -122,15 +149,15 @@ public:
                if ((m_bufferBeginPosition = index - 4) < 0)
                   m_bufferBeginPosition = 0;
 
-               m_bufferEndPosition = m_bufferBeginPosition + m_buffer.size();
+               m_bufferEndPosition = m_bufferBeginPosition + kBufferSize;
 
                if (m_bufferEndPosition > m_stringLength)
                   m_bufferEndPosition = m_stringLength;
 
                CFStringGetCharacters(
                   m_stringRef,
-                  CFRangeMake(m_bufferBeginPosition, static_cast<CFIndex>(m_buffer.size())),
-                  m_buffer.data());
+                  CFRangeMake(m_bufferBeginPosition, m_bufferEndPosition - m_bufferBeginPosition),
+                  m_buffer);
             }
 
             return m_buffer[index - m_bufferBeginPosition];
@@ -139,20 +166,39 @@ public:
 
       inline const UniChar& checkedGet(CFIndex index) const
       {
+         if (!m_initialized)
+            initialize();
+
          if (index < 0 || index >= m_stringLength)
             throw std::out_of_range("BufferingStringAccessor");
          return get(index);
       }
 
    private:
-      mutable std::vector<UniChar> m_buffer;
+      inline void initialize() const noexcept
+      {
+         // The string is ostensibly immutable, so the length should not change. (MutableString
+         // invalidates us whenever it changes.)
+         m_stringLength = CFStringGetLength(m_stringRef);
+
+         // This will either return the pointer, or NULL. If non-NULL, no buffering!
+         m_directPtr = CFStringGetCharactersPtr(m_stringRef);
+
+         m_bufferBeginPosition = m_bufferEndPosition = 0;
+         m_initialized = true;
+      }
+
+      // Deliberately left uninitialized; only [m_bufferBeginPosition, m_bufferEndPosition)
+      // is ever read.
+      mutable UniChar m_buffer[kBufferSize];
 
       CFStringRef m_stringRef;
-      const UniChar* m_directPtr;
-      CFIndex m_stringLength;
+      mutable const UniChar* m_directPtr;
+      mutable CFIndex m_stringLength;
 
       mutable CFIndex m_bufferBeginPosition;
       mutable CFIndex m_bufferEndPosition;
+      mutable bool m_initialized;
    };
 
 
@@ -282,35 +328,127 @@ public:
 
    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
+   // Every constructor that creates a CFString takes an optional CFAllocatorRef to
+   // create it with (see cfxx_allocator.h); kCFAllocatorDefault otherwise.
    inline String() :
+      String(kCFAllocatorDefault)
+   { }
+
+   inline explicit String(CFAllocatorRef allocator) :
       Base(makeCFReferenceFromCopyOrCreate(
          CFStringCreateWithCString(
-            kCFAllocatorDefault,
+            allocator,
             "",
             kCFStringEncodingUTF8))),
       m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
    { }
 
-   inline String(const char* s, CFStringEncoding encoding = kCFStringEncodingUTF8) :
+   inline String(const char* s, CFStringEncoding encoding = kCFStringEncodingUTF8,
+      CFAllocatorRef allocator = kCFAllocatorDefault) :
       Base(makeCFReferenceFromCopyOrCreate(
          CFStringCreateWithCString(
-            kCFAllocatorDefault,
+            allocator,
             s,
             encoding))),
       m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
    { }
 
+   inline String(const std::string& s, CFStringEncoding encoding = kCFStringEncodingUTF8,
+      CFAllocatorRef allocator = kCFAllocatorDefault) :
+      Base(makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithBytes(
+            allocator,
+            reinterpret_cast<const UInt8*>(s.data()),
+            static_cast<CFIndex>(s.size()),
+            encoding,
+            false))),
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+   { }
+
+   // Construct by taking over the std::string's buffer rather than copying it. CF keeps
+   // the bytes as-is when it can store them directly (ASCII, essentially); otherwise it
+   // converts them and the buffer is freed immediately. Small strings are just copied,
+   // since adopting costs a couple of allocations of its own.
+   inline String(std::string&& s, CFStringEncoding encoding = kCFStringEncodingUTF8,
+      CFAllocatorRef allocator = kCFAllocatorDefault) :
+      Base(createAdopting(std::move(s), encoding, allocator)),
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+   { }
+
+   // A String made from 'length' bytes in the given encoding; no NUL terminator required,
+   // and any NULs in the bytes are kept. (A named function rather than a constructor,
+   // which would be ambiguous with String(const char*, CFStringEncoding) for most types of
+   // 'length'.)
+   inline static String from_bytes(const char* bytes, size_t length,
+      CFStringEncoding encoding = kCFStringEncodingUTF8, CFAllocatorRef allocator = kCFAllocatorDefault)
+   {
+      return String(makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithBytes(
+            allocator,
+            reinterpret_cast<const UInt8*>(bytes),
+            static_cast<CFIndex>(length),
+            encoding,
+            false)));
+   }
+
+   // Construct a String that refers directly to 'bytes' without copying or ever freeing
+   // them. The caller has to guarantee that the bytes outlive the String, and every copy
+   // of it; this is meant for static and otherwise long-lived buffers.
+   inline static String with_bytes_no_copy(const char* bytes, size_type length,
+      CFStringEncoding encoding = kCFStringEncodingUTF8, CFAllocatorRef allocator = kCFAllocatorDefault)
+   {
+      return String(makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithBytesNoCopy(
+            allocator,
+            reinterpret_cast<const UInt8*>(bytes),
+            length,
+            encoding,
+            false,
+            kCFAllocatorNull)));
+   }
+
+   // Wrap an existing CFStringRef (from CFSTR, or from some other CF API), retaining it.
+   inline explicit String(CFStringRef ref) :
+      Base(CFReference<CFStringRef>(ref)),
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+   { }
+
    inline String(const String& other) :
       // Strings are immutable, so we can share references.
       Base(other.m_ref),
-      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get())),
+      m_hash(other.m_hash.load(std::memory_order_relaxed)),
+      m_hashCacheable(other.m_hashCacheable)
    { }
 
    inline String(String&& other) :
       Base(std::move(other.m_ref)),
-      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get())),
+      m_hash(other.m_hash.load(std::memory_order_relaxed)),
+      m_hashCacheable(other.m_hashCacheable)
    { }
 
+   inline String& operator=(const String& other)
+   {
+      m_ref = other.m_ref;
+      m_stringAccessor.reset(getRef());
+      m_hash.store(other.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      m_hashCacheable = other.m_hashCacheable;
+      return *this;
+   }
+
+   inline String& operator=(String&& other)
+   {
+      if (&other != this)
+      {
+         m_ref = std::move(other.m_ref);
+         m_stringAccessor.reset(getRef());
+         m_hash.store(other.m_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+         m_hashCacheable = other.m_hashCacheable;
+      }
+      return *this;
+   }
+
    inline const_iterator begin() const noexcept
    {
       return const_iterator(this, 0);
@@ -356,13 +494,67 @@ public:
       return CFStringGetLength(getRef()) == 0;
    }
 
+   // Walk the string as a series of contiguous runs of characters, calling
+   // 'function(const UniChar* characters, CFIndex count)' for each one. This is much
+   // cheaper than going through const_iterator for anything that scans the whole string,
+   // since the loop over each run is a plain loop over memory.
+   //
+   // If CoreFoundation can hand out a pointer to the string's storage, the whole string
+   // is passed in a single call. Otherwise, the characters are copied out in blocks of
+   // 'bufferSize' into 'buffer'. Either way, the pointer is only valid for the duration
+   // of the call.
+   //
+   // 'function' may return void, or something convertible to bool; returning false stops
+   // the walk early. Returns false if the walk was stopped early, true otherwise. Throws
+   // std::invalid_argument if 'bufferSize' isn't positive.
+   template<typename Function>
+   inline bool for_each_chunk(UniChar* buffer, size_type bufferSize, Function function) const
+   {
+      if (bufferSize <= 0)
+         throw std::invalid_argument("String::for_each_chunk");
+
+      const CFIndex length = CFStringGetLength(getRef());
+      if (length == 0)
+         return true;
+
+      const UniChar* directPtr = CFStringGetCharactersPtr(getRef());
+      if (directPtr)
+         return invokeChunkFunction(function, directPtr, length);
+
+      for (CFIndex position = 0; position < length; position += bufferSize)
+      {
+         const CFIndex count = std::min<CFIndex>(bufferSize, length - position);
+         CFStringGetCharacters(getRef(), CFRangeMake(position, count), buffer);
+         if (!invokeChunkFunction(function, static_cast<const UniChar*>(buffer), count))
+            return false;
+      }
+      return true;
+   }
+
+   // As above, using a kDefaultChunkSize buffer on the stack.
+   template<typename Function>
+   inline bool for_each_chunk(Function function) const
+   {
+      UniChar buffer[kDefaultChunkSize];
+      return for_each_chunk(buffer, kDefaultChunkSize, function);
+   }
+
    inline std::string to_string(CFStringEncoding encoding = kCFStringEncodingUTF8) const
    {
       // First, try the fast approach.
+      // CF only hands out a C string pointer for single-byte encodings, so the length in
+      // bytes is the length in characters; going by that rather than the terminator keeps
+      // any embedded NULs.
       const char* strPtr = CFStringGetCStringPtr(getRef(), encoding);
       if (strPtr)
       {
-         return std::string(strPtr);
+         return std::string(strPtr, static_cast<size_t>(CFStringGetLength(getRef())));
+      }
+      else if (encoding == kCFStringEncodingUTF8)
+      {
+         // UTF-8 is by far the common case, so transcode it ourselves in one pass over the
+         // characters rather than asking CF to size and then fill the buffer.
+         return toUtf8String();
       }
       else
       {
@@ -402,6 +594,196 @@ public:
       }
    }
 
+   // Compare the same way CFStringCompare(*this, other, options) does. Literal and
+   // ASCII case-insensitive comparisons between strings whose characters CF can hand out
+   // directly are done here, over the raw buffers; everything else is left to CF.
+   inline CFComparisonResult compare(const String& other, CFStringCompareFlags options = 0) const noexcept
+   {
+      if (getRef() == other.getRef())
+         return kCFCompareEqualTo;
+
+      CFComparisonResult result;
+      if ((options & ~kCFCompareCaseInsensitive) == 0 && compareDirect(other, options, result))
+         return result;
+      return CFStringCompare(getRef(), other.getRef(), options);
+   }
+
+   // Where 's' first occurs at or after 'from', or npos. Without 'options' the search is
+   // literal, as CFStringFind()'s is, and is done here over the raw characters when CF
+   // can hand out the string's (and the pattern is short enough to copy out if it can't
+   // hand out the pattern's). Anything else is left to CFStringFindWithOptions(). An
+   // empty 's' is found at 'from', as with std::string.
+   inline size_type find(const String& s, size_type from = 0, CFStringCompareFlags options = 0) const noexcept
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      const CFIndex patternLength = s.length();
+      from = std::max<size_type>(from, 0);
+      if (from > length || (options == 0 && patternLength > length - from))
+         return npos;
+      if (patternLength == 0)
+         return from;
+
+      size_type result;
+      if (options == 0 && findDirect(s, from, length - from, false, result))
+         return result;
+
+      CFRange found;
+      return CFStringFindWithOptions(getRef(), s.getRef(), CFRangeMake(from, length - from), options, &found) ?
+         found.location : static_cast<size_type>(npos);
+   }
+
+   // Where 's' last occurs starting at or before 'from' (by default, anywhere), or npos.
+   inline size_type rfind(const String& s, size_type from = npos, CFStringCompareFlags options = 0) const noexcept
+   {
+      if (options != 0)
+         return rfindWithOptions(s, from, options);
+
+      const CFIndex length = CFStringGetLength(getRef());
+      const CFIndex patternLength = s.length();
+      if (patternLength > length)
+         return npos;
+      const CFIndex lastStart = length - patternLength;
+      const CFIndex start = (from < 0 || from > lastStart) ? lastStart : from;
+      if (patternLength == 0)
+         return start;
+
+      size_type result;
+      if (findDirect(s, 0, start + patternLength, true, result))
+         return result;
+
+      CFRange found;
+      return CFStringFindWithOptions(getRef(), s.getRef(), CFRangeMake(0, start + patternLength),
+         kCFCompareBackwards, &found) ? found.location : static_cast<size_type>(npos);
+   }
+
+   // The same, for a single character. If CF won't hand out the characters, they're
+   // copied out and searched a kDefaultChunkSize block at a time.
+   inline size_type find(UniChar c, size_type from = 0) const noexcept
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      from = std::max<size_type>(from, 0);
+      if (from >= length)
+         return npos;
+
+      const DirectContents contents = directContents();
+      if (contents.m_wide)
+      {
+         const UniChar* found = Detail::findCharacter(contents.m_wide + from, length - from, c);
+         return found ? found - contents.m_wide : static_cast<size_type>(npos);
+      }
+      if (contents.m_narrow)
+      {
+         const UInt8* found = c < 0x80 ?
+            Detail::findByte(contents.m_narrow + from, length - from, static_cast<UInt8>(c)) : nullptr;
+         return found ? found - contents.m_narrow : static_cast<size_type>(npos);
+      }
+
+      UniChar buffer[kDefaultChunkSize];
+      for (CFIndex position = from; position < length; position += kDefaultChunkSize)
+      {
+         const CFIndex count = std::min<CFIndex>(kDefaultChunkSize, length - position);
+         CFStringGetCharacters(getRef(), CFRangeMake(position, count), buffer);
+         if (const UniChar* found = Detail::findCharacter(buffer, count, c))
+            return position + (found - buffer);
+      }
+      return npos;
+   }
+
+   inline size_type rfind(UniChar c, size_type from = npos) const noexcept
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      const CFIndex end = (from < 0 || from >= length) ? length : from + 1;
+
+      const DirectContents contents = directContents();
+      if (contents.m_wide)
+      {
+         const UniChar* found = Detail::findLastCharacter(contents.m_wide, end, c);
+         return found ? found - contents.m_wide : static_cast<size_type>(npos);
+      }
+      if (contents.m_narrow)
+      {
+         const UInt8* found = c < 0x80 ?
+            Detail::findLastByte(contents.m_narrow, end, static_cast<UInt8>(c)) : nullptr;
+         return found ? found - contents.m_narrow : static_cast<size_type>(npos);
+      }
+
+      UniChar buffer[kDefaultChunkSize];
+      for (CFIndex position = end; position > 0; )
+      {
+         const CFIndex count = std::min<CFIndex>(kDefaultChunkSize, position);
+         position -= count;
+         CFStringGetCharacters(getRef(), CFRangeMake(position, count), buffer);
+         if (const UniChar* found = Detail::findLastCharacter(buffer, count, c))
+            return position + (found - buffer);
+      }
+      return npos;
+   }
+
+   inline bool contains(const String& s, CFStringCompareFlags options = 0) const noexcept
+   {
+      return find(s, 0, options) != npos;
+   }
+
+   inline bool contains(UniChar c) const noexcept
+   {
+      return find(c) != npos;
+   }
+
+   // Whether the string begins (or ends) with 's', compared literally. Every string
+   // starts and ends with the empty string.
+   inline bool starts_with(const String& s) const noexcept
+   {
+      return hasAffix(s, false);
+   }
+
+   inline bool ends_with(const String& s) const noexcept
+   {
+      return hasAffix(s, true);
+   }
+
+   // The 'count' characters starting at 'pos' (or all of them from 'pos' on, if there
+   // aren't that many), made with CFStringCreateWithSubstring() so that CF can share the
+   // storage rather than copy it where it's able to. Throws std::out_of_range if 'pos' is
+   // past the end.
+   inline String substr(size_type pos, size_type count = npos, CFAllocatorRef allocator = kCFAllocatorDefault) const
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      if (pos < 0 || pos > length)
+         throw std::out_of_range("String");
+      if (count < 0 || count > length - pos)
+         count = length - pos;
+      return String(makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithSubstring(allocator, getRef(), CFRangeMake(pos, count))));
+   }
+
+   // Lazily splits the string into the fields between each occurrence of 'delimiter' (n
+   // of them always make n + 1 fields, some of which may be empty), or into the non-empty
+   // runs of characters for which 'isDelimiter' returns false. The fields are StringViews
+   // of this string, so nothing is copied or allocated for each one. Defined in
+   // cfxx_split.h.
+   inline StringSplit split(const String& delimiter) const;
+
+   template<typename Predicate>
+   inline StringTokens<Predicate> tokenize(Predicate isDelimiter) const;
+
+   // CFHash() of the string, so equal Strings hash equal no matter how they were made.
+   // Remembered after the first call, except for MutableString (and Strings copied from
+   // one, which share its CFString), whose characters can change through the
+   // CFMutableStringRef without the wrapper noticing.
+   inline CFHashCode hash() const noexcept
+   {
+      if (!m_hashCacheable)
+         return CFHash(getRef());
+
+      CFHashCode hash = m_hash.load(std::memory_order_relaxed);
+      if (hash == 0)
+      {
+         hash = CFHash(getRef());
+         m_hash.store(hash, std::memory_order_relaxed);
+      }
+      return hash;
+   }
+
    inline operator CFStringRef() const noexcept
    {
       return getRef();
@@ -412,104 +794,475 @@ public:
       return CFStringGetTypeID();
    }
 
+   // A non-owning view of the underlying CFStringRef, valid for as long as this String is.
+   inline CFBorrowed<CFStringRef> borrow() const noexcept
+   {
+      return CFBorrowed<CFStringRef>(getRef());
+   }
+
 protected:
    inline String(const CFReference<CFStringRef>& ref) :
       Base(ref),
       m_stringAccessor(ref.get())
    { }
 
+   inline String(CFReference<CFStringRef>&& ref) noexcept :
+      Base(std::move(ref)),
+      m_stringAccessor(reinterpret_cast<CFStringRef>(m_ref.get()))
+   { }
+
+   // Derived classes that mutate the string need to call this afterwards.
+   inline void invalidateCaches() noexcept
+   {
+      m_stringAccessor.invalidate();
+      m_hash.store(0, std::memory_order_relaxed);
+   }
+
+   // Called by MutableString's constructors.
+   inline void disableHashCache() noexcept
+   {
+      m_hashCacheable = false;
+      m_hash.store(0, std::memory_order_relaxed);
+   }
+
 private:
    inline CFStringRef getRef() const noexcept
    {
       return reinterpret_cast<CFStringRef>(m_ref.get());
    }
 
+   // Below this, copying the bytes is cheaper than setting up a deallocator for them.
+   enum { kAdoptThreshold = 1024 };
+
+   static inline CFReference<CFStringRef> createAdopting(std::string&& s, CFStringEncoding encoding,
+      CFAllocatorRef allocator)
+   {
+      if (s.size() < kAdoptThreshold)
+      {
+         return makeCFReferenceFromCopyOrCreate(
+            CFStringCreateWithBytes(
+               allocator,
+               reinterpret_cast<const UInt8*>(s.data()),
+               static_cast<CFIndex>(s.size()),
+               encoding,
+               false));
+      }
+
+      std::string* owner = new std::string(std::move(s));
+      const CFReference<CFAllocatorRef> deallocator = makeOwningDeallocator(owner);
+      return makeCFReferenceFromCopyOrCreate(
+         CFStringCreateWithBytesNoCopy(
+            allocator,
+            reinterpret_cast<const UInt8*>(owner->data()),
+            static_cast<CFIndex>(owner->size()),
+            encoding,
+            false,
+            deallocator.get()));
+   }
+
+   // Where CF keeps the characters of a string, if it's willing to say.
+   struct DirectContents
+   {
+      const UniChar* m_wide;
+      const UInt8*   m_narrow; // ASCII only
+      CFIndex        m_length;
+   };
+
+   inline DirectContents directContents() const noexcept
+   {
+      DirectContents contents;
+      contents.m_length = CFStringGetLength(getRef());
+      contents.m_wide = CFStringGetCharactersPtr(getRef());
+      contents.m_narrow = contents.m_wide ? nullptr :
+         reinterpret_cast<const UInt8*>(CFStringGetCStringPtr(getRef(), kCFStringEncodingASCII));
+      return contents;
+   }
+
+   static inline UniChar characterAt(const DirectContents& contents, size_t index) noexcept
+   {
+      return contents.m_wide ? contents.m_wide[index] : contents.m_narrow[index];
+   }
+
+   static inline UInt8 foldAscii(UInt8 c) noexcept
+   {
+      return (c >= 'A' && c <= 'Z') ? static_cast<UInt8>(c + ('a' - 'A')) : c;
+   }
+
+   // Returns false if the comparison can't be done without CF's help.
+   inline bool compareDirect(const String& other, CFStringCompareFlags options,
+      CFComparisonResult& result) const noexcept
+   {
+      const DirectContents a = directContents();
+      const DirectContents b = other.directContents();
+      if (!(a.m_wide || a.m_narrow) || !(b.m_wide || b.m_narrow))
+         return false;
+
+      const size_t common = static_cast<size_t>(std::min(a.m_length, b.m_length));
+      size_t i;
+      if (options & kCFCompareCaseInsensitive)
+      {
+         // Folding anything beyond ASCII is CF's business.
+         if (!a.m_narrow || !b.m_narrow)
+            return false;
+         for (i = 0; i < common && foldAscii(a.m_narrow[i]) == foldAscii(b.m_narrow[i]); ++i)
+            ;
+         if (i < common)
+         {
+            result = foldAscii(a.m_narrow[i]) < foldAscii(b.m_narrow[i]) ? kCFCompareLessThan : kCFCompareGreaterThan;
+            return true;
+         }
+      }
+      else
+      {
+         if (a.m_wide && b.m_wide)
+            i = find_mismatch(a.m_wide, b.m_wide, common);
+         else if (a.m_narrow && b.m_narrow)
+            i = find_mismatch(a.m_narrow, b.m_narrow, common);
+         else if (a.m_narrow)
+            i = find_mismatch(a.m_narrow, b.m_wide, common);
+         else
+            i = find_mismatch(b.m_narrow, a.m_wide, common);
+
+         if (i < common)
+         {
+            result = characterAt(a, i) < characterAt(b, i) ? kCFCompareLessThan : kCFCompareGreaterThan;
+            return true;
+         }
+      }
+
+      if (a.m_length == b.m_length)
+         result = kCFCompareEqualTo;
+      else
+         result = a.m_length < b.m_length ? kCFCompareLessThan : kCFCompareGreaterThan;
+      return true;
+   }
+
+   // Patterns up to this long are copied out to search with if CF won't hand them out.
+   enum { kDirectPatternMax = 256 };
+
+   // A literal search for 'pattern' (which isn't empty) in the 'count' characters from
+   // 'from' on, for the first match or the last one. Returns false if it can't be done
+   // without CF's help.
+   inline bool findDirect(const String& pattern, CFIndex from, CFIndex count, bool backwards,
+      size_type& result) const noexcept
+   {
+      const DirectContents contents = directContents();
+      if (!(contents.m_wide || contents.m_narrow))
+         return false;
+
+      const DirectContents patternContents = pattern.directContents();
+      const size_t m = static_cast<size_t>(patternContents.m_length);
+      UniChar wideCopy[kDirectPatternMax];
+      const UniChar* wide = patternContents.m_wide;
+      if (!wide && !(contents.m_narrow && patternContents.m_narrow))
+      {
+         if (m > kDirectPatternMax)
+            return false;
+         CFStringGetCharacters(pattern.getRef(), CFRangeMake(0, patternContents.m_length), wideCopy);
+         wide = wideCopy;
+      }
+
+      if (contents.m_wide)
+      {
+         const UniChar* start = contents.m_wide + from;
+         const UniChar* found;
+         if (m == 1)
+            found = backwards ? Detail::findLastCharacter(start, count, wide[0]) : Detail::findCharacter(start, count, wide[0]);
+         else
+            found = backwards ? Detail::findLastCharacters(start, count, wide, m) : Detail::findCharacters(start, count, wide, m);
+         result = found ? found - contents.m_wide : static_cast<size_type>(npos);
+         return true;
+      }
+
+      // The string is ASCII, so a pattern that isn't can't be in it.
+      UInt8 narrowCopy[kDirectPatternMax];
+      const UInt8* narrow = patternContents.m_narrow;
+      if (!narrow)
+      {
+         if (m > kDirectPatternMax)
+            return false;
+         for (size_t i = 0; i < m; ++i)
+         {
+            if (wide[i] >= 0x80)
+            {
+               result = npos;
+               return true;
+            }
+            narrowCopy[i] = static_cast<UInt8>(wide[i]);
+         }
+         narrow = narrowCopy;
+      }
+
+      const UInt8* start = contents.m_narrow + from;
+      const UInt8* found;
+      if (m == 1)
+         found = backwards ? Detail::findLastByte(start, count, narrow[0]) : Detail::findByte(start, count, narrow[0]);
+      else
+         found = backwards ? Detail::findLastPattern(start, count, narrow, m) : Detail::findPattern(start, count, narrow, m);
+      result = found ? found - contents.m_narrow : static_cast<size_type>(npos);
+      return true;
+   }
+
+   // rfind() with compare options. A match can then be longer or shorter than 's' (with
+   // kCFCompareNonliteral, say), so neither the string's length nor the end of the range
+   // to search can be worked out from the pattern's. Instead, search the whole string
+   // backwards, and step back past any match that starts after 'from'.
+   inline size_type rfindWithOptions(const String& s, size_type from, CFStringCompareFlags options) const noexcept
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      const CFIndex start = (from < 0 || from > length) ? length : from;
+      if (s.length() == 0)
+         return start;
+
+      CFIndex end = length;
+      CFRange found;
+      while (end > 0 && CFStringFindWithOptions(getRef(), s.getRef(), CFRangeMake(0, end),
+         options | kCFCompareBackwards, &found))
+      {
+         if (found.location <= start)
+            return found.location;
+         end = found.location + found.length - 1;
+      }
+      return npos;
+   }
+
+   // starts_with() and ends_with().
+   inline bool hasAffix(const String& s, bool suffix) const noexcept
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      const CFIndex n = s.length();
+      if (n > length)
+         return false;
+      if (n == 0)
+         return true;
+
+      const DirectContents a = directContents();
+      const DirectContents b = s.directContents();
+      if (!(a.m_wide || a.m_narrow) || !(b.m_wide || b.m_narrow))
+         return suffix ? CFStringHasSuffix(getRef(), s.getRef()) : CFStringHasPrefix(getRef(), s.getRef());
+
+      const size_t offset = static_cast<size_t>(suffix ? length - n : 0);
+      const size_t count = static_cast<size_t>(n);
+      if (a.m_wide && b.m_wide)
+         return find_mismatch(a.m_wide + offset, b.m_wide, count) == count;
+      if (a.m_narrow && b.m_narrow)
+         return find_mismatch(a.m_narrow + offset, b.m_narrow, count) == count;
+      if (a.m_narrow)
+         return find_mismatch(a.m_narrow + offset, b.m_wide, count) == count;
+      return find_mismatch(b.m_narrow, a.m_wide + offset, count) == count;
+   }
+
+   inline std::string toUtf8String() const
+   {
+      const CFIndex length = CFStringGetLength(getRef());
+      if (length == 0)
+         return std::string();
+
+      // Transcode into scratch space that doesn't need zero-filling first; short strings
+      // fit on the stack.
+      char stackBuffer[1024];
+      std::unique_ptr<char[]> heapBuffer;
+      char* buffer = stackBuffer;
+
+      const size_t maxSize = Utf16ToUtf8Converter::max_output_size(length);
+      if (maxSize > sizeof(stackBuffer))
+      {
+         heapBuffer.reset(new char[maxSize]);
+         buffer = heapBuffer.get();
+      }
+
+      Utf16ToUtf8Converter converter;
+      size_t written = 0;
+      for_each_chunk([&](const UniChar* characters, CFIndex count) {
+         written += converter.convert(characters, count, buffer + written);
+      });
+      written += converter.finish(buffer + written);
+
+      return std::string(buffer, written);
+   }
+
+   // for_each_chunk callbacks can return void (never stop) or bool (stop on false).
+   template<typename Function>
+   static inline typename std::enable_if<
+      std::is_void<typename std::result_of<Function&(const UniChar*, CFIndex)>::type>::value,
+      bool
+   >::type invokeChunkFunction(Function& function, const UniChar* characters, CFIndex count)
+   {
+      function(characters, count);
+      return true;
+   }
+
+   template<typename Function>
+   static inline typename std::enable_if<
+      !std::is_void<typename std::result_of<Function&(const UniChar*, CFIndex)>::type>::value,
+      bool
+   >::type invokeChunkFunction(Function& function, const UniChar* characters, CFIndex count)
+   {
+      return static_cast<bool>(function(characters, count));
+   }
+
    BufferingStringAccessor m_stringAccessor;
-   
+
+   // CFHash() of the string, or 0 if it hasn't been asked for yet (or happens to be 0).
+   mutable std::atomic<CFHashCode> m_hash { 0 };
+   // False for MutableString, and for Strings sharing a MutableString's CFString.
+   bool m_hashCacheable = true;
 };
 
 
-inline bool operator<(const String& a, const String& b) noexcept
+// Two Strings sharing a CFStringRef (copies of each other, or interned; see
+// cfxx_intern.h) compare equal without looking at any characters, and strings of
+// different lengths can never be literally equal. The rest is String::compare().
+inline bool operator==(const String& a, const String& b) noexcept
 {
-   return CFStringCompare(a, b, 0) == kCFCompareLessThan;
+   if (static_cast<CFStringRef>(a) == static_cast<CFStringRef>(b))
+      return true;
+   if (a.size() != b.size())
+      return false;
+   return a.compare(b) == kCFCompareEqualTo;
 }
 
-inline bool operator>(const String& a, const String& b) noexcept
+inline bool operator!=(const String& a, const String& b) noexcept
 {
-   return CFStringCompare(a, b, 0) == kCFCompareGreaterThan;
+   return !(a == b);
 }
 
-inline bool operator==(const String& a, const String& b) noexcept
+inline bool operator<(const String& a, const String& b) noexcept
 {
-   return CFStringCompare(a, b, 0) == kCFCompareEqualTo;
+   return a.compare(b) == kCFCompareLessThan;
+}
+
+inline bool operator>(const String& a, const String& b) noexcept
+{
+   return a.compare(b) == kCFCompareGreaterThan;
 }
 
 inline bool operator<=(const String& a, const String& b) noexcept
 {
-   const auto r = CFStringCompare(a, b, 0);
-   return (r == kCFCompareLessThan || r == kCFCompareEqualTo);
+   return a.compare(b) != kCFCompareGreaterThan;
 }
 
 inline bool operator>=(const String& a, const String& b) noexcept
 {
-   const auto r = CFStringCompare(a, b, 0);
-   return (r == kCFCompareGreaterThan || r == kCFCompareEqualTo);
+   return a.compare(b) != kCFCompareLessThan;
 }
 
-inline bool operator!=(const String& a, const String& b) noexcept
+// Function objects for sorting and looking up Strings with particular compare options,
+// e.g. std::sort(v.begin(), v.end(), StringLess(kCFCompareCaseInsensitive)).
+class StringLess
 {
-   return CFStringCompare(a, b, 0) != kCFCompareEqualTo;
-}
+public:
+   inline explicit StringLess(CFStringCompareFlags options = 0) noexcept :
+      m_options(options)
+   { }
+
+   inline bool operator()(const String& a, const String& b) const noexcept
+   {
+      return a.compare(b, m_options) == kCFCompareLessThan;
+   }
+
+private:
+   CFStringCompareFlags m_options;
+};
+
+class StringEqualTo
+{
+public:
+   inline explicit StringEqualTo(CFStringCompareFlags options = 0) noexcept :
+      m_options(options)
+   { }
+
+   inline bool operator()(const String& a, const String& b) const noexcept
+   {
+      if (m_options == 0)
+         return a == b;
+      return a.compare(b, m_options) == kCFCompareEqualTo;
+   }
+
+private:
+   CFStringCompareFlags m_options;
+};
 
 class MutableString : public String
 {
 public:
    inline MutableString() :
+      MutableString(kCFAllocatorDefault)
+   { }
+
+   inline explicit MutableString(CFAllocatorRef allocator) :
       String(makeCFReferenceFromCopyOrCreate(
          CFStringCreateMutable(
-            kCFAllocatorDefault, 0)))
-   { }
+            allocator, 0)))
+   {
+      disableHashCache();
+   }
 
    // This one is kind of annoying, there isn't a CFStringCreateMutableWithCString,
    // so we have to compose it ourselves.
-   inline MutableString(const char* s, CFStringEncoding encoding = kCFStringEncodingUTF8) :
+   inline MutableString(const char* s, CFStringEncoding encoding = kCFStringEncodingUTF8,
+      CFAllocatorRef allocator = kCFAllocatorDefault) :
       String(
          makeCFReferenceFromCopyOrCreate(
             CFStringCreateMutableCopy(
-               kCFAllocatorDefault,
+               allocator,
                0,
                makeCFReferenceFromCopyOrCreate(
                   CFStringCreateWithCString(
-                     kCFAllocatorDefault,
+                     allocator,
                      s,
                      encoding)).get())))
-   { }
+   {
+      disableHashCache();
+   }
 
-   inline MutableString(const String& other) noexcept :
+   inline MutableString(const String& other, CFAllocatorRef allocator = kCFAllocatorDefault) noexcept :
       String(makeCFReferenceFromCopyOrCreate(
          CFStringCreateMutableCopy(
-            kCFAllocatorDefault, 0, other)))
-   { }
+            allocator, 0, other)))
+   {
+      disableHashCache();
+   }
 
    inline MutableString(MutableString&& other) noexcept :
       String(std::move(other.m_ref))
-   { }
+   {
+      disableHashCache();
+   }
+
+   inline MutableString& operator=(MutableString&& other) noexcept
+   {
+      String::operator=(std::move(other));
+      disableHashCache();
+      return *this;
+   }
 
    inline MutableString& append(const String& str) noexcept
    {
       CFStringAppend(getRef(), str);
+      invalidateCaches();
+      return *this;
+   }
+
+   // Append a CFString we don't own, without wrapping (and so retaining) it first.
+   inline MutableString& append(CFBorrowed<CFStringRef> str) noexcept
+   {
+      CFStringAppend(getRef(), str);
+      invalidateCaches();
       return *this;
    }
 
    inline MutableString& append(const UniChar* str, size_t n) noexcept
    {
       CFStringAppendCharacters(getRef(), str, n);
+      invalidateCaches();
       return *this;
    }
 
    inline MutableString& append(const char* str, CFStringEncoding encoding = kCFStringEncodingUTF8) noexcept
    {
       CFStringAppendCString(getRef(), str, encoding);
+      invalidateCaches();
       return *this;
    }
    
@@ -525,6 +1278,68 @@ private:
    }
 };
 
+// A String constant for a string literal, created once and then shared for the rest of
+// the process, so using it costs at most a retain:
+//
+//    CFDictionaryGetValue(dict, CFXX_STR("key"));
+//
+// This goes through CFSTR, which on Apple platforms is laid out by the compiler and
+// involves no allocation at all.
+#define CFXX_STR(literal) \
+   ([]() -> const ::CoreFoundation::String& { \
+      static const ::CoreFoundation::String s_constant(CFSTR(literal)); \
+      return s_constant; \
+   }())
+
+// The same, as a user-defined literal:
+//
+//    using namespace CoreFoundation::Literals;
+//    CFDictionaryGetValue(dict, "key"_cfs);
+//
+// Each distinct literal gets its own String, made on first use from the characters
+// stored in the binary (without copying them, for ASCII). This relies on the string
+// literal operator template extension, which clang accepts in any mode and GCC from
+// C++14 on.
+#if defined(__clang__) || (defined(__GNUC__) && __cplusplus >= 201402L)
+#define CFXX_HAS_STRING_LITERAL_OPERATOR 1
+
+template<typename CharT, CharT... Chars>
+struct StringLiteralStorage
+{
+   static_assert(sizeof(CharT) == 1, "_cfs literals must be narrow (UTF-8) string literals");
+
+   static constexpr char s_bytes[] = { static_cast<char>(Chars)..., '\0' };
+
+   static inline const String& get()
+   {
+      static const String s_constant = String::with_bytes_no_copy(s_bytes, sizeof...(Chars));
+      return s_constant;
+   }
+};
+
+template<typename CharT, CharT... Chars>
+constexpr char StringLiteralStorage<CharT, Chars...>::s_bytes[];
+
+namespace Literals
+{
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#if defined(__clang__)
+#pragma clang diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+
+template<typename CharT, CharT... Chars>
+inline const String& operator"" _cfs()
+{
+   return StringLiteralStorage<CharT, Chars...>::get();
+}
+
+#pragma GCC diagnostic pop
+
+} // namespace Literals
+#endif
+
 } // namespace CoreFoundation
 
 #endif // __cfxx_string_h__
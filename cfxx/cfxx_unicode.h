@@ -0,0 +1,636 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __cfxx_unicode_h__
+#define __cfxx_unicode_h__
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Vector kernels are used when the compiler is targeting an instruction set that has
+// them. Define CFXX_NO_SIMD to force the scalar code paths everywhere.
+#if !defined(CFXX_NO_SIMD)
+   #if defined(__AVX2__)
+      #define CFXX_HAS_AVX2 1
+      #include <immintrin.h>
+   #endif
+   #if defined(__SSE2__)
+      #define CFXX_HAS_SSE2 1
+      #include <emmintrin.h>
+   #endif
+   #if defined(__ARM_NEON) && defined(__aarch64__)
+      #define CFXX_HAS_NEON 1
+      #include <arm_neon.h>
+   #endif
+#endif
+
+namespace CoreFoundation
+{
+
+// Converts UTF-16 to UTF-8 in a single pass, with a vectorized path for runs of ASCII.
+//
+// Input can be fed in pieces (as String::for_each_chunk hands it out); a high surrogate
+// at the end of one piece is held on to until the next one. Unpaired surrogates are
+// replaced with U+FFFD.
+class Utf16ToUtf8Converter
+{
+public:
+   inline Utf16ToUtf8Converter() noexcept :
+      m_pendingHighSurrogate(0)
+   { }
+
+   // The most bytes that convert() can write for 'count' characters, plus what finish()
+   // might add. Every UTF-16 code unit becomes at most three bytes of UTF-8.
+   static inline size_t max_output_size(size_t count) noexcept
+   {
+      return 3 * count + 3;
+   }
+
+   // Convert 'count' characters into 'out', which must have room for
+   // max_output_size(count) bytes. Returns the number of bytes written.
+   inline size_t convert(const UniChar* in, size_t count, char* out) noexcept
+   {
+      UInt8* const begin = reinterpret_cast<UInt8*>(out);
+      UInt8* o = begin;
+      size_t i = 0;
+
+      if (m_pendingHighSurrogate)
+      {
+         if (count == 0)
+            return 0;
+
+         if (isLowSurrogate(in[0]))
+         {
+            o = writeSurrogatePair(o, m_pendingHighSurrogate, in[0]);
+            i = 1;
+         }
+         else
+         {
+            o = writeReplacementCharacter(o);
+         }
+         m_pendingHighSurrogate = 0;
+      }
+
+      while (i < count)
+      {
+         const size_t asciiCount = convertAsciiRun(in + i, count - i, o);
+         i += asciiCount;
+         o += asciiCount;
+
+         // Convert a block of non-ASCII characters the slow way before going back to
+         // looking for more ASCII, so that mostly non-ASCII text doesn't keep bouncing
+         // in and out of the vector loop.
+         const size_t blockEnd = (count - i > kScalarBlockSize) ? i + kScalarBlockSize : count;
+         while (i < blockEnd)
+         {
+            const UniChar c = in[i];
+            if (c < 0x80)
+            {
+               *o++ = static_cast<UInt8>(c);
+               ++i;
+            }
+            else if (c < 0x800)
+            {
+               *o++ = static_cast<UInt8>(0xC0 | (c >> 6));
+               *o++ = static_cast<UInt8>(0x80 | (c & 0x3F));
+               ++i;
+            }
+            else if (isHighSurrogate(c))
+            {
+               if (i + 1 == count)
+               {
+                  // Might be completed by the next piece of input.
+                  m_pendingHighSurrogate = c;
+                  ++i;
+               }
+               else if (isLowSurrogate(in[i + 1]))
+               {
+                  o = writeSurrogatePair(o, c, in[i + 1]);
+                  i += 2;
+               }
+               else
+               {
+                  o = writeReplacementCharacter(o);
+                  ++i;
+               }
+            }
+            else if (isLowSurrogate(c))
+            {
+               o = writeReplacementCharacter(o);
+               ++i;
+            }
+            else
+            {
+               *o++ = static_cast<UInt8>(0xE0 | (c >> 12));
+               *o++ = static_cast<UInt8>(0x80 | ((c >> 6) & 0x3F));
+               *o++ = static_cast<UInt8>(0x80 | (c & 0x3F));
+               ++i;
+            }
+         }
+      }
+
+      return static_cast<size_t>(o - begin);
+   }
+
+   // Flush anything held over from the last convert(); returns the number of bytes written.
+   inline size_t finish(char* out) noexcept
+   {
+      if (!m_pendingHighSurrogate)
+         return 0;
+
+      m_pendingHighSurrogate = 0;
+      UInt8* const begin = reinterpret_cast<UInt8*>(out);
+      return static_cast<size_t>(writeReplacementCharacter(begin) - begin);
+   }
+
+private:
+   enum { kScalarBlockSize = 16 };
+
+   static inline bool isHighSurrogate(UniChar c) noexcept
+   {
+      return (c & 0xFC00) == 0xD800;
+   }
+
+   static inline bool isLowSurrogate(UniChar c) noexcept
+   {
+      return (c & 0xFC00) == 0xDC00;
+   }
+
+   static inline UInt8* writeSurrogatePair(UInt8* o, UniChar high, UniChar low) noexcept
+   {
+      const UInt32 c = 0x10000 + ((static_cast<UInt32>(high) - 0xD800) << 10) + (low - 0xDC00);
+      *o++ = static_cast<UInt8>(0xF0 | (c >> 18));
+      *o++ = static_cast<UInt8>(0x80 | ((c >> 12) & 0x3F));
+      *o++ = static_cast<UInt8>(0x80 | ((c >> 6) & 0x3F));
+      *o++ = static_cast<UInt8>(0x80 | (c & 0x3F));
+      return o;
+   }
+
+   static inline UInt8* writeReplacementCharacter(UInt8* o) noexcept
+   {
+      *o++ = 0xEF;
+      *o++ = 0xBF;
+      *o++ = 0xBD;
+      return o;
+   }
+
+   // Copy the leading run of ASCII characters (narrowed to bytes) into 'out', returning
+   // how many there were. The vector loops stop at the first block containing anything
+   // non-ASCII and leave the rest of that block to the scalar tail.
+   static inline size_t convertAsciiRun(const UniChar* in, size_t count, UInt8* out) noexcept
+   {
+      size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+      const __m256i nonAsciiMask256 = _mm256_set1_epi16(static_cast<short>(0xFF80));
+      for (; i + 16 <= count; i += 16)
+      {
+         const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+         if (!_mm256_testz_si256(v, nonAsciiMask256))
+            break;
+         // packus works within 128-bit lanes, so gather the two packed halves back together.
+         const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+      }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+      const __m128i nonAsciiMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+      const __m128i zero = _mm_setzero_si128();
+      for (; i + 16 <= count; i += 16)
+      {
+         const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+         const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+         const __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAsciiMask);
+         if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+            break;
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+      }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+      for (; i + 16 <= count; i += 16)
+      {
+         const uint16x8_t a = vld1q_u16(in + i);
+         const uint16x8_t b = vld1q_u16(in + i + 8);
+         if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+            break;
+         vst1q_u8(out + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+      }
+#endif
+
+      for (; i < count && in[i] < 0x80; ++i)
+         out[i] = static_cast<UInt8>(in[i]);
+
+      return i;
+   }
+
+   UniChar m_pendingHighSurrogate;
+};
+
+// Convert a complete UTF-16 buffer to UTF-8. 'out' must have room for
+// Utf16ToUtf8Converter::max_output_size(count) bytes. Returns the number of bytes written.
+inline size_t convert_utf16_to_utf8(const UniChar* in, size_t count, char* out) noexcept
+{
+   Utf16ToUtf8Converter converter;
+   const size_t written = converter.convert(in, count, out);
+   return written + converter.finish(out + written);
+}
+
+// The find_mismatch() functions return the index of the first position at which two runs
+// of 'count' characters differ, or 'count' if they are identical. As with the converter,
+// the vector loops only skip over blocks that match completely and leave the block with
+// the difference in it to the scalar tail.
+
+// Two runs of UTF-16 code units.
+inline size_t find_mismatch(const UniChar* a, const UniChar* b, size_t count) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   for (; i + 16 <= count; i += 16)
+   {
+      const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(x, y)) != -1)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   for (; i + 8 <= count; i += 8)
+   {
+      const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(x, y)) != 0xFFFF)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   for (; i + 8 <= count; i += 8)
+   {
+      if (vminvq_u16(vceqq_u16(vld1q_u16(a + i), vld1q_u16(b + i))) == 0)
+         break;
+   }
+#endif
+
+   for (; i < count && a[i] == b[i]; ++i)
+      ;
+   return i;
+}
+
+// Two runs of bytes.
+inline size_t find_mismatch(const UInt8* a, const UInt8* b, size_t count) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   for (; i + 32 <= count; i += 32)
+   {
+      const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   for (; i + 16 <= count; i += 16)
+   {
+      const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   for (; i + 16 <= count; i += 16)
+   {
+      if (vminvq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) == 0)
+         break;
+   }
+#endif
+
+   for (; i < count && a[i] == b[i]; ++i)
+      ;
+   return i;
+}
+
+// Bytes (in an encoding whose byte values are their code points, such as ASCII) against
+// UTF-16 code units.
+inline size_t find_mismatch(const UInt8* narrow, const UniChar* wide, size_t count) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   for (; i + 16 <= count; i += 16)
+   {
+      const __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(narrow + i)));
+      const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(wide + i));
+      if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(x, y)) != -1)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i zero = _mm_setzero_si128();
+   for (; i + 8 <= count; i += 8)
+   {
+      const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(narrow + i));
+      const __m128i x = _mm_unpacklo_epi8(bytes, zero);
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wide + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(x, y)) != 0xFFFF)
+         break;
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   for (; i + 8 <= count; i += 8)
+   {
+      const uint16x8_t x = vmovl_u8(vld1_u8(narrow + i));
+      if (vminvq_u16(vceqq_u16(x, vld1q_u16(wide + i))) == 0)
+         break;
+   }
+#endif
+
+   for (; i < count && narrow[i] == wide[i]; ++i)
+      ;
+   return i;
+}
+
+
+namespace Detail
+{
+
+// Searching runs of UTF-16 code units, as String::find() and friends do when CF can hand
+// out the characters directly. These are the cfxx_search.h byte searches over UniChars:
+// each returns a pointer to the match, or nullptr.
+
+inline const UniChar* findCharacter(const UniChar* s, size_t count, UniChar c) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i needle256 = _mm256_set1_epi16(static_cast<short>(c));
+   for (; i + 16 <= count; i += 16)
+   {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+      const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, needle256)));
+      if (mask)
+         return s + i + (__builtin_ctz(mask) >> 1);
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i needle = _mm_set1_epi16(static_cast<short>(c));
+   for (; i + 8 <= count; i += 8)
+   {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+      const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, needle)));
+      if (mask)
+         return s + i + (__builtin_ctz(mask) >> 1);
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint16x8_t needle = vdupq_n_u16(c);
+   for (; i + 8 <= count; i += 8)
+   {
+      if (vmaxvq_u16(vceqq_u16(vld1q_u16(s + i), needle)) != 0)
+         break;
+   }
+#endif
+
+   for (; i < count; ++i)
+   {
+      if (s[i] == c)
+         return s + i;
+   }
+   return nullptr;
+}
+
+inline const UniChar* findLastCharacter(const UniChar* s, size_t count, UniChar c) noexcept
+{
+   size_t i = count;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i needle256 = _mm256_set1_epi16(static_cast<short>(c));
+   for (; i >= 16; i -= 16)
+   {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 16));
+      const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, needle256)));
+      if (mask)
+         return s + i - 16 + ((31 - __builtin_clz(mask)) >> 1);
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i needle = _mm_set1_epi16(static_cast<short>(c));
+   for (; i >= 8; i -= 8)
+   {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 8));
+      const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, needle)));
+      if (mask)
+         return s + i - 8 + ((31 - __builtin_clz(mask)) >> 1);
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint16x8_t needle = vdupq_n_u16(c);
+   for (; i >= 8; i -= 8)
+   {
+      if (vmaxvq_u16(vceqq_u16(vld1q_u16(s + i - 8), needle)) != 0)
+         break;
+   }
+#endif
+
+   while (i > 0)
+   {
+      if (s[--i] == c)
+         return s + i;
+   }
+   return nullptr;
+}
+
+// Whether the 'm' characters at 'candidate' are 'pattern', given that the first and last
+// ones already are.
+inline bool matchesInside(const UniChar* candidate, const UniChar* pattern, size_t m) noexcept
+{
+   return std::memcmp(candidate + 1, pattern + 1, (m - 2) * sizeof(UniChar)) == 0;
+}
+
+// The first occurrence of a pattern of 'm' characters, where 'm' is at least 2 and no
+// more than 'count'. As in cfxx_search.h, a block of positions at a time is checked for
+// the pattern's first and last characters, and only those where both match are compared
+// in full. The x86 masks have two bits per character; the NEON ones, a byte.
+inline const UniChar* findCharacters(const UniChar* s, size_t count, const UniChar* pattern, size_t m) noexcept
+{
+   size_t i = 0;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i first256 = _mm256_set1_epi16(static_cast<short>(pattern[0]));
+   const __m256i last256 = _mm256_set1_epi16(static_cast<short>(pattern[m - 1]));
+   for (; i + m - 1 + 16 <= count; i += 16)
+   {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+         _mm256_and_si256(_mm256_cmpeq_epi16(a, first256), _mm256_cmpeq_epi16(b, last256))));
+      while (mask != 0)
+      {
+         const unsigned index = __builtin_ctz(mask) >> 1;
+         if (matchesInside(s + i + index, pattern, m))
+            return s + i + index;
+         mask &= ~(3u << (index * 2));
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i first = _mm_set1_epi16(static_cast<short>(pattern[0]));
+   const __m128i last = _mm_set1_epi16(static_cast<short>(pattern[m - 1]));
+   for (; i + m - 1 + 8 <= count; i += 8)
+   {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+         _mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last))));
+      while (mask != 0)
+      {
+         const unsigned index = __builtin_ctz(mask) >> 1;
+         if (matchesInside(s + i + index, pattern, m))
+            return s + i + index;
+         mask &= ~(3u << (index * 2));
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint16x8_t first = vdupq_n_u16(pattern[0]);
+   const uint16x8_t last = vdupq_n_u16(pattern[m - 1]);
+   for (; i + m - 1 + 8 <= count; i += 8)
+   {
+      const uint16x8_t eq = vandq_u16(vceqq_u16(vld1q_u16(s + i), first), vceqq_u16(vld1q_u16(s + i + m - 1), last));
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(eq)), 0);
+      while (mask != 0)
+      {
+         const unsigned index = static_cast<unsigned>(__builtin_ctzll(mask)) >> 3;
+         if (matchesInside(s + i + index, pattern, m))
+            return s + i + index;
+         mask &= ~(UINT64_C(0xFF) << (index * 8));
+      }
+   }
+#endif
+
+   for (; i + m <= count; ++i)
+   {
+      if (s[i] == pattern[0] && s[i + m - 1] == pattern[m - 1] && matchesInside(s + i, pattern, m))
+         return s + i;
+   }
+   return nullptr;
+}
+
+// The last occurrence of a pattern, working back from the end a block at a time.
+inline const UniChar* findLastCharacters(const UniChar* s, size_t count, const UniChar* pattern, size_t m) noexcept
+{
+   // Every start before 'i' is yet to be checked.
+   size_t i = count - m + 1;
+
+#if defined(CFXX_HAS_AVX2)
+   const __m256i first256 = _mm256_set1_epi16(static_cast<short>(pattern[0]));
+   const __m256i last256 = _mm256_set1_epi16(static_cast<short>(pattern[m - 1]));
+   for (; i >= 16; i -= 16)
+   {
+      const UniChar* block = s + i - 16;
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+         _mm256_and_si256(_mm256_cmpeq_epi16(a, first256), _mm256_cmpeq_epi16(b, last256))));
+      while (mask != 0)
+      {
+         const unsigned index = (31 - __builtin_clz(mask)) >> 1;
+         if (matchesInside(block + index, pattern, m))
+            return block + index;
+         mask &= ~(3u << (index * 2));
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_SSE2)
+   const __m128i first = _mm_set1_epi16(static_cast<short>(pattern[0]));
+   const __m128i last = _mm_set1_epi16(static_cast<short>(pattern[m - 1]));
+   for (; i >= 8; i -= 8)
+   {
+      const UniChar* block = s + i - 8;
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + m - 1));
+      unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+         _mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last))));
+      while (mask != 0)
+      {
+         const unsigned index = (31 - __builtin_clz(mask)) >> 1;
+         if (matchesInside(block + index, pattern, m))
+            return block + index;
+         mask &= ~(3u << (index * 2));
+      }
+   }
+#endif
+
+#if defined(CFXX_HAS_NEON)
+   const uint16x8_t first = vdupq_n_u16(pattern[0]);
+   const uint16x8_t last = vdupq_n_u16(pattern[m - 1]);
+   for (; i >= 8; i -= 8)
+   {
+      const UniChar* block = s + i - 8;
+      const uint16x8_t eq = vandq_u16(vceqq_u16(vld1q_u16(block), first), vceqq_u16(vld1q_u16(block + m - 1), last));
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(eq)), 0);
+      while (mask != 0)
+      {
+         const unsigned index = static_cast<unsigned>(63 - __builtin_clzll(mask)) >> 3;
+         if (matchesInside(block + index, pattern, m))
+            return block + index;
+         mask &= ~(UINT64_C(0xFF) << (index * 8));
+      }
+   }
+#endif
+
+   while (i > 0)
+   {
+      --i;
+      if (s[i] == pattern[0] && s[i + m - 1] == pattern[m - 1] && matchesInside(s + i, pattern, m))
+         return s + i;
+   }
+   return nullptr;
+}
+
+} // namespace Detail
+
+} // namespace CoreFoundation
+
+#endif // __cfxx_unicode_h__
@@ -0,0 +1,160 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+// Counts what goes through it, so tests can tell that CF really used the allocator.
+struct AllocationCounts
+{
+   size_t allocations = 0;
+   size_t deallocations = 0;
+};
+
+template<typename T>
+struct CountingAllocator
+{
+   typedef T value_type;
+
+   explicit CountingAllocator(AllocationCounts* counts) noexcept :
+      m_counts(counts)
+   { }
+
+   template<typename U>
+   CountingAllocator(const CountingAllocator<U>& other) noexcept :
+      m_counts(other.m_counts)
+   { }
+
+   T* allocate(size_t n)
+   {
+      ++m_counts->allocations;
+      return std::allocator<T>().allocate(n);
+   }
+
+   void deallocate(T* p, size_t n)
+   {
+      ++m_counts->deallocations;
+      std::allocator<T>().deallocate(p, n);
+   }
+
+   AllocationCounts* m_counts;
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T>& a, const CountingAllocator<U>& b) { return a.m_counts == b.m_counts; }
+
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T>& a, const CountingAllocator<U>& b) { return a.m_counts != b.m_counts; }
+
+} // anonymous namespace
+
+TEST(AllocatorTests, AllocatorBridge)
+{
+   AllocationCounts counts;
+   {
+      CoreFoundation::CFReference<CFAllocatorRef> allocator =
+         CoreFoundation::makeCFAllocator(CountingAllocator<char>(&counts));
+
+      CoreFoundation::String str("bridged", kCFStringEncodingUTF8, allocator.get());
+      CoreFoundation::MutableString mutableStr(str, allocator.get());
+      mutableStr.append(std::string(500, 'x').c_str());
+
+      const UInt8 bytes[] = { 1, 2, 3, 4 };
+      CoreFoundation::Data data(bytes, sizeof(bytes), allocator.get());
+      CoreFoundation::MutableData mutableData(data, allocator.get());
+      mutableData.append(bytes, sizeof(bytes));
+
+      ASSERT_EQ(std::string("bridged"), str.to_string());
+      ASSERT_EQ(static_cast<CFIndex>(507), mutableStr.size());
+      ASSERT_EQ(static_cast<CFIndex>(8), mutableData.size());
+      ASSERT_EQ(4, mutableData[7]);
+      ASSERT_GT(counts.allocations, 0u);
+   }
+   ASSERT_EQ(counts.allocations, counts.deallocations);
+}
+
+TEST(AllocatorTests, MonotonicArena)
+{
+   CoreFoundation::MonotonicArena arena(1024);
+
+   for (int round = 0; round < 3; ++round)
+   {
+      {
+         CoreFoundation::String a("first", kCFStringEncodingUTF8, arena.allocator());
+         CoreFoundation::String b(std::string(4000, 'y'), kCFStringEncodingUTF8, arena.allocator());
+         CoreFoundation::MutableData grown(arena.allocator());
+         for (int i = 0; i < 100; ++i)
+         {
+            const UInt8 byte = static_cast<UInt8>(i);
+            grown.append(&byte, 1);
+         }
+
+         ASSERT_EQ(std::string("first"), a.to_string());
+         ASSERT_EQ(static_cast<CFIndex>(4000), b.size());
+         ASSERT_EQ(99, grown[99]);
+         ASSERT_GT(arena.bytes_allocated(), 0u);
+      }
+      arena.reset();
+      ASSERT_EQ(0u, arena.bytes_allocated());
+   }
+
+   void* p = arena.allocate(3);
+   void* q = arena.allocate(1);
+   ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p) % CoreFoundation::MonotonicArena::kAlignment);
+   ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(q) % CoreFoundation::MonotonicArena::kAlignment);
+   ASSERT_NE(p, q);
+}
+
+TEST(AllocatorTests, ThreadLocalPool)
+{
+   CFAllocatorRef pool = CoreFoundation::ThreadLocalPool::allocator();
+   ASSERT_EQ(pool, CoreFoundation::ThreadLocalPool::allocator());
+
+   // Made on one thread and released on another.
+   std::unique_ptr<CoreFoundation::String> crossThread;
+   std::thread producer([&crossThread, pool]() {
+      crossThread.reset(new CoreFoundation::String("made elsewhere", kCFStringEncodingUTF8, pool));
+      CoreFoundation::String local("short-lived", kCFStringEncodingUTF8, pool);
+      EXPECT_EQ(std::string("short-lived"), local.to_string());
+   });
+   producer.join();
+
+   for (int i = 0; i < 1000; ++i)
+   {
+      CoreFoundation::MutableString str(pool);
+      str.append("some text");
+      ASSERT_EQ(static_cast<CFIndex>(9), str.size());
+   }
+
+   ASSERT_EQ(std::string("made elsewhere"), crossThread->to_string());
+   crossThread.reset();
+   CoreFoundation::ThreadLocalPool::trim();
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// A CFData filled with 'value', so that readers can tell whether what they loaded is intact.
+CoreFoundation::CFReference<CFDataRef> makeFilledData(UInt8 value)
+{
+   const std::vector<UInt8> bytes(64, value);
+   return CoreFoundation::makeCFReferenceFromCopyOrCreate(
+      CFDataCreate(kCFAllocatorDefault, bytes.data(), bytes.size()));
+}
+
+} // namespace
+
+TEST(AtomicTests, LoadStoreExchange)
+{
+   CoreFoundation::AtomicCFReference<CFDataRef> atomic;
+   ASSERT_TRUE(atomic.load().get() == nullptr);
+
+   CoreFoundation::CFReference<CFDataRef> a = makeFilledData(1);
+   CoreFoundation::CFReference<CFDataRef> b = makeFilledData(2);
+
+   atomic.store(a);
+   ASSERT_EQ(2, a.use_count());
+   {
+      CoreFoundation::CFReference<CFDataRef> loaded = atomic.load();
+      ASSERT_EQ(a.get(), loaded.get());
+      ASSERT_EQ(3, a.use_count());
+   }
+   ASSERT_EQ(2, a.use_count());
+
+   CoreFoundation::CFReference<CFDataRef> previous = atomic.exchange(b);
+   ASSERT_EQ(a.get(), previous.get());
+   ASSERT_EQ(2, a.use_count());
+   previous.release();
+   ASSERT_EQ(1, a.use_count());
+   ASSERT_EQ(2, b.use_count());
+
+   atomic.store(CoreFoundation::CFReference<CFDataRef>());
+   ASSERT_TRUE(atomic.load().get() == nullptr);
+   ASSERT_EQ(1, b.use_count());
+}
+
+TEST(AtomicTests, CompareExchange)
+{
+   CoreFoundation::CFReference<CFDataRef> a = makeFilledData(1);
+   CoreFoundation::CFReference<CFDataRef> b = makeFilledData(2);
+   CoreFoundation::AtomicCFReference<CFDataRef> atomic(a);
+
+   CoreFoundation::CFReference<CFDataRef> expected = b;
+   ASSERT_FALSE(atomic.compare_exchange(expected, b));
+   ASSERT_EQ(a.get(), expected.get());
+
+   ASSERT_TRUE(atomic.compare_exchange(expected, b));
+   ASSERT_EQ(b.get(), atomic.load().get());
+
+   expected.release();
+   ASSERT_EQ(1, a.use_count());
+   ASSERT_EQ(2, b.use_count());
+}
+
+TEST(AtomicTests, ConcurrentReadersAndWriter)
+{
+   CoreFoundation::AtomicCFReference<CFDataRef> atomic(makeFilledData(0));
+   std::atomic<bool> done(false);
+   std::atomic<long> torn(0);
+
+   std::vector<std::thread> readers;
+   for (int i = 0; i < 4; ++i)
+   {
+      readers.emplace_back([&]()
+      {
+         while (!done.load())
+         {
+            CoreFoundation::CFReference<CFDataRef> ref = atomic.load();
+            const UInt8* bytes = CFDataGetBytePtr(ref.get());
+            for (CFIndex j = 1; j < CFDataGetLength(ref.get()); ++j)
+            {
+               if (bytes[j] != bytes[0])
+                  ++torn;
+            }
+         }
+      });
+   }
+
+   std::thread writer([&]()
+   {
+      for (int i = 1; i <= 2000; ++i)
+      {
+         if (i % 2)
+            atomic.store(makeFilledData(static_cast<UInt8>(i)));
+         else
+         {
+            CoreFoundation::CFReference<CFDataRef> expected = atomic.load();
+            atomic.compare_exchange(expected, makeFilledData(static_cast<UInt8>(i)));
+         }
+      }
+      done.store(true);
+   });
+
+   writer.join();
+   for (std::thread& reader : readers)
+      reader.join();
+
+   ASSERT_EQ(0, torn.load());
+
+   // Every reference the readers took has been given back.
+   CoreFoundation::CFReference<CFDataRef> last = atomic.load();
+   ASSERT_EQ(2, last.use_count());
+   ASSERT_EQ(2000 % 256, CFDataGetBytePtr(last.get())[0]);
+}
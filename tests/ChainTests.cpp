@@ -0,0 +1,177 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+CoreFoundation::Data makeData(const std::string& s)
+{
+   return CoreFoundation::Data(reinterpret_cast<const UInt8*>(s.data()), s.size());
+}
+
+std::string toString(const CoreFoundation::DataChain& chain)
+{
+   return std::string(chain.begin(), chain.end());
+}
+
+} // namespace
+
+TEST(ChainTests, AppendAndPrependRetainSegments)
+{
+   const CoreFoundation::Data hello = makeData("hello");
+   const CoreFoundation::Data world = makeData("world");
+   const long count = CFGetRetainCount(static_cast<CFDataRef>(hello));
+
+   CoreFoundation::DataChain chain;
+   ASSERT_TRUE(chain.empty());
+   ASSERT_EQ(chain.begin(), chain.end());
+
+   chain.append(world).prepend(makeData(", ")).prepend(hello).append(makeData(""));
+   ASSERT_EQ(12, chain.size());
+   ASSERT_EQ(3, chain.segment_count());
+   ASSERT_EQ("hello, world", toString(chain));
+   ASSERT_EQ(count + 1, CFGetRetainCount(static_cast<CFDataRef>(hello)));
+   ASSERT_EQ(hello.data(), chain.segments().front().data());
+
+   CoreFoundation::DataChain twice;
+   twice.append(chain).append(chain);
+   ASSERT_EQ("hello, worldhello, world", toString(twice));
+   twice.append(twice);
+   ASSERT_EQ(48, twice.size());
+   ASSERT_EQ(12, twice.segment_count());
+
+   CoreFoundation::DataChain moved;
+   moved.append(std::move(chain));
+   ASSERT_TRUE(chain.empty());
+   ASSERT_EQ(0, chain.segment_count());
+   ASSERT_EQ("hello, world", toString(moved));
+
+   moved.clear();
+   twice.clear();
+   ASSERT_EQ(count, CFGetRetainCount(static_cast<CFDataRef>(hello)));
+}
+
+TEST(ChainTests, Split)
+{
+   CoreFoundation::DataChain chain;
+   const CoreFoundation::Data first = makeData("abcd");
+   chain.append(first).append(makeData("efgh")).append(makeData("ij"));
+
+   CoreFoundation::DataChain front = chain.split(6);
+   ASSERT_EQ("abcdef", toString(front));
+   ASSERT_EQ(2, front.segment_count());
+   ASSERT_EQ("ghij", toString(chain));
+   ASSERT_EQ(6, front.size());
+   ASSERT_EQ(4, chain.size());
+
+   // Nothing was copied.
+   ASSERT_EQ(first.data(), front.segments().front().data());
+   ASSERT_EQ(front.segments().back().data() + 2, chain.segments().front().data());
+
+   ASSERT_TRUE(chain.split(0).empty());
+   ASSERT_EQ("ghij", toString(chain.split(4)));
+   ASSERT_TRUE(chain.empty());
+   ASSERT_THROW(front.split(7), std::out_of_range);
+   ASSERT_THROW(front.split(-1), std::out_of_range);
+}
+
+TEST(ChainTests, Consume)
+{
+   CoreFoundation::DataChain chain;
+   chain.append(makeData("abc")).append(makeData("def")).append(makeData("ghi"));
+
+   chain.consume(4);
+   ASSERT_EQ("efghi", toString(chain));
+   ASSERT_EQ(2, chain.segment_count());
+   chain.consume(2);
+   ASSERT_EQ("ghi", toString(chain));
+   ASSERT_EQ(1, chain.segment_count());
+   ASSERT_THROW(chain.consume(4), std::out_of_range);
+   chain.consume(3);
+   ASSERT_TRUE(chain.empty());
+}
+
+TEST(ChainTests, ManySmallConsumes)
+{
+   // Like writev() getting through a big segment a little at a time: each partial
+   // consume() re-slices the segment, which must not keep the previous slice alive.
+   const std::vector<UInt8> bytes(1 << 20, 'x');
+   const CoreFoundation::Data data(bytes.data(), bytes.size());
+   CoreFoundation::DataChain chain;
+   chain.append(data);
+   chain.consume(64);
+   const long rootCount = CFGetRetainCount(data);
+
+   for (CFIndex consumed = 64; consumed < data.size(); consumed += 64)
+   {
+      const CoreFoundation::Data previous = chain.segments().front();
+      ASSERT_EQ(data.data() + consumed, previous.data());
+      chain.consume(64);
+      ASSERT_EQ(1, CFGetRetainCount(previous));
+      ASSERT_EQ(rootCount, CFGetRetainCount(data));
+   }
+   ASSERT_TRUE(chain.empty());
+   ASSERT_EQ(rootCount - 1, CFGetRetainCount(data));
+}
+
+TEST(ChainTests, Iovecs)
+{
+   CoreFoundation::DataChain chain;
+   chain.append(makeData("one")).append(makeData("three")).append(makeData("seven"));
+
+   const std::vector<iovec> vecs = chain.iovecs();
+   ASSERT_EQ(3u, vecs.size());
+   for (size_t i = 0; i < vecs.size(); ++i)
+   {
+      ASSERT_EQ(chain.segments()[i].data(), vecs[i].iov_base);
+      ASSERT_EQ(static_cast<size_t>(chain.segments()[i].size()), vecs[i].iov_len);
+   }
+
+   iovec some[2];
+   ASSERT_EQ(2u, chain.iovecs(some, 2));
+   ASSERT_EQ(5u, some[1].iov_len);
+   ASSERT_EQ(0u, CoreFoundation::DataChain().iovecs(some, 2));
+}
+
+TEST(ChainTests, Flatten)
+{
+   ASSERT_TRUE(CoreFoundation::DataChain().flatten().empty());
+
+   CoreFoundation::DataChain chain;
+   const CoreFoundation::Data only = makeData("only");
+   chain.append(only);
+   ASSERT_EQ(static_cast<CFDataRef>(only), static_cast<CFDataRef>(chain.flatten()));
+
+   chain.append(makeData(" and then some"));
+   const CoreFoundation::Data flat = chain.flatten();
+   ASSERT_TRUE(flat == makeData("only and then some"));
+   ASSERT_EQ(2, chain.segment_count());
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+CoreFoundation::Data makeData(const std::string& s)
+{
+   return CoreFoundation::Data(reinterpret_cast<const UInt8*>(s.data()), s.size());
+}
+
+// Long enough to go through every path, including the interleaved one.
+std::vector<UInt8> makeBytes(size_t n)
+{
+   std::vector<UInt8> bytes(n);
+   uint32_t state = 12345;
+   for (size_t i = 0; i < n; ++i)
+   {
+      state = state * 1103515245 + 12345;
+      bytes[i] = static_cast<UInt8>(state >> 16);
+   }
+   return bytes;
+}
+
+} // anonymous namespace
+
+TEST(ChecksumTests, Crc32cKnownValues)
+{
+   ASSERT_EQ(0u, CoreFoundation::crc32c(nullptr, 0));
+   ASSERT_EQ(0xE3069283u, CoreFoundation::crc32c(makeData("123456789")));
+
+   // From RFC 3720, B.4.
+   ASSERT_EQ(0x8A9136AAu, CoreFoundation::crc32c(std::vector<UInt8>(32, 0x00).data(), 32));
+   ASSERT_EQ(0x62A8AB43u, CoreFoundation::crc32c(std::vector<UInt8>(32, 0xFF).data(), 32));
+}
+
+TEST(ChecksumTests, Crc32cMatchesScalar)
+{
+   const std::vector<UInt8> bytes = makeBytes(5000);
+   for (size_t n : { 0, 1, 7, 8, 9, 767, 768, 769, 1536, 2000, 5000 })
+   {
+      for (size_t offset : { 0, 1, 3 })
+      {
+         if (offset > n)
+            continue;
+         const uint32_t expected = ~CoreFoundation::Detail::crc32cScalar(~0u, bytes.data() + offset, n - offset);
+         ASSERT_EQ(expected, CoreFoundation::crc32c(bytes.data() + offset, n - offset)) << n << " " << offset;
+      }
+   }
+}
+
+TEST(ChecksumTests, Crc32cIncremental)
+{
+   const std::vector<UInt8> bytes = makeBytes(3000);
+   const uint32_t whole = CoreFoundation::crc32c(bytes.data(), bytes.size());
+
+   CoreFoundation::MutableData data;
+   CoreFoundation::Crc32c crc;
+   for (size_t done = 0, step = 1; done < bytes.size(); done += step, step = step * 3 + 1)
+   {
+      const size_t n = std::min(step, bytes.size() - done);
+      data.append(bytes.data() + done, n);
+      crc.update(bytes.data() + done, n);
+   }
+   ASSERT_EQ(whole, crc.value());
+   ASSERT_EQ(whole, CoreFoundation::crc32c(data));
+
+   crc.reset();
+   ASSERT_EQ(0u, crc.value());
+}
+
+TEST(ChecksumTests, XXHash64KnownValues)
+{
+   ASSERT_EQ(0xEF46DB3751D8E999ull, CoreFoundation::xxhash64(nullptr, 0));
+   ASSERT_EQ(0xD24EC4F1A98C6E5Bull, CoreFoundation::xxhash64(makeData("a")));
+   ASSERT_EQ(0x44BC2CF5AD770999ull, CoreFoundation::xxhash64(makeData("abc")));
+   ASSERT_EQ(0xFBCEA83C8A378BF1ull, CoreFoundation::xxhash64(makeData("Nobody inspects the spammish repetition")));
+   ASSERT_NE(CoreFoundation::xxhash64(makeData("abc")), CoreFoundation::xxhash64(makeData("abc"), 1));
+}
+
+TEST(ChecksumTests, XXHash64Incremental)
+{
+   const std::vector<UInt8> bytes = makeBytes(1000);
+   for (size_t n : { 0, 5, 31, 32, 33, 100, 1000 })
+   {
+      const uint64_t whole = CoreFoundation::xxhash64(bytes.data(), n, 7);
+      for (size_t step : { 1, 3, 16, 32, 50 })
+      {
+         CoreFoundation::XXHash64 hasher(7);
+         for (size_t done = 0; done < n; done += step)
+            hasher.update(bytes.data() + done, std::min(step, n - done));
+         ASSERT_EQ(whole, hasher.digest()) << n << " " << step;
+      }
+   }
+
+   CoreFoundation::XXHash64 hasher;
+   hasher.update(makeData("Nobody inspects"));
+   ASSERT_EQ(CoreFoundation::xxhash64(makeData("Nobody inspects")), hasher.digest());
+   hasher.update(makeData(" the spammish repetition"));
+   ASSERT_EQ(0xFBCEA83C8A378BF1ull, hasher.digest());
+   hasher.reset();
+   ASSERT_EQ(0xEF46DB3751D8E999ull, hasher.digest());
+}
@@ -0,0 +1,383 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+// A file in the temp directory that is removed again at the end of the test.
+class TemporaryFile
+{
+public:
+   explicit TemporaryFile(const std::vector<UInt8>& contents)
+   {
+      char path[] = "/tmp/cfxx-data-XXXXXX";
+      int fd = ::mkstemp(path);
+      EXPECT_GE(fd, 0);
+      if (!contents.empty())
+      {
+         EXPECT_EQ(static_cast<ssize_t>(contents.size()), ::write(fd, contents.data(), contents.size()));
+      }
+      ::close(fd);
+      m_path = path;
+   }
+
+   ~TemporaryFile()
+   {
+      std::remove(m_path.c_str());
+   }
+
+   const std::string& path() const
+   {
+      return m_path;
+   }
+
+private:
+   std::string m_path;
+};
+
+} // anonymous namespace
+
+TEST(DataTests, MapFile)
+{
+   std::vector<UInt8> contents(3 * 4096 + 17);
+   for (size_t i = 0; i < contents.size(); ++i)
+      contents[i] = static_cast<UInt8>(i * 7);
+
+   CoreFoundation::Data copy = [&contents]() {
+      TemporaryFile file(contents);
+      CoreFoundation::Data mapped = CoreFoundation::Data::map_file(file.path(), CoreFoundation::MapAdvice::Sequential);
+      EXPECT_EQ(static_cast<CFIndex>(contents.size()), mapped.size());
+      EXPECT_TRUE(std::equal(mapped.begin(), mapped.end(), contents.begin()));
+      return CoreFoundation::Data(mapped);
+   }();
+
+   // The mapping outlives both the file name and the first Data.
+   ASSERT_EQ(static_cast<CFIndex>(contents.size()), copy.size());
+   ASSERT_EQ(contents.back(), copy[copy.size() - 1]);
+}
+
+TEST(DataTests, MapEmptyFile)
+{
+   TemporaryFile file(std::vector<UInt8>{});
+
+   CoreFoundation::Data mapped = CoreFoundation::Data::map_file(file.path());
+   ASSERT_TRUE(mapped.empty());
+}
+
+TEST(DataTests, MapMissingFileThrows)
+{
+   ASSERT_THROW(CoreFoundation::Data::map_file("/nonexistent/cfxx/file"), std::system_error);
+}
+
+TEST(DataTests, ReadFile)
+{
+   std::vector<UInt8> contents(4096 + 3);
+   for (size_t i = 0; i < contents.size(); ++i)
+      contents[i] = static_cast<UInt8>(i * 13);
+   TemporaryFile file(contents);
+
+   CoreFoundation::Data data = CoreFoundation::Data::read_file(file.path());
+   ASSERT_EQ(static_cast<CFIndex>(contents.size()), data.size());
+   ASSERT_TRUE(std::equal(data.begin(), data.end(), contents.begin()));
+
+   ASSERT_TRUE(CoreFoundation::Data::read_file(TemporaryFile(std::vector<UInt8>{}).path()).empty());
+   ASSERT_THROW(CoreFoundation::Data::read_file("/nonexistent/cfxx/file"), std::system_error);
+   try
+   {
+      CoreFoundation::Data::read_file(file.path(), contents.size() - 1);
+      FAIL();
+   }
+   catch (const std::system_error& e)
+   {
+      ASSERT_EQ(EFBIG, e.code().value());
+   }
+}
+
+TEST(DataTests, ReadFileWithoutKnownSize)
+{
+   // A FIFO has no size for fstat() to report; read_file() reads until the writer closes.
+   char directory[] = "/tmp/cfxx-fifo-XXXXXX";
+   ASSERT_NE(nullptr, ::mkdtemp(directory));
+   const std::string path = std::string(directory) + "/fifo";
+   ASSERT_EQ(0, ::mkfifo(path.c_str(), 0600));
+
+   std::vector<UInt8> contents(3 * 4096 + 5);
+   for (size_t i = 0; i < contents.size(); ++i)
+      contents[i] = static_cast<UInt8>(i * 7);
+   const auto writeContents = [&path, &contents]() {
+      int fd = ::open(path.c_str(), O_WRONLY);
+      if (fd < 0)
+         return;
+      size_t done = 0;
+      while (done < contents.size())
+      {
+         ssize_t n = ::write(fd, contents.data() + done, std::min<size_t>(1000, contents.size() - done));
+         if (n <= 0)
+            break;
+         done += static_cast<size_t>(n);
+      }
+      ::close(fd);
+   };
+
+   std::thread writer(writeContents);
+   const CoreFoundation::Data data = CoreFoundation::Data::read_file(path);
+   writer.join();
+   ASSERT_EQ(static_cast<CFIndex>(contents.size()), data.size());
+   ASSERT_TRUE(std::equal(data.begin(), data.end(), contents.begin()));
+
+   // max_size still applies. The writer may find the FIFO closed under it.
+   void (*previous)(int) = std::signal(SIGPIPE, SIG_IGN);
+   std::thread tooMuch(writeContents);
+   try
+   {
+      CoreFoundation::Data::read_file(path, 4096);
+      ADD_FAILURE();
+   }
+   catch (const std::system_error& e)
+   {
+      EXPECT_EQ(EFBIG, e.code().value());
+   }
+   tooMuch.join();
+   std::signal(SIGPIPE, previous);
+
+   std::remove(path.c_str());
+   ::rmdir(directory);
+
+   // Files under /proc claim to be empty, but aren't.
+   if (::access("/proc/self/status", R_OK) == 0)
+   {
+      ASSERT_FALSE(CoreFoundation::Data::read_file("/proc/self/status").empty());
+   }
+}
+
+TEST(DataTests, MutableDataDefaultIsEmpty)
+{
+   CoreFoundation::MutableData data;
+   ASSERT_EQ(0, data.size());
+   data.push_back(1);
+   ASSERT_EQ(1, data.size());
+}
+
+TEST(DataTests, MutableDataReserve)
+{
+   CoreFoundation::MutableData data = CoreFoundation::MutableData::with_capacity(1000);
+   ASSERT_EQ(0, data.size());
+   ASSERT_EQ(1000, data.capacity());
+
+   const UInt8* storage = data.data();
+   for (int i = 0; i < 1000; ++i)
+      data.push_back(static_cast<UInt8>(i));
+   ASSERT_EQ(storage, data.data());
+   ASSERT_EQ(1000, data.capacity());
+   ASSERT_EQ(999 % 256, data[999]);
+
+   // Growing past it at least doubles the capacity.
+   data.push_back(0);
+   const CoreFoundation::MutableData::size_type grown = data.capacity();
+   ASSERT_GE(grown, 2000);
+   ASSERT_EQ(999 % 256, data[999]);
+
+   // Clearing keeps the storage.
+   data.clear();
+   ASSERT_EQ(0, data.size());
+   ASSERT_EQ(grown, data.capacity());
+}
+
+TEST(DataTests, MutableDataInsert)
+{
+   const UInt8 abc[] = { 'a', 'b', 'c' };
+   CoreFoundation::MutableData data;
+   data.append(abc, 3);
+
+   CoreFoundation::MutableData::iterator it = data.insert(data.begin() + 1, 'x');
+   ASSERT_EQ(data.begin() + 1, it);
+   ASSERT_EQ("axbc", std::string(data.begin(), data.end()));
+
+   data.insert(data.end(), 2, 'y');
+   ASSERT_EQ("axbcyy", std::string(data.begin(), data.end()));
+
+   data.insert(data.begin(), abc, abc + 3);
+   ASSERT_EQ("abcaxbcyy", std::string(data.begin(), data.end()));
+
+   const std::string tail = "!?";
+   data.insert(data.end(), tail.begin(), tail.end());
+   ASSERT_EQ("abcaxbcyy!?", std::string(data.begin(), data.end()));
+
+   // Inserting a range of our own bytes.
+   data.insert(data.begin() + 2, data.begin(), data.begin() + 4);
+   ASSERT_EQ("ababcacaxbcyy!?", std::string(data.begin(), data.end()));
+
+   data.pop_back();
+   ASSERT_EQ("ababcacaxbcyy!", std::string(data.begin(), data.end()));
+}
+
+TEST(DataTests, MutableDataAssignAndResize)
+{
+   CoreFoundation::MutableData data;
+   data.assign(3, 'z');
+   ASSERT_EQ("zzz", std::string(data.begin(), data.end()));
+
+   const std::string s = "hello";
+   data.assign(s.begin(), s.end());
+   ASSERT_EQ("hello", std::string(data.begin(), data.end()));
+
+   data.assign(data.begin() + 1, data.begin() + 3);
+   ASSERT_EQ("el", std::string(data.begin(), data.end()));
+
+   data.resize(4, '-');
+   ASSERT_EQ("el--", std::string(data.begin(), data.end()));
+   data.resize(5);
+   ASSERT_EQ(0, data[4]);
+
+   // Appending ourselves to ourselves, across a reallocation: a copy has no spare room.
+   CoreFoundation::MutableData exact(data);
+   ASSERT_EQ(exact.size(), exact.capacity());
+   exact.append(exact);
+   ASSERT_EQ(10, exact.size());
+   ASSERT_EQ(0, std::memcmp(exact.data(), exact.data() + 5, 5));
+}
+
+TEST(DataTests, MutableDataCopiesAreDeep)
+{
+   CoreFoundation::MutableData a;
+   a.push_back(1);
+   CoreFoundation::MutableData b(a);
+   b.push_back(2);
+   ASSERT_EQ(1, a.size());
+   ASSERT_EQ(2, b.size());
+
+   a = b;
+   a.push_back(3);
+   ASSERT_EQ(3, a.size());
+   ASSERT_EQ(2, b.size());
+}
+
+TEST(DataTests, SliceSharesBytes)
+{
+   const std::string contents = "header:payload:trailer";
+   CFDataRef parentRef;
+   CoreFoundation::Data payload;
+   {
+      const CoreFoundation::Data parent(reinterpret_cast<const UInt8*>(contents.data()), contents.size());
+      parentRef = parent;
+      const long count = CFGetRetainCount(parentRef);
+
+      payload = parent.slice(7, 7);
+      ASSERT_EQ(parent.data() + 7, payload.data());
+      ASSERT_EQ(7, payload.size());
+      ASSERT_EQ(count + 1, CFGetRetainCount(parentRef));
+
+      ASSERT_EQ("trailer", std::string(parent.slice(15).begin(), parent.slice(15).end()));
+      ASSERT_TRUE(parent.slice(0, 0).empty());
+      ASSERT_EQ(parentRef, static_cast<CFDataRef>(parent.slice(0)));
+
+      ASSERT_THROW(parent.slice(20, 3), std::out_of_range);
+      ASSERT_THROW(parent.slice(23), std::out_of_range);
+      ASSERT_THROW(parent.slice(-1, 1), std::out_of_range);
+   }
+
+   // The slice keeps the parent's bytes alive after the parent Data is gone.
+   ASSERT_EQ(1, CFGetRetainCount(parentRef));
+   ASSERT_EQ("payload", std::string(payload.begin(), payload.end()));
+
+   // Slices of slices work the same way.
+   const CoreFoundation::Data inner = payload.slice(3, 4);
+   ASSERT_EQ("load", std::string(inner.begin(), inner.end()));
+   ASSERT_EQ(payload.data() + 3, inner.data());
+
+   // ...but hold on to the original CFData, not to the slice in between, also when
+   // slicing a copy of a slice.
+   const CFDataRef payloadRef = payload;
+   ASSERT_EQ(1, CFGetRetainCount(payloadRef));
+   ASSERT_EQ(1, CFGetRetainCount(parentRef));
+   const CoreFoundation::Data copy = payload;
+   const CoreFoundation::Data innerCopy = copy.slice(1);
+   ASSERT_EQ(2, CFGetRetainCount(payloadRef));
+   ASSERT_EQ(1, CFGetRetainCount(parentRef));
+   ASSERT_EQ(payload.data() + 1, innerCopy.data());
+
+   payload = CoreFoundation::Data();
+   ASSERT_EQ("load", std::string(inner.begin(), inner.end()));
+}
+
+TEST(DataTests, SliceOfMutableDataCopies)
+{
+   CoreFoundation::MutableData data;
+   data.assign(4, 'a');
+   const CoreFoundation::Data slice = data.slice(1, 2);
+   data[1] = 'b';
+   ASSERT_EQ("aa", std::string(slice.begin(), slice.end()));
+
+   // So does a Data that merely wraps a CFMutableData, or a copy of a MutableData.
+   struct WrappedData : CoreFoundation::Data
+   {
+      explicit WrappedData(CFMutableDataRef ref) :
+         Data(CoreFoundation::makeCFReferenceFromCopyOrCreate(static_cast<CFDataRef>(ref)))
+      { }
+   };
+   const WrappedData wrapped(CFDataCreateMutableCopy(kCFAllocatorDefault, 0, data));
+   const CoreFoundation::Data wrappedSlice = wrapped.slice(1, 2);
+   ASSERT_NE(wrapped.data() + 1, wrappedSlice.data());
+
+   const CoreFoundation::Data copy = data;
+   ASSERT_NE(copy.data() + 1, copy.slice(1, 2).data());
+}
+
+TEST(DataTests, DataView)
+{
+   const std::string contents = "abcdef";
+   const CoreFoundation::Data data(reinterpret_cast<const UInt8*>(contents.data()), contents.size());
+
+   const CoreFoundation::DataView view = data;
+   ASSERT_EQ(data.data(), view.data());
+   ASSERT_EQ(6, view.size());
+   ASSERT_TRUE(view == data.view());
+
+   const CoreFoundation::DataView cd = view.subview(2, 2);
+   ASSERT_EQ(view.data() + 2, cd.data());
+   ASSERT_EQ('c', cd[0]);
+   ASSERT_EQ('d', cd.at(1));
+   ASSERT_THROW(cd.at(2), std::out_of_range);
+   ASSERT_EQ("ef", std::string(view.subview(4).begin(), view.subview(4).end()));
+   ASSERT_THROW(view.subview(5, 2), std::out_of_range);
+   ASSERT_TRUE(CoreFoundation::DataView(reinterpret_cast<const UInt8*>("cd"), 2) == cd);
+   ASSERT_TRUE(CoreFoundation::DataView().empty());
+}
@@ -0,0 +1,251 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+CoreFoundation::Data makeData(const std::string& s)
+{
+   return CoreFoundation::Data(reinterpret_cast<const UInt8*>(s.data()), s.size());
+}
+
+std::string toString(const CoreFoundation::Data& data)
+{
+   return std::string(data.begin(), data.end());
+}
+
+std::vector<UInt8> makeBytes(size_t n)
+{
+   std::vector<UInt8> bytes(n);
+   UInt32 state = 2463534242u;
+   for (size_t i = 0; i < n; ++i)
+   {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      bytes[i] = static_cast<UInt8>(state);
+   }
+   return bytes;
+}
+
+// A byte at a time, for comparing the fast paths against.
+std::string referenceBase64(const std::vector<UInt8>& bytes)
+{
+   const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+   std::string out;
+   UInt32 bits = 0;
+   int count = 0;
+   for (UInt8 b : bytes)
+   {
+      bits = (bits << 8) | b;
+      count += 8;
+      while (count >= 6)
+      {
+         count -= 6;
+         out.push_back(alphabet[(bits >> count) & 0x3F]);
+      }
+   }
+   if (count > 0)
+      out.push_back(alphabet[(bits << (6 - count)) & 0x3F]);
+   while (out.size() % 4 != 0)
+      out.push_back('=');
+   return out;
+}
+
+std::string decodeBase64(const std::string& s, CoreFoundation::DecodeMode mode = CoreFoundation::DecodeMode::Strict)
+{
+   return toString(CoreFoundation::Data::from_base64(CoreFoundation::String(s), mode));
+}
+
+std::string decodeHex(const std::string& s, CoreFoundation::DecodeMode mode = CoreFoundation::DecodeMode::Strict)
+{
+   return toString(CoreFoundation::Data::from_hex(CoreFoundation::String(s), mode));
+}
+
+} // anonymous namespace
+
+TEST(EncodingTests, Base64KnownValues)
+{
+   // RFC 4648, section 10.
+   const char* vectors[][2] = {
+      { "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+      { "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" }
+   };
+   for (const auto& vector : vectors)
+   {
+      ASSERT_EQ(vector[1], makeData(vector[0]).to_base64().to_string());
+      ASSERT_EQ(vector[0], decodeBase64(vector[1]));
+   }
+}
+
+TEST(EncodingTests, Base64RoundTrip)
+{
+   for (size_t n = 0; n < 200; ++n)
+   {
+      const std::vector<UInt8> bytes = makeBytes(n);
+      const CoreFoundation::Data data(bytes.data(), static_cast<CFIndex>(n));
+      const CoreFoundation::String encoded = data.to_base64();
+      ASSERT_EQ(referenceBase64(bytes), encoded.to_string()) << n;
+      ASSERT_TRUE(CoreFoundation::Data::from_base64(encoded) == data) << n;
+   }
+}
+
+TEST(EncodingTests, Base64Strict)
+{
+   ASSERT_THROW(decodeBase64("Zm9"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm8"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm9v\nYmFy"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm9v YmFy"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm9-"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm8=Zm8="), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Z==="), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("=Zm8"), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zg="), std::invalid_argument);
+   // "Zh==" decodes to the same byte as "Zg==", but with a stray bit set.
+   ASSERT_THROW(decodeBase64("Zh=="), std::invalid_argument);
+   // A bad character in the middle of a block the fast paths would take.
+   ASSERT_THROW(decodeBase64("QUJDREVGR0hJSktM!05PUFFSU1RVVldY"), std::invalid_argument);
+   ASSERT_EQ("ABCDEFGHIJKLMNOPQRSTUVWX", decodeBase64("QUJDREVGR0hJSktMTU5PUFFSU1RVVldY"));
+}
+
+TEST(EncodingTests, Base64Lenient)
+{
+   const CoreFoundation::DecodeMode lenient = CoreFoundation::DecodeMode::Lenient;
+   ASSERT_EQ("foobar", decodeBase64(" Zm9v\r\nYmFy\n", lenient));
+   ASSERT_EQ("fo", decodeBase64("Zm8", lenient));
+   ASSERT_EQ("f", decodeBase64("Z g", lenient));
+   ASSERT_EQ("f", decodeBase64("Zh==", lenient));
+   ASSERT_EQ("f", decodeBase64("Zg=\t=\n", lenient));
+   ASSERT_THROW(decodeBase64("Z", lenient), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zg==Zg", lenient), std::invalid_argument);
+   ASSERT_THROW(decodeBase64("Zm9v#", lenient), std::invalid_argument);
+
+   // MIME-style lines of 76 characters.
+   const std::vector<UInt8> bytes = makeBytes(1000);
+   const std::string encoded = referenceBase64(bytes);
+   std::string wrapped;
+   for (size_t i = 0; i < encoded.size(); i += 76)
+      wrapped += encoded.substr(i, 76) + "\r\n";
+   const std::string decoded = decodeBase64(wrapped, lenient);
+   ASSERT_EQ(std::string(bytes.begin(), bytes.end()), decoded);
+}
+
+TEST(EncodingTests, Base64Streaming)
+{
+   const std::vector<UInt8> bytes = makeBytes(5000);
+   const std::string encoded = referenceBase64(bytes);
+
+   for (size_t step : { 1, 3, 5, 17, 100, 4096 })
+   {
+      CoreFoundation::Base64Decoder decoder;
+      std::vector<UInt8> out(CoreFoundation::Base64Decoder::max_output_size(encoded.size()) + step);
+      size_t written = 0;
+      for (size_t done = 0; done < encoded.size(); done += step)
+      {
+         const size_t n = std::min(step, encoded.size() - done);
+         written += decoder.decode(encoded.data() + done, n, out.data() + written);
+      }
+      written += decoder.finish(out.data() + written);
+      ASSERT_EQ(bytes.size(), written) << step;
+      ASSERT_TRUE(std::equal(bytes.begin(), bytes.end(), out.begin())) << step;
+   }
+}
+
+TEST(EncodingTests, Hex)
+{
+   ASSERT_EQ("", CoreFoundation::Data(nullptr, 0).to_hex().to_string());
+   ASSERT_EQ("00ff7f80", makeData(std::string("\x00\xff\x7f\x80", 4)).to_hex().to_string());
+   ASSERT_EQ(std::string("\x00\xff\xab", 3), decodeHex("00FFaB"));
+
+   for (size_t n = 0; n < 100; ++n)
+   {
+      const std::vector<UInt8> bytes = makeBytes(n);
+      const CoreFoundation::Data data(bytes.data(), static_cast<CFIndex>(n));
+      const std::string hex = data.to_hex().to_string();
+      ASSERT_EQ(2 * n, hex.size());
+      for (size_t i = 0; i < n; ++i)
+         ASSERT_EQ(bytes[i], std::stoul(hex.substr(2 * i, 2), nullptr, 16));
+      ASSERT_TRUE(CoreFoundation::Data::from_hex(data.to_hex()) == data) << n;
+   }
+
+   ASSERT_THROW(decodeHex("abc"), std::invalid_argument);
+   ASSERT_THROW(decodeHex("ab cd"), std::invalid_argument);
+   ASSERT_THROW(decodeHex("0123456789abcdef0123456789abcdeg"), std::invalid_argument);
+   ASSERT_EQ(std::string("\xab\xcd", 2), decodeHex(" a b\ncd ", CoreFoundation::DecodeMode::Lenient));
+   ASSERT_THROW(decodeHex("abc", CoreFoundation::DecodeMode::Lenient), std::invalid_argument);
+}
+
+TEST(EncodingTests, InvalidCharacterAnywhere)
+{
+   // Long enough for every vector kernel's block size, with each character in turn
+   // replaced by something outside the alphabet, including bytes past ASCII.
+   const std::string base64 = referenceBase64(makeBytes(150));
+   std::string hex(CoreFoundation::hex_encoded_size(80), '\0');
+   const std::vector<UInt8> hexBytes = makeBytes(80);
+   CoreFoundation::hex_encode(hexBytes.data(), hexBytes.size(), &hex[0]);
+
+   for (const char bad : { '!', ' ', '=', 'g', '\x80', '\xC1', '\xFF' })
+   {
+      for (size_t i = 0; i < 128; ++i)
+      {
+         std::string s = base64;
+         if (bad != 'g')
+         {
+            s[i] = bad;
+            CoreFoundation::Base64Decoder decoder;
+            std::vector<UInt8> out(CoreFoundation::Base64Decoder::max_output_size(s.size()));
+            ASSERT_THROW(decoder.decode(s.data(), s.size(), out.data()), std::invalid_argument) << i;
+         }
+
+         s = hex;
+         s[i] = bad;
+         CoreFoundation::HexDecoder decoder;
+         std::vector<UInt8> out(CoreFoundation::HexDecoder::max_output_size(s.size()));
+         ASSERT_THROW(decoder.decode(s.data(), s.size(), out.data()), std::invalid_argument) << i;
+      }
+   }
+}
+
+TEST(EncodingTests, DecodeNonAsciiBackedString)
+{
+   // A string CF keeps as UTF-16 goes through for_each_chunk rather than the bytes.
+   const std::string encoded = referenceBase64(makeBytes(3000));
+   std::vector<UniChar> characters(encoded.begin(), encoded.end());
+   CoreFoundation::MutableString s;
+   s.append(characters.data(), characters.size());
+   ASSERT_TRUE(CoreFoundation::Data::from_base64(s) == CoreFoundation::Data::from_base64(CoreFoundation::String(encoded)));
+
+   const UniChar nonAscii[] = { 'Z', 'g', 0x0100 | '=', '=' };
+   CoreFoundation::MutableString bad;
+   bad.append(nonAscii, 4);
+   ASSERT_THROW(CoreFoundation::Data::from_base64(bad), std::invalid_argument);
+}
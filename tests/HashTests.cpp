@@ -0,0 +1,205 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+TEST(HashTests, StdHash)
+{
+   const std::hash<CoreFoundation::String> stringHash;
+   CoreFoundation::String a("some key");
+   CoreFoundation::String b(std::string("some key"));
+   ASSERT_EQ(stringHash(a), stringHash(b));
+   ASSERT_EQ(stringHash(a), static_cast<size_t>(CFHash(a)));
+
+   // A MutableString's hash follows its contents.
+   CoreFoundation::MutableString m("some");
+   const size_t before = stringHash(m);
+   m.append(" key");
+   ASSERT_NE(before, stringHash(m));
+   ASSERT_EQ(stringHash(a), stringHash(m));
+
+   const UInt8 bytes[] = { 1, 2, 3 };
+   const std::hash<CoreFoundation::Data> dataHash;
+   CoreFoundation::Data d1(bytes, sizeof(bytes));
+   CoreFoundation::Data d2(bytes, sizeof(bytes));
+   ASSERT_EQ(dataHash(d1), dataHash(d2));
+   ASSERT_TRUE(d1 == d2);
+
+   CoreFoundation::MutableData md(d1);
+   ASSERT_EQ(dataHash(d1), dataHash(md));
+   md[0] = 9;
+   ASSERT_NE(dataHash(d1), dataHash(md));
+   ASSERT_TRUE(d1 != md);
+
+   std::unordered_set<CoreFoundation::String> set;
+   set.insert(a);
+   ASSERT_EQ(1u, set.count(CoreFoundation::String("some key")));
+}
+
+TEST(HashTests, HashMapBasics)
+{
+   CoreFoundation::CFHashMap<CoreFoundation::String, int> map;
+   ASSERT_TRUE(map.empty());
+   ASSERT_TRUE(map.find(CoreFoundation::String("missing")) == map.end());
+
+   map[CoreFoundation::String("one")] = 1;
+   ASSERT_TRUE(map.insert(std::make_pair(CoreFoundation::String("two"), 2)).second);
+   ASSERT_FALSE(map.insert(std::make_pair(CoreFoundation::String("two"), 22)).second);
+   ASSERT_TRUE(map.try_emplace(CoreFoundation::String("three"), 3).second);
+
+   ASSERT_EQ(3u, map.size());
+   ASSERT_EQ(1, map.at(CoreFoundation::String("one")));
+   ASSERT_EQ(2, map[CoreFoundation::String(std::string("two"))]);
+   ASSERT_EQ(1u, map.count(CoreFoundation::String("three")));
+   ASSERT_THROW(map.at(CoreFoundation::String("four")), std::out_of_range);
+
+   int sum = 0;
+   for (auto it = map.cbegin(); it != map.cend(); ++it)
+      sum += it->second;
+   ASSERT_EQ(6, sum);
+
+   CoreFoundation::CFHashMap<CoreFoundation::String, int> copy(map);
+   ASSERT_EQ(1u, map.erase(CoreFoundation::String("one")));
+   ASSERT_EQ(0u, map.erase(CoreFoundation::String("one")));
+   ASSERT_EQ(2u, map.size());
+   ASSERT_EQ(3u, copy.size());
+   ASSERT_EQ(1, copy.at(CoreFoundation::String("one")));
+
+   CoreFoundation::CFHashMap<CoreFoundation::String, int> moved(std::move(copy));
+   ASSERT_EQ(3u, moved.size());
+   ASSERT_TRUE(copy.empty());
+
+   moved.clear();
+   ASSERT_TRUE(moved.empty());
+   ASSERT_TRUE(moved.begin() == moved.end());
+}
+
+namespace
+{
+
+struct SeededHash
+{
+   explicit SeededHash(size_t seed = 0) :
+      seed(seed)
+   { }
+
+   size_t operator()(int key) const
+   {
+      return std::hash<int>()(key) * 31 + seed;
+   }
+
+   size_t seed;
+};
+
+} // namespace
+
+TEST(HashTests, CopiesKeepTheHasher)
+{
+   // The copy's stored hashes came from the original's hasher, so lookups in the copy
+   // must use that same hasher.
+   CoreFoundation::CFHashMap<int, int, SeededHash> map(0, SeededHash(12345));
+   for (int i = 0; i < 100; ++i)
+      map[i] = i * 2;
+
+   const CoreFoundation::CFHashMap<int, int, SeededHash> copy(map);
+   ASSERT_EQ(12345u, copy.hash_function().seed);
+   for (int i = 0; i < 100; ++i)
+      ASSERT_EQ(i * 2, copy.at(i));
+
+   CoreFoundation::CFHashMap<int, int, SeededHash> assigned;
+   assigned[1000] = 1;
+   assigned = map;
+   ASSERT_EQ(12345u, assigned.hash_function().seed);
+   ASSERT_EQ(100u, assigned.size());
+   for (int i = 0; i < 100; ++i)
+      ASSERT_EQ(i * 2, assigned.at(i));
+   ASSERT_EQ(0u, assigned.count(1000));
+}
+
+TEST(HashTests, MutableStringChangedThroughRef)
+{
+   // Changes made through the CFMutableStringRef, and Strings sharing the MutableString's
+   // CFString, must never see a stale hash.
+   CoreFoundation::MutableString m("some key!");
+   const CoreFoundation::String shared = m;
+   ASSERT_EQ(static_cast<CFHashCode>(CFHash(m)), m.hash());
+   ASSERT_EQ(m.hash(), shared.hash());
+
+   CFStringDelete(m, CFRangeMake(8, 1));
+   ASSERT_EQ(static_cast<CFHashCode>(CFHash(m)), m.hash());
+
+   m.append("?");
+   ASSERT_EQ(static_cast<CFHashCode>(CFHash(shared)), shared.hash());
+
+   CFStringDelete(m, CFRangeMake(8, 1));
+   CoreFoundation::CFHashMap<CoreFoundation::String, int> map;
+   map[CoreFoundation::String("some key")] = 1;
+   ASSERT_EQ(1, map.at(m));
+   ASSERT_EQ(1, map.at(shared));
+   ASSERT_EQ(1u, map.count(CoreFoundation::String(m)));
+}
+
+TEST(HashTests, HashMapMatchesUnorderedMap)
+{
+   // Random inserts and erases against std::unordered_map, with keys drawn from a small
+   // range so that erase() keeps having to close up probe runs.
+   std::mt19937 random(1234);
+   std::uniform_int_distribution<int> keys(0, 2000);
+
+   CoreFoundation::CFHashMap<CoreFoundation::Data, int> map;
+   std::unordered_map<int, int> reference;
+
+   for (int step = 0; step < 20000; ++step)
+   {
+      const int k = keys(random);
+      const CoreFoundation::Data key(reinterpret_cast<const UInt8*>(&k), sizeof(k));
+      if (random() % 3 == 0)
+      {
+         ASSERT_EQ(reference.erase(k), map.erase(key));
+      }
+      else
+      {
+         reference[k] = step;
+         map[key] = step;
+      }
+   }
+
+   ASSERT_EQ(reference.size(), map.size());
+   for (auto it = reference.begin(); it != reference.end(); ++it)
+   {
+      const CoreFoundation::Data key(reinterpret_cast<const UInt8*>(&it->first), sizeof(it->first));
+      ASSERT_EQ(it->second, map.at(key));
+   }
+
+   size_t visited = 0;
+   for (auto it = map.begin(); it != map.end(); ++it)
+      ++visited;
+   ASSERT_EQ(map.size(), visited);
+}
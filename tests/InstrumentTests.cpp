@@ -0,0 +1,126 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Built into its own test executable (CfxxInstrumentTests) with CFXX_INSTRUMENT defined,
+// since instrumentation has to be enabled for a whole program or not at all.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+using CoreFoundation::Instrumentation::Event;
+
+namespace
+{
+
+bool isLive(CFTypeRef object)
+{
+   const std::vector<CoreFoundation::Instrumentation::LiveObject> live =
+      CoreFoundation::Instrumentation::live_objects();
+   return std::any_of(live.begin(), live.end(),
+      [object](const CoreFoundation::Instrumentation::LiveObject& o) { return o.object == object; });
+}
+
+} // namespace
+
+TEST(InstrumentTests, CountsReferenceOperations)
+{
+   CoreFoundation::Instrumentation::reset();
+   {
+      CoreFoundation::String s("foobar");            // create + move into the String
+      CoreFoundation::String copy(s);                // copy + retain
+      CoreFoundation::String moved(std::move(copy)); // move
+      copy = moved;                                  // copy + retain
+   }                                                 // 3 releases
+
+   const CoreFoundation::Instrumentation::Snapshot snapshot =
+      CoreFoundation::Instrumentation::snapshot();
+   const CFTypeID type = CFStringGetTypeID();
+   ASSERT_EQ(1u, snapshot.count(type, Event::Create));
+   ASSERT_EQ(2u, snapshot.count(type, Event::Copy));
+   ASSERT_EQ(2u, snapshot.count(type, Event::Retain));
+   ASSERT_EQ(2u, snapshot.count(type, Event::Move));
+   ASSERT_EQ(3u, snapshot.count(type, Event::Release));
+   ASSERT_EQ(0u, snapshot.count(CFDataGetTypeID(), Event::Create));
+}
+
+TEST(InstrumentTests, CountsFromOtherThreads)
+{
+   CoreFoundation::Instrumentation::reset();
+   std::thread thread([]()
+   {
+      for (int i = 0; i < 10; ++i)
+         CoreFoundation::Data data(reinterpret_cast<const UInt8*>("abc"), 3);
+   });
+   thread.join();
+
+   const CoreFoundation::Instrumentation::Snapshot snapshot =
+      CoreFoundation::Instrumentation::snapshot();
+   ASSERT_EQ(10u, snapshot.count(CFDataGetTypeID(), Event::Create));
+   ASSERT_EQ(10u, snapshot.count(CFDataGetTypeID(), Event::Release));
+   ASSERT_EQ(10u, snapshot.total(Event::Create));
+}
+
+TEST(InstrumentTests, CountsAfterThreadCountersDestroyed)
+{
+   CoreFoundation::Instrumentation::reset();
+   // thread_locals are destroyed in reverse order of construction, so a holder made before
+   // the thread's counters releases its Data after the counters are gone.
+   std::thread thread([]()
+   {
+      static thread_local std::unique_ptr<CoreFoundation::Data> holder;
+      holder.reset(new CoreFoundation::Data(reinterpret_cast<const UInt8*>("abc"), 3));
+   });
+   thread.join();
+
+   const CoreFoundation::Instrumentation::Snapshot snapshot =
+      CoreFoundation::Instrumentation::snapshot();
+   ASSERT_EQ(1u, snapshot.count(CFDataGetTypeID(), Event::Create));
+   ASSERT_EQ(1u, snapshot.count(CFDataGetTypeID(), Event::Release));
+}
+
+TEST(InstrumentTests, TracksLiveObjects)
+{
+   CFTypeRef object;
+   {
+      CoreFoundation::Data data(reinterpret_cast<const UInt8*>("abc"), 3);
+      object = data;
+      ASSERT_TRUE(isLive(object));
+
+      CoreFoundation::Data copy(data);
+      copy = CoreFoundation::Data();
+      ASSERT_TRUE(isLive(object));
+
+      std::ostringstream out;
+      CoreFoundation::Instrumentation::dump(out);
+      ASSERT_NE(std::string::npos, out.str().find("CFData"));
+      ASSERT_NE(std::string::npos, out.str().find("created at"));
+   }
+   ASSERT_FALSE(isLive(object));
+}
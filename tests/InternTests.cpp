@@ -0,0 +1,121 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(InternTests, SameContentSameString)
+{
+   CoreFoundation::StringInternPool pool;
+
+   const char buffer[] = "content-typeXYZ";
+   CoreFoundation::String a = pool.intern("content-type");
+   CoreFoundation::String b = pool.intern(buffer, 12);
+   CoreFoundation::String c = pool.intern(CoreFoundation::String("content-type"));
+   CoreFoundation::String d = pool.intern(std::string("content-length"));
+
+   ASSERT_EQ(static_cast<CFStringRef>(a), static_cast<CFStringRef>(b));
+   ASSERT_EQ(static_cast<CFStringRef>(a), static_cast<CFStringRef>(c));
+   ASSERT_NE(static_cast<CFStringRef>(a), static_cast<CFStringRef>(d));
+   ASSERT_TRUE(a == b);
+   ASSERT_FALSE(a != b);
+   ASSERT_FALSE(a < b);
+   ASSERT_TRUE(a <= b);
+   ASSERT_TRUE(a != d);
+   ASSERT_EQ(std::string("content-type"), a.to_string());
+   ASSERT_EQ(2u, pool.size());
+
+   // Non-ASCII content goes through the UTF-8 conversion.
+   CoreFoundation::String unicode = pool.intern(CoreFoundation::String("caf\xC3\xA9"));
+   ASSERT_EQ(static_cast<CFStringRef>(unicode), static_cast<CFStringRef>(pool.intern("caf\xC3\xA9")));
+}
+
+TEST(InternTests, EmbeddedNul)
+{
+   CoreFoundation::StringInternPool pool;
+
+   const char bytes[] = { 'a', '\0', 'b' };
+   const CoreFoundation::String withNul = CoreFoundation::String::from_bytes(bytes, 3);
+   ASSERT_EQ(std::string(bytes, 3), withNul.to_string());
+
+   CoreFoundation::String interned = pool.intern(withNul);
+   ASSERT_EQ(3, interned.size());
+   ASSERT_EQ(static_cast<CFStringRef>(interned), static_cast<CFStringRef>(pool.intern(bytes, 3)));
+   ASSERT_NE(static_cast<CFStringRef>(interned), static_cast<CFStringRef>(pool.intern("a")));
+
+   // Non-ASCII content with a NUL in it goes through the UTF-8 conversion.
+   const char utf8[] = { '\xC3', '\xA9', '\0', 'b' };
+   const CoreFoundation::String wideWithNul = CoreFoundation::String::from_bytes(utf8, 4);
+   ASSERT_EQ(3, pool.intern(wideWithNul).size());
+   ASSERT_EQ(3u, pool.size());
+}
+
+TEST(InternTests, ConcurrentIntern)
+{
+   CoreFoundation::StringInternPool pool(4);
+   const int kThreads = 8;
+   const int kKeys = 200;
+
+   std::vector<std::vector<CFStringRef>> seen(kThreads);
+   std::vector<std::vector<CoreFoundation::String>> held(kThreads);
+   std::vector<std::thread> threads;
+   for (int t = 0; t < kThreads; ++t)
+   {
+      threads.emplace_back([&pool, &seen, &held, t, kKeys]() {
+         for (int i = 0; i < kKeys; ++i)
+         {
+            CoreFoundation::String s = pool.intern("key-" + std::to_string(i));
+            seen[t].push_back(s);
+            held[t].push_back(s);
+         }
+      });
+   }
+   for (size_t t = 0; t < threads.size(); ++t)
+      threads[t].join();
+
+   ASSERT_EQ(static_cast<size_t>(kKeys), pool.size());
+   for (int t = 1; t < kThreads; ++t)
+      ASSERT_EQ(seen[0], seen[t]);
+}
+
+TEST(InternTests, EvictUnused)
+{
+   CoreFoundation::StringInternPool pool;
+
+   CoreFoundation::String kept = pool.intern("kept");
+   pool.intern("dropped");
+   ASSERT_EQ(2u, pool.size());
+
+   ASSERT_EQ(1u, pool.evict_unused());
+   ASSERT_EQ(1u, pool.size());
+   ASSERT_EQ(static_cast<CFStringRef>(kept), static_cast<CFStringRef>(pool.intern("kept")));
+
+   pool.clear();
+   ASSERT_EQ(0u, pool.size());
+   ASSERT_EQ(std::string("kept"), kept.to_string());
+}
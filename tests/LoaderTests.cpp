@@ -0,0 +1,170 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+
+// A file in the temp directory that is removed again at the end of the test.
+class TemporaryFile
+{
+public:
+   explicit TemporaryFile(const std::string& contents)
+   {
+      char path[] = "/tmp/cfxx-loader-XXXXXX";
+      int fd = ::mkstemp(path);
+      EXPECT_GE(fd, 0);
+      if (!contents.empty())
+      {
+         EXPECT_EQ(static_cast<ssize_t>(contents.size()), ::write(fd, contents.data(), contents.size()));
+      }
+      ::close(fd);
+      m_path = path;
+   }
+
+   ~TemporaryFile()
+   {
+      std::remove(m_path.c_str());
+   }
+
+   const std::string& path() const
+   {
+      return m_path;
+   }
+
+private:
+   std::string m_path;
+};
+
+std::string toString(const CoreFoundation::Data& data)
+{
+   return std::string(data.begin(), data.end());
+}
+
+} // anonymous namespace
+
+TEST(LoaderTests, LoadFutures)
+{
+   std::vector<std::unique_ptr<TemporaryFile>> files;
+   std::vector<std::string> paths;
+   for (int i = 0; i < 50; ++i)
+   {
+      files.emplace_back(new TemporaryFile("file " + std::to_string(i)));
+      paths.push_back(files.back()->path());
+   }
+   paths.push_back("/nonexistent/cfxx/file");
+
+   CoreFoundation::DataLoaderOptions options;
+   options.thread_count = 4;
+   CoreFoundation::DataLoader loader(options);
+   ASSERT_EQ(4u, loader.thread_count());
+
+   std::vector<std::future<CoreFoundation::Data>> results = loader.load(paths);
+   ASSERT_EQ(paths.size(), results.size());
+   for (int i = 0; i < 50; ++i)
+      ASSERT_EQ("file " + std::to_string(i), toString(results[i].get()));
+   ASSERT_THROW(results.back().get(), std::system_error);
+
+   ASSERT_EQ("file 7", toString(loader.load(paths[7]).get()));
+}
+
+TEST(LoaderTests, LoadCallbacks)
+{
+   TemporaryFile small("small");
+   TemporaryFile large("this one is too large");
+
+   std::mutex mutex;
+   std::condition_variable done;
+   std::map<std::string, std::string> loaded;
+   std::map<std::string, int> errors;
+   const CoreFoundation::DataLoader::Callback callback =
+      [&](const std::string& path, CoreFoundation::Data data, std::exception_ptr error) {
+         std::lock_guard<std::mutex> lock(mutex);
+         if (error)
+         {
+            try
+            {
+               std::rethrow_exception(error);
+            }
+            catch (const std::system_error& e)
+            {
+               errors[path] = e.code().value();
+            }
+         }
+         else
+         {
+            loaded[path] = toString(data);
+         }
+         done.notify_one();
+      };
+
+   CoreFoundation::DataLoaderOptions options;
+   options.thread_count = 2;
+   options.max_file_size = 8;
+   {
+      CoreFoundation::DataLoader loader(options);
+      loader.load(std::vector<std::string>{ small.path(), large.path() }, callback);
+      loader.load("/nonexistent/cfxx/file", callback);
+
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&]() { return loaded.size() + errors.size() == 3; });
+   }
+
+   ASSERT_EQ(1u, loaded.size());
+   ASSERT_EQ("small", loaded[small.path()]);
+   ASSERT_EQ(EFBIG, errors[large.path()]);
+   ASSERT_EQ(ENOENT, errors["/nonexistent/cfxx/file"]);
+}
+
+TEST(LoaderTests, DestructorFinishesQueuedLoads)
+{
+   TemporaryFile file("contents");
+   std::vector<std::future<CoreFoundation::Data>> results;
+   {
+      CoreFoundation::DataLoaderOptions options;
+      options.thread_count = 1;
+      CoreFoundation::DataLoader loader(options);
+      results = loader.load(std::vector<std::string>(100, file.path()));
+   }
+   for (std::future<CoreFoundation::Data>& result : results)
+   {
+      ASSERT_EQ(std::future_status::ready, result.wait_for(std::chrono::seconds(0)));
+      ASSERT_EQ("contents", toString(result.get()));
+   }
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <utility>
+
+namespace
+{
+
+CFStringRef createString(const char* s)
+{
+   return CFStringCreateWithCString(kCFAllocatorDefault, s, kCFStringEncodingUTF8);
+}
+
+} // namespace
+
+TEST(ReferenceTests, AdoptDoesNotRetain)
+{
+   CFStringRef raw = createString("foobar");
+   ASSERT_EQ(1, CFGetRetainCount(raw));
+
+   CoreFoundation::CFReference<CFStringRef> ref(raw, CoreFoundation::adopt_reference);
+   ASSERT_EQ(1, ref.use_count());
+
+   CoreFoundation::CFReference<CFStringRef> created =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("baz"));
+   ASSERT_EQ(1, created.use_count());
+}
+
+TEST(ReferenceTests, CopyRetainsMoveDoesNot)
+{
+   CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("foobar"));
+
+   CoreFoundation::CFReference<CFStringRef> copy(ref);
+   ASSERT_EQ(2, ref.use_count());
+
+   CoreFoundation::CFReference<CFStringRef> moved(std::move(copy));
+   ASSERT_TRUE(copy.get() == nullptr);
+   ASSERT_EQ(2, ref.use_count());
+
+   CoreFoundation::CFReference<CFStringRef> assigned;
+   assigned = std::move(moved);
+   ASSERT_TRUE(moved.get() == nullptr);
+   ASSERT_EQ(2, ref.use_count());
+
+   // Converting moves between reference types don't touch the count either.
+   CoreFoundation::CFReference<CFTypeRef> base(std::move(assigned));
+   ASSERT_TRUE(assigned.get() == nullptr);
+   ASSERT_EQ(2, ref.use_count());
+   base = std::move(ref);
+   ASSERT_TRUE(ref.get() == nullptr);
+   ASSERT_EQ(1, base.use_count());
+}
+
+TEST(ReferenceTests, NullReferences)
+{
+   CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("foobar"));
+
+   // None of these may hand a null reference to CFRetain or CFRelease.
+   CoreFoundation::CFReference<CFStringRef> empty;
+   CoreFoundation::CFReference<CFStringRef> copy(empty);
+   CoreFoundation::CFReference<CFStringRef> fromNull(static_cast<CFStringRef>(nullptr));
+   ref = empty;
+   ASSERT_TRUE(ref.get() == nullptr);
+
+   ref = CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("foobar"));
+   ref = std::move(empty);
+   ASSERT_TRUE(ref.get() == nullptr);
+   ASSERT_TRUE(fromNull.get() == nullptr);
+   ASSERT_TRUE(copy.get() == nullptr);
+}
+
+TEST(ReferenceTests, SelfAssignment)
+{
+   CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("foobar"));
+   CoreFoundation::CFReference<CFStringRef>& alias = ref;
+
+   ref = alias;
+   ASSERT_TRUE(ref.get() != nullptr);
+   ASSERT_EQ(1, ref.use_count());
+
+   ref = std::move(alias);
+   ASSERT_TRUE(ref.get() != nullptr);
+   ASSERT_EQ(1, ref.use_count());
+}
+
+TEST(ReferenceTests, Detach)
+{
+   CoreFoundation::CFReference<CFStringRef> ref =
+      CoreFoundation::makeCFReferenceFromCopyOrCreate(createString("foobar"));
+
+   CFStringRef raw = ref.detach();
+   ASSERT_TRUE(ref.get() == nullptr);
+   ASSERT_EQ(1, CFGetRetainCount(raw));
+   CFRelease(raw);
+}
+
+TEST(ReferenceTests, Borrowed)
+{
+   CoreFoundation::String s("foobar");
+   const long count = CFGetRetainCount(s);
+
+   CoreFoundation::CFBorrowed<CFStringRef> borrowed = s.borrow();
+   ASSERT_TRUE(borrowed.get() != nullptr);
+   ASSERT_EQ(static_cast<CFStringRef>(s), borrowed.get());
+   ASSERT_EQ(count, CFGetRetainCount(borrowed));
+
+   {
+      CoreFoundation::CFReference<CFStringRef> owned = borrowed.retain();
+      ASSERT_EQ(count + 1, owned.use_count());
+   }
+   ASSERT_EQ(count, CFGetRetainCount(borrowed));
+
+   CoreFoundation::MutableString m("x");
+   m.append(borrowed);
+   ASSERT_EQ(count, CFGetRetainCount(borrowed));
+   ASSERT_EQ(CoreFoundation::String("xfoobar"), m);
+
+   CoreFoundation::Data d(reinterpret_cast<const UInt8*>("abc"), 3);
+   CoreFoundation::MutableData md(kCFAllocatorDefault);
+   md.append(d.borrow());
+   ASSERT_EQ(3, md.size());
+}
+
+TEST(ReferenceTests, WrappersOwnExactlyOneReference)
+{
+   CoreFoundation::String s("foobar");
+   ASSERT_EQ(1, CFGetRetainCount(s));
+
+   CoreFoundation::Data d(reinterpret_cast<const UInt8*>("abc"), 3);
+   ASSERT_EQ(1, CFGetRetainCount(d));
+
+   CoreFoundation::Data other;
+   other = d;
+   ASSERT_EQ(2, CFGetRetainCount(d));
+   other = std::move(d);
+   ASSERT_EQ(1, CFGetRetainCount(other));
+   ASSERT_EQ(3, other.size());
+}
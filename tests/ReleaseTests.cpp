@@ -0,0 +1,203 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+namespace
+{
+
+// Counts its own destruction. Used as the owner of a CFAllocator, so that we can tell
+// exactly when CF destroys that allocator.
+struct Tracker
+{
+   explicit Tracker(std::atomic<int>& destroyed) :
+      m_destroyed(destroyed)
+   { }
+
+   ~Tracker()
+   {
+      ++m_destroyed;
+   }
+
+   std::atomic<int>& m_destroyed;
+};
+
+CoreFoundation::CFReference<CFAllocatorRef> makeTracked(std::atomic<int>& destroyed)
+{
+   return CoreFoundation::makeOwningDeallocator(new Tracker(destroyed));
+}
+
+CoreFoundation::DeferredReleaseOptions withoutReclaimer()
+{
+   CoreFoundation::DeferredReleaseOptions options;
+   options.background_thread = false;
+   return options;
+}
+
+} // namespace
+
+TEST(ReleaseTests, DrainReleasesQueuedObjects)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredRelease::enable(withoutReclaimer());
+   ASSERT_TRUE(CoreFoundation::DeferredRelease::enabled());
+   const CoreFoundation::DeferredReleaseStats before = CoreFoundation::DeferredRelease::stats();
+
+   {
+      CoreFoundation::CFReference<CFAllocatorRef> ref = makeTracked(destroyed);
+   }
+   ASSERT_EQ(0, destroyed.load());
+   ASSERT_EQ(1u, CoreFoundation::DeferredRelease::stats().pending() - before.pending());
+
+   ASSERT_EQ(1u, CoreFoundation::DeferredRelease::drain());
+   ASSERT_EQ(1, destroyed.load());
+   ASSERT_EQ(before.pending(), CoreFoundation::DeferredRelease::stats().pending());
+
+   CoreFoundation::DeferredRelease::disable();
+   ASSERT_FALSE(CoreFoundation::DeferredRelease::enabled());
+}
+
+TEST(ReleaseTests, OnlyLastReferenceIsDeferred)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredRelease::enable(withoutReclaimer());
+   const uint64_t deferred = CoreFoundation::DeferredRelease::stats().deferred;
+
+   CoreFoundation::CFReference<CFAllocatorRef> ref = makeTracked(destroyed);
+   {
+      CoreFoundation::CFReference<CFAllocatorRef> copy(ref);
+   }
+   ASSERT_EQ(1, ref.use_count());
+   ASSERT_EQ(deferred, CoreFoundation::DeferredRelease::stats().deferred);
+
+   ref.release();
+   ASSERT_EQ(deferred + 1, CoreFoundation::DeferredRelease::stats().deferred);
+   ASSERT_EQ(0, destroyed.load());
+
+   CoreFoundation::DeferredRelease::disable();
+   ASSERT_EQ(1, destroyed.load());
+}
+
+TEST(ReleaseTests, BackgroundReclaimer)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredReleaseOptions options;
+   options.interval = std::chrono::milliseconds(1);
+   CoreFoundation::DeferredRelease::enable(options);
+
+   for (int i = 0; i < 10; ++i)
+      makeTracked(destroyed);
+
+   for (int i = 0; i < 5000 && destroyed.load() != 10; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   ASSERT_EQ(10, destroyed.load());
+
+   CoreFoundation::DeferredRelease::disable();
+}
+
+TEST(ReleaseTests, FullQueueReleasesInline)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredReleaseOptions options = withoutReclaimer();
+   options.queue_capacity = 3;
+   CoreFoundation::DeferredRelease::enable(options);
+   const CoreFoundation::DeferredReleaseStats before = CoreFoundation::DeferredRelease::stats();
+
+   // Queue capacity only applies to new queues, so use a new thread. Its queue gets
+   // released when the thread exits.
+   int destroyedWhileRunning = -1;
+   std::thread thread([&]()
+   {
+      for (int i = 0; i < 10; ++i)
+         makeTracked(destroyed);
+      destroyedWhileRunning = destroyed.load();
+   });
+   thread.join();
+
+   // Rounded up to 4 slots, so 4 queued and 6 released straight away.
+   ASSERT_EQ(6, destroyedWhileRunning);
+   ASSERT_EQ(10, destroyed.load());
+
+   const CoreFoundation::DeferredReleaseStats after = CoreFoundation::DeferredRelease::stats();
+   ASSERT_EQ(4u, after.deferred - before.deferred);
+   ASSERT_EQ(6u, after.released_inline - before.released_inline);
+   ASSERT_EQ(before.pending(), after.pending());
+
+   CoreFoundation::DeferredRelease::disable();
+}
+
+TEST(ReleaseTests, ManyThreads)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredReleaseOptions options;
+   options.queue_capacity = 16;
+   options.batch_size = 4;
+   options.backpressure = CoreFoundation::ReleaseBackpressure::Wait;
+   CoreFoundation::DeferredRelease::enable(options);
+   const uint64_t releasedInline = CoreFoundation::DeferredRelease::stats().released_inline;
+
+   std::thread threads[4];
+   for (std::thread& thread : threads)
+   {
+      thread = std::thread([&]()
+      {
+         for (int i = 0; i < 500; ++i)
+         {
+            CoreFoundation::CFReference<CFAllocatorRef> ref = makeTracked(destroyed);
+            CoreFoundation::CFReference<CFAllocatorRef> other = std::move(ref);
+         }
+      });
+   }
+   for (std::thread& thread : threads)
+      thread.join();
+
+   CoreFoundation::DeferredRelease::disable();
+   ASSERT_EQ(2000, destroyed.load());
+   ASSERT_EQ(releasedInline, CoreFoundation::DeferredRelease::stats().released_inline);
+}
+
+TEST(ReleaseTests, ReleaseAfterQueueDestroyed)
+{
+   std::atomic<int> destroyed(0);
+   CoreFoundation::DeferredRelease::enable(withoutReclaimer());
+
+   // thread_locals are destroyed in reverse order of construction, so a holder made before
+   // the thread's queue lets go of its object after the queue is gone.
+   std::thread thread([&]()
+   {
+      static thread_local CoreFoundation::CFReference<CFAllocatorRef> holder;
+      holder = makeTracked(destroyed);
+      makeTracked(destroyed);
+   });
+   thread.join();
+   ASSERT_EQ(2, destroyed.load());
+
+   CoreFoundation::DeferredRelease::disable();
+}
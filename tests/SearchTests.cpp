@@ -0,0 +1,243 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+CoreFoundation::DataView makeView(const std::string& s)
+{
+   return CoreFoundation::DataView(reinterpret_cast<const UInt8*>(s.data()), s.size());
+}
+
+std::string toString(const CoreFoundation::DataView& view)
+{
+   return std::string(reinterpret_cast<const char*>(view.data()), view.size());
+}
+
+std::vector<std::string> fields(const CoreFoundation::DataSplit& split)
+{
+   std::vector<std::string> result;
+   for (const CoreFoundation::DataView& field : split)
+      result.push_back(toString(field));
+   return result;
+}
+
+// Mostly 'a's and 'b's, so that partial matches are everywhere.
+std::string makeText(size_t n)
+{
+   std::string text(n, 'a');
+   uint32_t state = 12345;
+   for (size_t i = 0; i < n; ++i)
+   {
+      state = state * 1103515245 + 12345;
+      if ((state >> 16) % 3 == 0)
+         text[i] = 'b';
+   }
+   return text;
+}
+
+CFIndex expectedFind(const std::string& s, const std::string& pattern, size_t from)
+{
+   const size_t found = s.find(pattern, from);
+   return found == std::string::npos ? kCFNotFound : static_cast<CFIndex>(found);
+}
+
+CFIndex expectedRFind(const std::string& s, const std::string& pattern, size_t from)
+{
+   const size_t found = s.rfind(pattern, from);
+   return found == std::string::npos ? kCFNotFound : static_cast<CFIndex>(found);
+}
+
+} // anonymous namespace
+
+TEST(SearchTests, FindByte)
+{
+   const std::string s = "hello, world";
+   const CoreFoundation::DataView view = makeView(s);
+
+   ASSERT_EQ(4, view.find('o'));
+   ASSERT_EQ(8, view.find('o', 5));
+   ASSERT_EQ(kCFNotFound, view.find('o', 9));
+   ASSERT_EQ(kCFNotFound, view.find('z'));
+   ASSERT_EQ(kCFNotFound, view.find('h', 100));
+   ASSERT_EQ(0, view.find('h', -5));
+   ASSERT_EQ(kCFNotFound, CoreFoundation::DataView().find('h'));
+
+   ASSERT_EQ(8, view.rfind('o'));
+   ASSERT_EQ(4, view.rfind('o', 7));
+   ASSERT_EQ(4, view.rfind('o', 4));
+   ASSERT_EQ(kCFNotFound, view.rfind('o', 3));
+   ASSERT_EQ(kCFNotFound, CoreFoundation::DataView().rfind('h'));
+}
+
+TEST(SearchTests, FindByteLong)
+{
+   // Long enough for the vector loops, with the byte in every position of a block.
+   for (size_t n = 0; n < 100; ++n)
+   {
+      for (size_t at = 0; at < n; ++at)
+      {
+         std::string s(n, 'x');
+         s[at] = 'y';
+         ASSERT_EQ(static_cast<CFIndex>(at), makeView(s).find('y'));
+         ASSERT_EQ(static_cast<CFIndex>(at), makeView(s).rfind('y'));
+      }
+   }
+}
+
+TEST(SearchTests, FindPattern)
+{
+   const std::string s = "the cat sat on the mat";
+   const CoreFoundation::DataView view = makeView(s);
+
+   ASSERT_EQ(0, view.find(makeView("the")));
+   ASSERT_EQ(15, view.find(makeView("the"), 1));
+   ASSERT_EQ(4, view.find(makeView("cat")));
+   ASSERT_EQ(19, view.find(makeView("mat")));
+   ASSERT_EQ(kCFNotFound, view.find(makeView("dog")));
+   ASSERT_EQ(kCFNotFound, view.find(makeView("mat!")));
+   ASSERT_EQ(kCFNotFound, view.find(makeView(s + s)));
+   ASSERT_EQ(0, view.find(makeView(s)));
+   ASSERT_EQ(3, view.find(makeView(""), 3));
+   ASSERT_EQ(kCFNotFound, view.find(makeView(""), 100));
+
+   ASSERT_EQ(15, view.rfind(makeView("the")));
+   ASSERT_EQ(0, view.rfind(makeView("the"), 14));
+   ASSERT_EQ(15, view.rfind(makeView("the"), 15));
+   ASSERT_EQ(kCFNotFound, view.rfind(makeView("dog")));
+   ASSERT_EQ(22, view.rfind(makeView("")));
+   ASSERT_EQ(0, view.rfind(makeView(s)));
+}
+
+TEST(SearchTests, FindPatternMatchesStdString)
+{
+   const std::string text = makeText(3000);
+   const CoreFoundation::DataView view = makeView(text);
+
+   // Short patterns, and ones long enough to go through Horspool's algorithm, taken
+   // from the text so that they're found, and altered so that they mostly aren't.
+   for (size_t length : { 2, 3, 5, 8, 16, 17, 31, 32, 33, 64, 100 })
+   {
+      for (size_t at : { 0, 1, 100, 1234, 2999 - 100 })
+      {
+         std::string pattern = text.substr(at, length);
+         for (int altered = 0; altered < 2; ++altered)
+         {
+            for (size_t from : { 0, 1, 50, 1500 })
+            {
+               ASSERT_EQ(expectedFind(text, pattern, from), view.find(makeView(pattern), from));
+               ASSERT_EQ(expectedRFind(text, pattern, from), view.rfind(makeView(pattern), from));
+            }
+            ASSERT_EQ(expectedRFind(text, pattern, std::string::npos), view.rfind(makeView(pattern)));
+            pattern[length / 2] = 'c';
+         }
+      }
+   }
+}
+
+TEST(SearchTests, FindFirstOf)
+{
+   const std::string s = "key = value; other=thing\r\n";
+   const CoreFoundation::DataView view = makeView(s);
+
+   ASSERT_EQ(4, view.find_first_of(makeView("=;")));
+   ASSERT_EQ(11, view.find_first_of(makeView("=;"), 5));
+   ASSERT_EQ(24, view.find_first_of(makeView("\r\n")));
+   ASSERT_EQ(kCFNotFound, view.find_first_of(makeView("!?")));
+   ASSERT_EQ(kCFNotFound, view.find_first_of(makeView("")));
+   ASSERT_EQ(1, view.find_first_of(makeView("e")));
+
+   ASSERT_EQ(3, view.find_first_not_of(makeView("abcdefghijklmnopqrstuvwxyz")));
+   ASSERT_EQ(6, view.find_first_not_of(makeView(" ="), 3));
+   ASSERT_EQ(0, view.find_first_not_of(makeView("")));
+   ASSERT_EQ(kCFNotFound, makeView("   ").find_first_not_of(makeView(" ")));
+
+   // Small sets are compared against a block at a time; big ones are looked up.
+   const std::string text = makeText(1000) + "0123456789";
+   ASSERT_EQ(1000, makeView(text).find_first_of(makeView("9:0")));
+   ASSERT_EQ(1008, makeView(text).find_first_of(makeView("x9y8")));
+   ASSERT_EQ(1000, makeView(text).find_first_of(makeView("0123456789")));
+   ASSERT_EQ(1003, makeView(text).find_first_of(makeView("9876543")));
+}
+
+TEST(SearchTests, Split)
+{
+   ASSERT_EQ((std::vector<std::string>{ "a", "b", "c" }), fields(makeView("a,b,c").split(',')));
+   ASSERT_EQ((std::vector<std::string>{ "", "a", "", "b", "" }), fields(makeView(",a,,b,").split(',')));
+   ASSERT_EQ((std::vector<std::string>{ "abc" }), fields(makeView("abc").split(',')));
+   ASSERT_EQ((std::vector<std::string>{ "" }), fields(makeView("").split(',')));
+   ASSERT_EQ((std::vector<std::string>{ "" }), fields(CoreFoundation::DataView().split(',')));
+
+   ASSERT_EQ((std::vector<std::string>{ "GET / HTTP/1.1", "Host: x", "", "body" }),
+      fields(makeView("GET / HTTP/1.1\r\nHost: x\r\n\r\nbody").split(makeView("\r\n"))));
+   ASSERT_EQ((std::vector<std::string>{ "a", "", "b", "" }), fields(makeView("a----b--").split(makeView("--"))));
+   ASSERT_THROW(makeView("abc").split(makeView("")), std::invalid_argument);
+
+   // The fields are views of the original bytes.
+   const std::string s = "one two";
+   const CoreFoundation::DataSplit split = makeView(s).split(' ');
+   CoreFoundation::DataSplit::const_iterator it = split.begin();
+   ASSERT_EQ(reinterpret_cast<const UInt8*>(s.data()), it->data());
+   ++it;
+   ASSERT_EQ(reinterpret_cast<const UInt8*>(s.data()) + 4, it->data());
+   ASSERT_TRUE(++it == split.end());
+}
+
+TEST(SearchTests, Tokenize)
+{
+   ASSERT_EQ((std::vector<std::string>{ "a", "b", "c" }), fields(makeView("  a b\t\tc  ").tokenize(makeView(" \t"))));
+   ASSERT_EQ((std::vector<std::string>{ "abc" }), fields(makeView("abc").tokenize(makeView(" "))));
+   ASSERT_EQ((std::vector<std::string>{ "abc" }), fields(makeView("abc").tokenize(makeView(""))));
+   ASSERT_TRUE(fields(makeView("   ").tokenize(makeView(" "))).empty());
+   ASSERT_TRUE(fields(makeView("").tokenize(makeView(" "))).empty());
+}
+
+TEST(SearchTests, Data)
+{
+   const std::string s = "k1=v1&k2=v2&flag";
+   const CoreFoundation::Data data(reinterpret_cast<const UInt8*>(s.data()), s.size());
+
+   ASSERT_EQ(2, data.find('='));
+   ASSERT_EQ(8, data.rfind('='));
+   ASSERT_EQ(6, data.find(makeView("k2")));
+   ASSERT_EQ(kCFNotFound, data.rfind(makeView("k3")));
+   ASSERT_EQ(5, data.find_first_of(makeView("&;")));
+   ASSERT_EQ(2, data.find_first_not_of(makeView("k1")));
+
+   ASSERT_EQ((std::vector<std::string>{ "k1=v1", "k2=v2", "flag" }), fields(data.split('&')));
+   ASSERT_EQ((std::vector<std::string>{ "k1=v1", "k2=v2", "flag" }), fields(data.split(makeView("&"))));
+   ASSERT_EQ((std::vector<std::string>{ "k1", "v1", "k2", "v2", "flag" }), fields(data.tokenize(makeView("&="))));
+
+   const std::vector<std::string> expected = { "k1=v1", "k2=v2", "flag" };
+   const CoreFoundation::DataSplit split = data.split('&');
+   ASSERT_EQ(3, std::distance(split.begin(), split.end()));
+   ASSERT_TRUE(std::equal(expected.begin(), expected.end(), split.begin(),
+      [](const std::string& a, const CoreFoundation::DataView& b) { return a == toString(b); }));
+}
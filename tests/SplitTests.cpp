@@ -0,0 +1,164 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+template<typename Range>
+std::vector<std::string> fields(const Range& range)
+{
+   std::vector<std::string> result;
+   for (const CoreFoundation::StringView& field : range)
+      result.push_back(field.to_string());
+   return result;
+}
+
+bool isSpace(UniChar c)
+{
+   return c == ' ' || c == '\t';
+}
+
+} // anonymous namespace
+
+TEST(SplitTests, Split)
+{
+   const CoreFoundation::String csv = "a,b,,c,";
+   ASSERT_EQ((std::vector<std::string>{ "a", "b", "", "c", "" }), fields(csv.split(",")));
+
+   const CoreFoundation::String headers = "Accept: */*\r\nHost: example.com\r\n\r\nbody";
+   ASSERT_EQ((std::vector<std::string>{ "Accept: */*", "Host: example.com", "", "body" }),
+      fields(headers.split("\r\n")));
+
+   ASSERT_EQ((std::vector<std::string>{ "no delimiter" }), fields(CoreFoundation::String("no delimiter").split(",")));
+   ASSERT_EQ((std::vector<std::string>{ "" }), fields(CoreFoundation::String("").split(",")));
+   ASSERT_EQ((std::vector<std::string>{ "a", "", "b" }), fields(CoreFoundation::String("a----b").split("--")));
+   ASSERT_THROW(csv.split(""), std::invalid_argument);
+}
+
+TEST(SplitTests, SplitEveryStorage)
+{
+   // 8-bit, UTF-16, mutable and external strings, long enough that the ones CF copies out
+   // take several blocks, with the delimiters straddling the block boundaries.
+   std::string text;
+   std::vector<std::string> expected;
+   for (int i = 0; i < 500; ++i)
+   {
+      const std::string field = std::string(static_cast<size_t>(i % 7), 'x') + std::to_string(i);
+      expected.push_back(field);
+      text += field;
+      if (i != 499)
+         text += "::";
+   }
+   const std::string unicodeText = text + "::caf\xC3\xA9";
+   std::vector<std::string> unicodeExpected = expected;
+   unicodeExpected.push_back("caf\xC3\xA9");
+
+   const CoreFoundation::String narrow(text);
+   const CoreFoundation::MutableString mutableString(text.c_str());
+   const CoreFoundation::String external = CoreFoundation::String::with_bytes_no_copy(
+      text.data(), text.size(), kCFStringEncodingASCII, kCFAllocatorNull);
+   const CoreFoundation::String wide(unicodeText);
+   const CoreFoundation::MutableString mutableWide(unicodeText.c_str());
+
+   ASSERT_EQ(expected, fields(narrow.split("::")));
+   ASSERT_EQ(expected, fields(mutableString.split("::")));
+   ASSERT_EQ(expected, fields(external.split("::")));
+   ASSERT_EQ(expected, fields(narrow.split(CoreFoundation::MutableString("::"))));
+   ASSERT_EQ(unicodeExpected, fields(wide.split("::")));
+   ASSERT_EQ(unicodeExpected, fields(mutableWide.split("::")));
+
+   // A non-ASCII delimiter can't be in an 8-bit string.
+   ASSERT_EQ(std::vector<std::string>{ text }, fields(narrow.split("\xC3\xA9")));
+   ASSERT_EQ((std::vector<std::string>{ text + "::caf", "" }), fields(wide.split("\xC3\xA9")));
+   ASSERT_EQ((std::vector<std::string>{ text + "::caf", "" }), fields(mutableWide.split("\xC3\xA9")));
+}
+
+TEST(SplitTests, SplitWithLongDelimiter)
+{
+   // Longer than the blocks that a mutable string is searched in.
+   const std::string delimiter(1500, '-');
+   const std::string text = "first" + delimiter + "second" + delimiter + "third";
+   const CoreFoundation::MutableString mutableString(text.c_str());
+   const CoreFoundation::String narrow(text);
+
+   const std::vector<std::string> expected = { "first", "second", "third" };
+   ASSERT_EQ(expected, fields(mutableString.split(CoreFoundation::String(delimiter))));
+   ASSERT_EQ(expected, fields(narrow.split(CoreFoundation::String(delimiter))));
+}
+
+TEST(SplitTests, Tokenize)
+{
+   const CoreFoundation::String str = "  alpha beta\t\tgamma  ";
+   ASSERT_EQ((std::vector<std::string>{ "alpha", "beta", "gamma" }), fields(str.tokenize(isSpace)));
+
+   const CoreFoundation::MutableString mutableString(" x  y z ");
+   ASSERT_EQ((std::vector<std::string>{ "x", "y", "z" }),
+      fields(mutableString.tokenize([](UniChar c) { return c == ' '; })));
+
+   ASSERT_TRUE(fields(CoreFoundation::String("   ").tokenize(isSpace)).empty());
+   ASSERT_TRUE(fields(CoreFoundation::String("").tokenize(isSpace)).empty());
+   ASSERT_EQ((std::vector<std::string>{ "caf\xC3\xA9", "na\xC3\xAFve" }),
+      fields(CoreFoundation::String("caf\xC3\xA9 na\xC3\xAFve").tokenize(isSpace)));
+
+   // Tokens straddling the blocks of a string CF copies out.
+   std::string text;
+   for (int i = 0; i < 1000; ++i)
+      text += std::to_string(i) + (i % 3 ? " " : "\t ");
+   CoreFoundation::MutableString longString(text.c_str());
+   const std::vector<std::string> tokens = fields(longString.tokenize(isSpace));
+   ASSERT_EQ(1000u, tokens.size());
+   ASSERT_EQ("999", tokens.back());
+}
+
+TEST(SplitTests, StringView)
+{
+   const CoreFoundation::String str = "key=w\xC3\xB6rd";
+   const CoreFoundation::StringSplit split = str.split("=");
+   CoreFoundation::StringSplit::const_iterator it = split.begin();
+
+   ASSERT_EQ(0, it->offset());
+   ASSERT_EQ(3, it->length());
+   ASSERT_EQ(static_cast<UniChar>('e'), (*it)[1]);
+   ASSERT_EQ(CoreFoundation::String("key"), it->str());
+
+   ++it;
+   ASSERT_EQ(4, it->offset());
+   ASSERT_EQ(4, it->size());
+   ASSERT_EQ(static_cast<UniChar>(0x00F6), (*it)[1]);
+   ASSERT_EQ(CoreFoundation::String("w\xC3\xB6rd"), it->str());
+   ASSERT_EQ(std::string("w\xC3\xB6rd"), it->to_string());
+
+   ASSERT_TRUE(++it == split.end());
+   ASSERT_EQ(2, std::distance(split.begin(), split.end()));
+
+   ASSERT_TRUE(CoreFoundation::StringView().empty());
+   ASSERT_TRUE(CoreFoundation::StringView().str().empty());
+   ASSERT_EQ(std::string(), CoreFoundation::StringView().to_string());
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+TEST(StreamTests, RoundTrip)
+{
+   CoreFoundation::MutableData data;
+   const UInt8 prefix[] = { 0xde, 0xad };
+   data.append(prefix, sizeof(prefix));
+   {
+      CoreFoundation::DataWriter writer(data);
+      writer.write_byte(7)
+         .write_le<uint16_t>(0x1234)
+         .write_be<uint32_t>(0x89abcdef)
+         .write_le<int64_t>(-2)
+         .write_be<double>(3.25)
+         .write_le<float>(-0.5f)
+         .write_varint(0)
+         .write_varint(300)
+         .write_varint(std::numeric_limits<uint64_t>::max())
+         .write_zigzag(-1)
+         .write_zigzag(std::numeric_limits<int64_t>::min())
+         .write_length_prefixed("hello", 5)
+         .write_length_prefixed(nullptr, 0);
+      ASSERT_EQ(2u + 1 + 2 + 4 + 8 + 8 + 4 + 1 + 2 + 10 + 1 + 10 + 6 + 1, writer.position());
+   }
+   ASSERT_EQ(60, data.size());
+
+   CoreFoundation::DataReader reader(data);
+   ASSERT_EQ(0xde, reader.read_byte());
+   ASSERT_EQ(0xad, reader.read_byte());
+   ASSERT_EQ(7, reader.read_byte());
+   ASSERT_EQ(0x1234, reader.read_le<uint16_t>());
+   ASSERT_EQ(0x89abcdefu, reader.read_be<uint32_t>());
+   ASSERT_EQ(-2, reader.read_le<int64_t>());
+   ASSERT_EQ(3.25, reader.read_be<double>());
+   ASSERT_EQ(-0.5f, reader.read_le<float>());
+   ASSERT_EQ(0u, reader.read_varint());
+   ASSERT_EQ(300u, reader.read_varint());
+   ASSERT_EQ(std::numeric_limits<uint64_t>::max(), reader.read_varint());
+   ASSERT_EQ(-1, reader.read_zigzag());
+   ASSERT_EQ(std::numeric_limits<int64_t>::min(), reader.read_zigzag());
+
+   const CoreFoundation::DataView hello = reader.read_length_prefixed();
+   ASSERT_EQ("hello", std::string(hello.begin(), hello.end()));
+   // Points into the data rather than at a copy.
+   ASSERT_TRUE(hello.data() > data.data() && hello.data() < data.data() + data.size());
+   ASSERT_TRUE(reader.read_length_prefixed().empty());
+   ASSERT_TRUE(reader.at_end());
+}
+
+TEST(StreamTests, ByteOrder)
+{
+   CoreFoundation::MutableData data;
+   CoreFoundation::DataWriter writer(data);
+   writer.write_le<uint32_t>(0x01020304).write_be<uint32_t>(0x01020304);
+   writer.finish();
+
+   const UInt8 expected[] = { 4, 3, 2, 1, 1, 2, 3, 4 };
+   ASSERT_TRUE(CoreFoundation::Data(expected, sizeof(expected)) == data);
+}
+
+TEST(StreamTests, WriterGrowsData)
+{
+   CoreFoundation::MutableData data;
+   {
+      CoreFoundation::DataWriter writer(data);
+      writer.write_varint(0);
+      // The writer works in the data's spare capacity, all of which it has taken over.
+      ASSERT_EQ(data.capacity(), data.size());
+      ASSERT_LE(64, data.size());
+      for (uint32_t i = 1; i < 100000; ++i)
+         writer.write_varint(i);
+      ASSERT_EQ(data.capacity(), data.size());
+   }
+
+   CoreFoundation::DataReader reader(data);
+   for (uint32_t i = 0; i < 100000; ++i)
+      ASSERT_EQ(i, reader.read_varint());
+   ASSERT_TRUE(reader.at_end());
+}
+
+TEST(StreamTests, ReaderBounds)
+{
+   const UInt8 bytes[] = { 0x80, 0x80, 0x05, 0xff };
+   CoreFoundation::DataReader reader(bytes, sizeof(bytes));
+   ASSERT_EQ(5u << 14, reader.read_varint());
+   ASSERT_THROW(reader.read_le<uint16_t>(), std::out_of_range);
+   // A failed read doesn't consume anything.
+   ASSERT_EQ(1u, reader.remaining());
+   ASSERT_THROW(reader.read_varint(), std::out_of_range);
+   ASSERT_THROW(reader.read_bytes(2), std::out_of_range);
+
+   const UInt8 tooLong[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 };
+   CoreFoundation::DataReader overlong(tooLong, sizeof(tooLong));
+   ASSERT_THROW(overlong.read_varint(), std::overflow_error);
+
+   const UInt8 truncated[] = { 0x05, 'a', 'b' };
+   CoreFoundation::DataReader prefixed(truncated, sizeof(truncated));
+   ASSERT_THROW(prefixed.read_length_prefixed(), std::out_of_range);
+}
+
+TEST(StreamTests, StreamBufs)
+{
+   CoreFoundation::MutableData data;
+   {
+      CoreFoundation::MutableDataStreamBuf buf(data);
+      std::ostream out(&buf);
+      out << "answer=" << 42 << ' ';
+      out.write(std::string(5000, 'x').data(), 5000);
+      ASSERT_EQ(5010, out.tellp());
+   }
+   ASSERT_EQ(5010, data.size());
+
+   CoreFoundation::DataStreamBuf buf(data);
+   std::istream in(&buf);
+   std::string key;
+   std::getline(in, key, '=');
+   int value = 0;
+   in >> value;
+   ASSERT_EQ("answer", key);
+   ASSERT_EQ(42, value);
+   in.seekg(-1, std::ios_base::end);
+   ASSERT_EQ('x', in.get());
+   in.seekg(0);
+   ASSERT_EQ('a', in.get());
+}
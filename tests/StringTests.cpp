@@ -25,6 +25,10 @@
 #include "gtest/gtest.h"
 #include "cfxx/cfxx.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 TEST(StringTests, StringConstructor)
 {
    CoreFoundation::String str1 = "foobar";
@@ -165,3 +169,446 @@ TEST(StringTests, MutableStringAppend)
    ASSERT_EQ(foobar, b);
 }
 
+
+TEST(StringTests, CopiedStringIndex)
+{
+   const char* testString = "Sed cursus ante dapibus diam. Sed nisi. Nulla quis sem at nibh "
+      "elementum imperdiet. Duis sagittis ipsum. Praesent mauris.";
+
+   CoreFoundation::String original = testString;
+   ASSERT_EQ(static_cast<UniChar>('S'), original[0]);
+
+   CoreFoundation::String copy(original);
+   CoreFoundation::String assigned;
+   assigned = original;
+
+   for (size_t i = 0; testString[i]; ++i)
+   {
+      ASSERT_EQ(static_cast<UniChar>(testString[i]), copy[i]);
+      ASSERT_EQ(static_cast<UniChar>(testString[i]), assigned.at(i));
+   }
+}
+
+TEST(StringTests, MutableStringIndexAfterAppend)
+{
+   CoreFoundation::MutableString str = "foo";
+   ASSERT_EQ(static_cast<UniChar>('o'), str[2]);
+   ASSERT_THROW(str.at(3), std::out_of_range);
+
+   str.append("bar");
+
+   ASSERT_EQ(static_cast<UniChar>('b'), str[3]);
+   ASSERT_EQ(static_cast<UniChar>('r'), str.at(5));
+}
+
+TEST(StringTests, ForEachChunk)
+{
+   const char* testString =
+      "Praesent libero. Sed cursus ante dapibus diam. Sed nisi. Nulla quis sem at nibh "
+      "elementum imperdiet. Duis sagittis ipsum. Praesent mauris. Fusce nec tellus sed "
+      "augue semper porta. Mauris massa. Vestibulum lacinia arcu eget nulla.";
+   const char* unicodeTestString =
+      "Pr\xC3\xA6sent l\xC3\xAD" "bero. S\xC3\xA9" "d cursus \xE2\x82\xAC" " ante dapibus diam.";
+
+   CoreFoundation::String immutableString = testString;
+   CoreFoundation::String unicodeString = unicodeTestString;
+   CoreFoundation::MutableString mutableString = testString;
+
+   // Whatever storage CF picked, and whatever the buffer size, the chunks should put
+   // the whole string back together.
+   const CoreFoundation::String* strings[] = { &immutableString, &unicodeString, &mutableString };
+   for (const CoreFoundation::String* str : strings)
+   {
+      std::u16string expected;
+      for (UniChar c : *str)
+         expected.push_back(c);
+
+      std::u16string reassembled;
+      ASSERT_TRUE(str->for_each_chunk([&](const UniChar* chars, CFIndex count) {
+         reassembled.append(chars, chars + count);
+      }));
+      ASSERT_EQ(expected, reassembled);
+
+      UniChar buffer[7];
+      reassembled.clear();
+      ASSERT_TRUE(str->for_each_chunk(buffer, 7, [&](const UniChar* chars, CFIndex count) {
+         reassembled.append(chars, chars + count);
+      }));
+      ASSERT_EQ(expected, reassembled);
+   }
+}
+
+TEST(StringTests, ForEachChunkStopsEarly)
+{
+   CoreFoundation::MutableString str = "abcdefghijklmnopqrstuvwxyz";
+
+   UniChar buffer[4];
+   int calls = 0;
+   const bool completed = str.for_each_chunk(buffer, 4, [&](const UniChar* chars, CFIndex count) {
+      ++calls;
+      return std::find(chars, chars + count, 'f') == chars + count;
+   });
+
+   ASSERT_FALSE(completed);
+   ASSERT_EQ(2, calls);
+
+   // A buffer with no room would never make progress.
+   const auto ignore = [](const UniChar*, CFIndex) {};
+   ASSERT_THROW(str.for_each_chunk(buffer, 0, ignore), std::invalid_argument);
+   ASSERT_THROW(str.for_each_chunk(buffer, -1, ignore), std::invalid_argument);
+}
+
+TEST(StringTests, ConstructFromBytesAndLength)
+{
+   // Not NUL-terminated where the String ends.
+   const char buffer[] = "foobarbaz";
+
+   CoreFoundation::String str = CoreFoundation::String::from_bytes(buffer, 6);
+   ASSERT_EQ(6, str.size());
+   ASSERT_EQ(std::string("foobar"), str.to_string());
+
+   // Any integer type works for the length.
+   const size_t sizeLength = 3;
+   const int intLength = 9;
+   ASSERT_EQ(std::string("foo"), CoreFoundation::String::from_bytes(buffer, sizeLength).to_string());
+   ASSERT_EQ(std::string("foobarbaz"), CoreFoundation::String::from_bytes(buffer, intLength).to_string());
+   const std::string latin1 = "caf\xE9";
+   const CoreFoundation::String fromLatin1 =
+      CoreFoundation::String::from_bytes(latin1.data(), latin1.size(), kCFStringEncodingISOLatin1);
+   ASSERT_EQ(4, fromLatin1.size());
+   ASSERT_EQ(static_cast<UniChar>(0xE9), fromLatin1[3]);
+
+   const std::string stdString = "caf\xC3\xA9";
+   CoreFoundation::String fromStdString(stdString);
+   ASSERT_EQ(4, fromStdString.size());
+   ASSERT_EQ(stdString, fromStdString.to_string());
+}
+
+TEST(StringTests, ConstructByAdoptingStdString)
+{
+   std::string shortString = "short";
+   CoreFoundation::String fromShort(std::move(shortString));
+   ASSERT_EQ(std::string("short"), fromShort.to_string());
+
+   std::string asciiPayload(100000, 'x');
+   asciiPayload[50000] = 'y';
+   const std::string expectedAscii = asciiPayload;
+   CoreFoundation::String fromAscii(std::move(asciiPayload));
+   ASSERT_EQ(static_cast<CFIndex>(expectedAscii.size()), fromAscii.size());
+   ASSERT_EQ(static_cast<UniChar>('y'), fromAscii[50000]);
+   ASSERT_EQ(expectedAscii, fromAscii.to_string());
+
+   // CF has to convert this one, so it will free the adopted buffer right away.
+   std::string unicodePayload;
+   for (int i = 0; i < 1000; ++i)
+      unicodePayload += "caf\xC3\xA9 ";
+   const std::string expectedUnicode = unicodePayload;
+   CoreFoundation::String fromUnicode(std::move(unicodePayload));
+   ASSERT_EQ(expectedUnicode, fromUnicode.to_string());
+
+   CoreFoundation::String copy(fromAscii);
+   fromAscii = CoreFoundation::String();
+   ASSERT_EQ(expectedAscii, copy.to_string());
+}
+
+TEST(StringTests, WithBytesNoCopy)
+{
+   static const char bytes[] = "no copies here";
+
+   CoreFoundation::String str = CoreFoundation::String::with_bytes_no_copy(bytes, 9);
+   ASSERT_EQ(std::string("no copies"), str.to_string());
+}
+
+TEST(StringTests, WrapExistingCFString)
+{
+   CFStringRef raw = CFStringCreateWithCString(kCFAllocatorDefault, "wrapped", kCFStringEncodingUTF8);
+   {
+      CoreFoundation::String str(raw);
+      ASSERT_EQ(raw, static_cast<CFStringRef>(str));
+      ASSERT_EQ(std::string("wrapped"), str.to_string());
+   }
+   // String retained it, so our own reference is still good.
+   ASSERT_EQ(7, CFStringGetLength(raw));
+   CFRelease(raw);
+}
+
+TEST(StringTests, ConstantStrings)
+{
+   CFStringRef first = nullptr;
+   for (int i = 0; i < 3; ++i)
+   {
+      const CoreFoundation::String& constant = CFXX_STR("constant key");
+      ASSERT_EQ(std::string("constant key"), constant.to_string());
+      if (i == 0)
+         first = constant;
+      ASSERT_EQ(first, static_cast<CFStringRef>(constant));
+   }
+
+#if CFXX_HAS_STRING_LITERAL_OPERATOR
+   using namespace CoreFoundation::Literals;
+
+   CFStringRef literal = "literal key"_cfs;
+   for (int i = 0; i < 3; ++i)
+      ASSERT_EQ(literal, static_cast<CFStringRef>("literal key"_cfs));
+   ASSERT_NE(literal, static_cast<CFStringRef>("another key"_cfs));
+   ASSERT_EQ(std::string("literal key"), "literal key"_cfs.to_string());
+   ASSERT_EQ(std::string("caf\xC3\xA9"), "caf\xC3\xA9"_cfs.to_string());
+
+   // Copies share the constant.
+   CoreFoundation::String copy = "literal key"_cfs;
+   ASSERT_EQ(literal, static_cast<CFStringRef>(copy));
+#endif
+}
+
+TEST(StringTests, CompareMatchesCoreFoundation)
+{
+   // A mix of ASCII (stored 8-bit), non-ASCII (stored as UTF-16) and mutable strings,
+   // long enough to go through the vector loops.
+   const std::string base(40, 'm');
+   std::vector<CoreFoundation::String> strings;
+   strings.push_back(CoreFoundation::String(""));
+   strings.push_back(CoreFoundation::String(base.c_str()));
+   strings.push_back(CoreFoundation::String((base + "a").c_str()));
+   strings.push_back(CoreFoundation::String((base + "B").c_str()));
+   strings.push_back(CoreFoundation::String((base + "b").c_str()));
+   strings.push_back(CoreFoundation::String((base.substr(0, 20) + "Z" + base.substr(21)).c_str()));
+   strings.push_back(CoreFoundation::String((base + "caf\xC3\xA9").c_str()));
+   strings.push_back(CoreFoundation::String((base + "a\xC3\xA9").c_str()));
+   strings.push_back(CoreFoundation::String("\xE2\x82\xAC"));
+   strings.push_back(CoreFoundation::MutableString((base + "a").c_str()));
+   strings.push_back(CoreFoundation::MutableString((base + "A").c_str()));
+
+   const CFStringCompareFlags options[] = { 0, kCFCompareCaseInsensitive, kCFCompareNumerically };
+   for (size_t o = 0; o < sizeof(options) / sizeof(options[0]); ++o)
+   {
+      for (size_t i = 0; i < strings.size(); ++i)
+      {
+         for (size_t j = 0; j < strings.size(); ++j)
+         {
+            const CFComparisonResult expected = CFStringCompare(strings[i], strings[j], options[o]);
+            ASSERT_EQ(expected, strings[i].compare(strings[j], options[o])) << i << " vs " << j;
+            if (options[o] == 0)
+            {
+               ASSERT_EQ(expected == kCFCompareEqualTo, strings[i] == strings[j]);
+               ASSERT_EQ(expected == kCFCompareLessThan, strings[i] < strings[j]);
+               ASSERT_EQ(expected != kCFCompareLessThan, strings[i] >= strings[j]);
+            }
+         }
+      }
+   }
+}
+
+TEST(StringTests, ComparatorObjects)
+{
+   std::vector<CoreFoundation::String> strings;
+   strings.push_back(CoreFoundation::String("banana"));
+   strings.push_back(CoreFoundation::String("Cherry"));
+   strings.push_back(CoreFoundation::String("apple"));
+
+   std::sort(strings.begin(), strings.end(), CoreFoundation::StringLess());
+   ASSERT_EQ(std::string("Cherry"), strings[0].to_string());
+   ASSERT_EQ(std::string("apple"), strings[1].to_string());
+
+   std::sort(strings.begin(), strings.end(), CoreFoundation::StringLess(kCFCompareCaseInsensitive));
+   ASSERT_EQ(std::string("apple"), strings[0].to_string());
+   ASSERT_EQ(std::string("banana"), strings[1].to_string());
+   ASSERT_EQ(std::string("Cherry"), strings[2].to_string());
+
+   const CoreFoundation::StringEqualTo caseInsensitiveEqual(kCFCompareCaseInsensitive);
+   ASSERT_TRUE(caseInsensitiveEqual(CoreFoundation::String("CHERRY"), strings[2]));
+   ASSERT_FALSE(CoreFoundation::StringEqualTo()(CoreFoundation::String("CHERRY"), strings[2]));
+}
+
+namespace
+{
+
+CFIndex referenceFind(CFStringRef s, CFStringRef pattern, CFIndex from, bool backwards)
+{
+   const CFIndex length = CFStringGetLength(s);
+   const CFRange range = backwards ?
+      CFRangeMake(0, std::min(length, from + CFStringGetLength(pattern))) :
+      CFRangeMake(from, length - from);
+   CFRange found;
+   if (!CFStringFindWithOptions(s, pattern, range, backwards ? kCFCompareBackwards : 0, &found))
+      return CoreFoundation::String::npos;
+   return found.location;
+}
+
+} // anonymous namespace
+
+TEST(StringTests, FindMatchesCoreFoundation)
+{
+   // Haystacks and patterns in every storage: 8-bit, UTF-16, mutable, and external
+   // bytes, which CF doesn't hand out directly. The text is long enough to go through the
+   // vector loops, and the patterns are made of its own pieces so that they're found.
+   std::string text;
+   for (int i = 0; i < 12; ++i)
+      text += "abracadabra cadabra abra ";
+   const std::string unicodeText = text + "caf\xC3\xA9 abra";
+
+   std::vector<CoreFoundation::String> haystacks;
+   haystacks.push_back(CoreFoundation::String(text));
+   haystacks.push_back(CoreFoundation::String(unicodeText));
+   haystacks.push_back(CoreFoundation::MutableString(unicodeText.c_str()));
+   haystacks.push_back(CoreFoundation::String::with_bytes_no_copy(text.data(), text.size(), kCFStringEncodingASCII, kCFAllocatorNull));
+
+   std::vector<CoreFoundation::String> patterns;
+   for (const char* p : { "a", "r", "ab", "abra", "cadabra", "abra ", "abracadabra cadabra abra abracadabra",
+                          "zz", "abx", "\xC3\xA9", "f\xC3\xA9", "caf\xC3\xA9 abra" })
+   {
+      patterns.push_back(CoreFoundation::String(p));
+      patterns.push_back(CoreFoundation::MutableString(p));
+   }
+   // Too long to be copied out.
+   patterns.push_back(CoreFoundation::MutableString(text.substr(0, 300).c_str()));
+   patterns.push_back(CoreFoundation::String(text.substr(25, 280)));
+
+   for (size_t h = 0; h < haystacks.size(); ++h)
+   {
+      const CoreFoundation::String& haystack = haystacks[h];
+      for (size_t p = 0; p < patterns.size(); ++p)
+      {
+         const CoreFoundation::String& pattern = patterns[p];
+         for (CFIndex from : { 0, 1, 7, 100, 290, 299, 310 })
+         {
+            if (from > haystack.length())
+               continue;
+            ASSERT_EQ(referenceFind(haystack, pattern, from, false), haystack.find(pattern, from)) << h << " " << p << " " << from;
+            ASSERT_EQ(referenceFind(haystack, pattern, from, true), haystack.rfind(pattern, from)) << h << " " << p << " " << from;
+         }
+         ASSERT_EQ(referenceFind(haystack, pattern, haystack.length(), true), haystack.rfind(pattern)) << h << " " << p;
+         ASSERT_EQ(referenceFind(haystack, pattern, 0, false) != CoreFoundation::String::npos, haystack.contains(pattern));
+      }
+   }
+}
+
+TEST(StringTests, FindEdgeCases)
+{
+   const CoreFoundation::String str = "hello, world";
+
+   ASSERT_EQ(0, str.find("hello"));
+   ASSERT_EQ(7, str.find("world", 7));
+   ASSERT_EQ(CoreFoundation::String::npos, str.find("world", 8));
+   ASSERT_EQ(CoreFoundation::String::npos, str.find("hello, world!"));
+   ASSERT_EQ(CoreFoundation::String::npos, str.find("o", 100));
+
+   // An empty pattern is found wherever the search starts, as with std::string.
+   ASSERT_EQ(0, str.find(""));
+   ASSERT_EQ(3, str.find("", 3));
+   ASSERT_EQ(12, str.rfind(""));
+   ASSERT_EQ(4, str.rfind("", 4));
+   ASSERT_TRUE(str.contains(""));
+
+   ASSERT_EQ(CoreFoundation::String::npos, CoreFoundation::String("").find("a"));
+   ASSERT_EQ(CoreFoundation::String::npos, CoreFoundation::String("").rfind("a"));
+}
+
+TEST(StringTests, FindWithOptions)
+{
+   const CoreFoundation::String str = "Hello, World";
+
+   ASSERT_EQ(CoreFoundation::String::npos, str.find("world"));
+   ASSERT_EQ(7, str.find("world", 0, kCFCompareCaseInsensitive));
+   ASSERT_EQ(7, str.rfind("WORLD", CoreFoundation::String::npos, kCFCompareCaseInsensitive));
+   ASSERT_TRUE(str.contains("HELLO", kCFCompareCaseInsensitive));
+   ASSERT_FALSE(str.contains("HELLO"));
+
+   const CoreFoundation::String repeated = "abc abc abc";
+   ASSERT_EQ(8, repeated.rfind("ABC", CoreFoundation::String::npos, kCFCompareCaseInsensitive));
+   ASSERT_EQ(4, repeated.rfind("ABC", 7, kCFCompareCaseInsensitive));
+   ASSERT_EQ(0, repeated.rfind("ABC", 3, kCFCompareCaseInsensitive));
+   ASSERT_EQ(CoreFoundation::String::npos, repeated.rfind("ABCD", CoreFoundation::String::npos, kCFCompareCaseInsensitive));
+
+   // With kCFCompareNonliteral a match can be longer or shorter than the pattern: here
+   // U+00E9 matches 'e' followed by a combining acute accent.
+   const CoreFoundation::String shortPattern = "\xC3\xA9";
+   const CoreFoundation::String longPattern = "e\xCC\x81";
+   const CoreFoundation::String composedText = "x\xC3\xA9y\xC3\xA9";
+   const CoreFoundation::String decomposedText = longPattern;
+
+   // A pattern longer than the string can still match it.
+   ASSERT_EQ(0, shortPattern.rfind(longPattern, CoreFoundation::String::npos, kCFCompareNonliteral));
+   ASSERT_EQ(3, composedText.rfind(longPattern, CoreFoundation::String::npos, kCFCompareNonliteral));
+   ASSERT_EQ(1, composedText.rfind(longPattern, 2, kCFCompareNonliteral));
+   ASSERT_EQ(CoreFoundation::String::npos, composedText.rfind(longPattern, 0, kCFCompareNonliteral));
+   // A match longer than the pattern can still start at 'from'.
+   ASSERT_EQ(0, decomposedText.rfind(shortPattern, 0, kCFCompareNonliteral));
+   ASSERT_EQ(0, decomposedText.find(shortPattern, 0, kCFCompareNonliteral));
+}
+
+TEST(StringTests, FindCharacter)
+{
+   const std::string text = std::string(100, 'x') + "y" + std::string(100, 'x') + "y";
+   const CoreFoundation::String narrow(text);
+   const CoreFoundation::String wide(text + "\xC3\xA9");
+   const CoreFoundation::MutableString mutableString(text.c_str());
+   const CoreFoundation::String external = CoreFoundation::String::with_bytes_no_copy(
+      text.data(), text.size(), kCFStringEncodingASCII, kCFAllocatorNull);
+
+   const CoreFoundation::String* strings[] = { &narrow, &wide, &mutableString, &external };
+   for (const CoreFoundation::String* str : strings)
+   {
+      ASSERT_EQ(100, str->find('y'));
+      ASSERT_EQ(201, str->find('y', 101));
+      ASSERT_EQ(CoreFoundation::String::npos, str->find('z'));
+      ASSERT_EQ(201, str->rfind('y'));
+      ASSERT_EQ(100, str->rfind('y', 200));
+      ASSERT_EQ(CoreFoundation::String::npos, str->rfind('y', 99));
+      ASSERT_TRUE(str->contains('y'));
+      ASSERT_FALSE(str->contains('z'));
+   }
+
+   ASSERT_EQ(202, wide.find(0x00E9));
+   ASSERT_EQ(202, wide.rfind(0x00E9));
+   ASSERT_EQ(CoreFoundation::String::npos, narrow.find(0x00E9));
+
+   // Past the first kDefaultChunkSize characters of a string CF copies out.
+   CoreFoundation::MutableString longString(std::string(3000, 'x').c_str());
+   longString.append("y");
+   ASSERT_EQ(3000, longString.find('y'));
+   ASSERT_EQ(3000, longString.rfind('y'));
+   ASSERT_EQ(2999, longString.rfind('x'));
+}
+
+TEST(StringTests, StartsWithAndEndsWith)
+{
+   const CoreFoundation::String narrow = "prefix middle suffix";
+   const CoreFoundation::String wide = "pr\xC3\xA9" "fix middle suffix";
+   const CoreFoundation::MutableString mutableString("prefix middle suffix");
+
+   const CoreFoundation::String* strings[] = { &narrow, &mutableString };
+   for (const CoreFoundation::String* str : strings)
+   {
+      ASSERT_TRUE(str->starts_with("prefix"));
+      ASSERT_TRUE(str->starts_with(CoreFoundation::MutableString("pre")));
+      ASSERT_TRUE(str->starts_with(""));
+      ASSERT_FALSE(str->starts_with("suffix"));
+      ASSERT_FALSE(str->starts_with("prefix middle suffix!"));
+      ASSERT_TRUE(str->ends_with("suffix"));
+      ASSERT_TRUE(str->ends_with(*str));
+      ASSERT_TRUE(str->ends_with(""));
+      ASSERT_FALSE(str->ends_with("prefix"));
+   }
+
+   ASSERT_TRUE(wide.starts_with("pr\xC3\xA9"));
+   ASSERT_FALSE(wide.starts_with("pre"));
+   ASSERT_TRUE(wide.ends_with("suffix"));
+   ASSERT_FALSE(narrow.starts_with("pr\xC3\xA9"));
+}
+
+TEST(StringTests, Substr)
+{
+   const CoreFoundation::String str = "hello, w\xC3\xB6rld";
+
+   ASSERT_EQ(CoreFoundation::String("hello"), str.substr(0, 5));
+   ASSERT_EQ(CoreFoundation::String("w\xC3\xB6rld"), str.substr(7));
+   ASSERT_EQ(CoreFoundation::String("w\xC3\xB6"), str.substr(7, 2));
+   ASSERT_EQ(CoreFoundation::String("rld"), str.substr(9, 100));
+   ASSERT_TRUE(str.substr(12).empty());
+   ASSERT_EQ(str, str.substr(0));
+   ASSERT_THROW(str.substr(13), std::out_of_range);
+   ASSERT_THROW(str.substr(-1), std::out_of_range);
+
+   const CoreFoundation::MutableString mutableString("mutable");
+   ASSERT_EQ(CoreFoundation::String("table"), mutableString.substr(2));
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2013, Brenda Streiff
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Don't be a dick.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include "cfxx/cfxx.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Straightforward reference encoder to check the converter against.
+std::string referenceUtf8(const std::vector<UniChar>& in)
+{
+   std::string out;
+   for (size_t i = 0; i < in.size(); ++i)
+   {
+      UInt32 c = in[i];
+      if (c >= 0xD800 && c < 0xDC00 && i + 1 < in.size() && in[i + 1] >= 0xDC00 && in[i + 1] < 0xE000)
+      {
+         c = 0x10000 + ((c - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+         ++i;
+      }
+      else if (c >= 0xD800 && c < 0xE000)
+      {
+         c = 0xFFFD;
+      }
+
+      if (c < 0x80)
+         out += static_cast<char>(c);
+      else if (c < 0x800)
+      {
+         out += static_cast<char>(0xC0 | (c >> 6));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+      else if (c < 0x10000)
+      {
+         out += static_cast<char>(0xE0 | (c >> 12));
+         out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+      else
+      {
+         out += static_cast<char>(0xF0 | (c >> 18));
+         out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+         out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (c & 0x3F));
+      }
+   }
+   return out;
+}
+
+std::string convert(const std::vector<UniChar>& in)
+{
+   std::vector<char> out(CoreFoundation::Utf16ToUtf8Converter::max_output_size(in.size()));
+   const size_t n = CoreFoundation::convert_utf16_to_utf8(in.data(), in.size(), out.data());
+   return std::string(out.data(), n);
+}
+
+} // namespace
+
+TEST(UnicodeTests, AsciiRuns)
+{
+   // Long enough to go through the vector loops, with an odd-sized tail.
+   std::vector<UniChar> in;
+   for (int i = 0; i < 1000; ++i)
+      in.push_back(static_cast<UniChar>(' ' + (i % 95)));
+
+   ASSERT_EQ(referenceUtf8(in), convert(in));
+}
+
+TEST(UnicodeTests, MultiByteCharacters)
+{
+   const std::vector<UniChar> in = {
+      'a', 0x00E9, 'b', 0x07FF, 0x0800, 0x20AC, 0xFFFF, 0xD83D, 0xDE00, 'z' };
+
+   ASSERT_EQ(
+      std::string("a\xC3\xA9" "b\xDF\xBF\xE0\xA0\x80\xE2\x82\xAC\xEF\xBF\xBF\xF0\x9F\x98\x80z"),
+      convert(in));
+}
+
+TEST(UnicodeTests, UnpairedSurrogates)
+{
+   const std::string replacement = "\xEF\xBF\xBD";
+
+   ASSERT_EQ(replacement + "a", convert({ 0xD800, 'a' }));
+   ASSERT_EQ("a" + replacement, convert({ 'a', 0xDC00 }));
+   ASSERT_EQ(replacement, convert({ 0xDBFF }));
+   ASSERT_EQ(replacement + replacement, convert({ 0xDC00, 0xD800 }));
+}
+
+TEST(UnicodeTests, RandomTextInPieces)
+{
+   std::mt19937 random(1234);
+   std::uniform_int_distribution<int> kind(0, 9);
+
+   std::vector<UniChar> in;
+   for (int i = 0; i < 5000; ++i)
+   {
+      // Mostly ASCII, with every other kind of character mixed in.
+      switch (kind(random))
+      {
+      case 0: in.push_back(static_cast<UniChar>(0x80 + random() % 0x780)); break;
+      case 1: in.push_back(static_cast<UniChar>(0x800 + random() % 0xD000)); break;
+      case 2: in.push_back(static_cast<UniChar>(0xD800 + random() % 0x800)); break;
+      case 3:
+         in.push_back(static_cast<UniChar>(0xD800 + random() % 0x400));
+         in.push_back(static_cast<UniChar>(0xDC00 + random() % 0x400));
+         break;
+      default: in.push_back(static_cast<UniChar>(random() % 0x80)); break;
+      }
+   }
+
+   const std::string expected = referenceUtf8(in);
+   ASSERT_EQ(expected, convert(in));
+
+   // Feeding the same text in pieces of every size from 1 to 40 (which splits surrogate
+   // pairs all over the place) has to give the same answer.
+   for (size_t pieceSize = 1; pieceSize <= 40; ++pieceSize)
+   {
+      CoreFoundation::Utf16ToUtf8Converter converter;
+      std::vector<char> out(CoreFoundation::Utf16ToUtf8Converter::max_output_size(in.size()));
+      size_t written = 0;
+      for (size_t i = 0; i < in.size(); i += pieceSize)
+      {
+         const size_t n = std::min(pieceSize, in.size() - i);
+         written += converter.convert(in.data() + i, n, out.data() + written);
+      }
+      written += converter.finish(out.data() + written);
+
+      ASSERT_EQ(expected, std::string(out.data(), written)) << "piece size " << pieceSize;
+   }
+}
+
+TEST(UnicodeTests, StringToUtf8)
+{
+   const char* utf8 = "Caf\xC3\xA9 cr\xC3\xA8me \xE2\x82\xAC" "5 \xF0\x9F\x98\x80 and some plain ASCII after it";
+
+   CoreFoundation::String immutableString = utf8;
+   CoreFoundation::MutableString mutableString = utf8;
+
+   ASSERT_EQ(std::string(utf8), immutableString.to_string());
+   ASSERT_EQ(std::string(utf8), mutableString.to_string());
+
+   // Big enough that the conversion can't be done on the stack.
+   std::string longUtf8;
+   for (int i = 0; i < 200; ++i)
+      longUtf8 += utf8;
+
+   CoreFoundation::String longString = longUtf8.c_str();
+   ASSERT_EQ(longUtf8, longString.to_string());
+}
+
+TEST(UnicodeTests, FindMismatch)
+{
+   const size_t kLength = 100;
+   std::vector<UniChar> wide(kLength);
+   std::vector<UInt8> narrow(kLength);
+   for (size_t i = 0; i < kLength; ++i)
+   {
+      narrow[i] = static_cast<UInt8>('a' + i % 26);
+      wide[i] = narrow[i];
+   }
+
+   std::vector<UniChar> wideCopy(wide);
+   std::vector<UInt8> narrowCopy(narrow);
+   ASSERT_EQ(kLength, CoreFoundation::find_mismatch(wide.data(), wideCopy.data(), kLength));
+   ASSERT_EQ(kLength, CoreFoundation::find_mismatch(narrow.data(), narrowCopy.data(), kLength));
+   ASSERT_EQ(kLength, CoreFoundation::find_mismatch(narrow.data(), wide.data(), kLength));
+
+   // A difference at every position, including ones only the scalar tail sees.
+   for (size_t at = 0; at < kLength; ++at)
+   {
+      wideCopy[at] = 0x0100 | wide[at];
+      narrowCopy[at] = 'Z';
+      ASSERT_EQ(at, CoreFoundation::find_mismatch(wide.data(), wideCopy.data(), kLength));
+      ASSERT_EQ(at, CoreFoundation::find_mismatch(narrow.data(), narrowCopy.data(), kLength));
+      ASSERT_EQ(at, CoreFoundation::find_mismatch(narrow.data(), wideCopy.data(), kLength));
+      ASSERT_EQ(at, CoreFoundation::find_mismatch(wide.data(), wideCopy.data(), at + 1));
+      ASSERT_EQ(at, CoreFoundation::find_mismatch(wide.data(), wideCopy.data(), at));
+      wideCopy[at] = wide[at];
+      narrowCopy[at] = narrow[at];
+   }
+}